@@ -0,0 +1,97 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "myc/core.h"
+
+#define LINES_PER_THREAD 200000
+#define MAX_THREAD_COUNT 4
+
+typedef enum BenchLogMode {
+    BENCH_LOG_SYNC,
+    BENCH_LOG_ASYNC_DROP,
+    BENCH_LOG_ASYNC_BLOCK,
+    BENCH_LOG_BINARY,
+    BENCH_LOG_DISABLED,
+    BENCH_LOG_MODE_COUNT,
+} bench_log_mode_t;
+
+static const char *const bench_log_mode_names[BENCH_LOG_MODE_COUNT] = { "sync", "async drop", "async block", "binary", "disabled" };
+static const char *bench_binary_log_path = "/dev/null";
+
+static void* bench_thread(void *arg)
+{
+    const size_t thread_idx = (size_t)arg;
+    for (size_t i = 0; i < LINES_PER_THREAD; ++i) {
+        MYC_LOG_INFO("Thread %lu logged line %lu with value %d", thread_idx, i, (int)(i * 7));
+    }
+    return NULL;
+}
+
+/* Returns the average time a logging thread spent per line, the writer thread is not included. */
+static double bench_run(bench_log_mode_t mode, size_t thread_count, uint64_t *dropped_count)
+{
+    if (mode == BENCH_LOG_BINARY) {
+        if (myc_log_binary_start(bench_binary_log_path, MYC_LOG_ASYNC_DEFAULT_RING_SIZE, MYC_LOG_ASYNC_FULL_BLOCK) != MYC_SUCCESS) {
+            printf("Could not start binary logging.\n");
+            exit(EXIT_FAILURE);
+        }
+    } else if (mode == BENCH_LOG_DISABLED) {
+        myc_log_set_level(MYC_LOG_LEVEL_ERROR);
+    } else if (mode != BENCH_LOG_SYNC) {
+        const myc_log_async_full_policy_t full_policy = (mode == BENCH_LOG_ASYNC_DROP) ? MYC_LOG_ASYNC_FULL_DROP : MYC_LOG_ASYNC_FULL_BLOCK;
+        if (myc_log_async_start(MYC_LOG_ASYNC_DEFAULT_RING_SIZE, full_policy) != MYC_SUCCESS) {
+            printf("Could not start asynchronous logging.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    pthread_t threads[MAX_THREAD_COUNT];
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < thread_count; ++i) {
+        pthread_create(&threads[i], NULL, bench_thread, (void*)i);
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    *dropped_count = 0;
+    if (mode == BENCH_LOG_DISABLED) {
+        myc_log_set_level(MYC_LOG_LEVEL_DEBUG);
+    } else if (mode != BENCH_LOG_SYNC) {
+        *dropped_count = myc_log_async_get_dropped_count();
+        myc_log_async_stop();
+    }
+    const double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) * 1e-9;
+    return seconds * 1e9 / LINES_PER_THREAD;
+}
+
+int main(int argc, char **argv)
+{
+    /* Lines go to /dev/null unless files are given, so the bench measures the logging path and not the terminal. */
+    const char *log_path = (argc > 1) ? argv[1] : "/dev/null";
+    if (argc > 2) {
+        bench_binary_log_path = argv[2];
+    }
+    const int fd = open(log_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || dup2(fd, STDERR_FILENO) < 0) {
+        printf("Could not redirect stderr to '%s'.\n", log_path);
+        return EXIT_FAILURE;
+    }
+    close(fd);
+
+    printf("mode, threads, ns per line, dropped lines\n");
+    for (size_t thread_count = 1; thread_count <= MAX_THREAD_COUNT; thread_count *= 2) {
+        for (bench_log_mode_t mode = 0; mode < BENCH_LOG_MODE_COUNT; ++mode) {
+            uint64_t dropped_count;
+            const double ns_per_line = bench_run(mode, thread_count, &dropped_count);
+            printf("%s, %lu, %.1f, %lu\n", bench_log_mode_names[mode], thread_count, ns_per_line, dropped_count);
+        }
+    }
+    return 0;
+}
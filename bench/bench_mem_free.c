@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "myc/core.h"
+#include "myc/memory.h"
+
+#define MIN_CHUNK_COUNT 1024
+#define MAX_CHUNK_COUNT (1024 * 1024)
+#define CHUNK_SIZE 300          // Above the small object sizes, so every request takes a chunk of its own.
+#define CHUNK_FOOTPRINT 512     // Size plus chunk header, rounded up to whole arena pages.
+#define FREE_STRIDE 16
+
+static double bench_elapsed_ns(const struct timespec *start, const struct timespec *end)
+{
+    return (double)(end->tv_sec - start->tv_sec) * 1e9 + (double)(end->tv_nsec - start->tv_nsec);
+}
+
+typedef struct BenchResult {
+    double free_ns;
+    double realloc_ns;
+} BenchResult_t;
+
+/* Allocates 'chunk_count' chunks back to back, so they all start out in the same bucket, then frees every 
+FREE_STRIDE-th chunk in random order. Each free splits a bucket somewhere far from its start. Afterwards, random 
+remaining chunks are reallocated to their own size, which does nothing but look up their bucket. */
+static BenchResult_t bench_run(size_t chunk_count, unsigned int seed)
+{
+    MycMemArena_t *arena;
+    if (myc_mem_arena_create(&arena, (uint32_t)(chunk_count * CHUNK_FOOTPRINT + 1024 * 1024)) != MYC_SUCCESS) {
+        MYC_LOG_ERROR("Could not create memory arena.");
+        exit(EXIT_FAILURE);
+    }
+    void **chunks = malloc(chunk_count * sizeof(void*));
+    for (size_t i = 0; i < chunk_count; ++i) {
+        chunks[i] = myc_mem_arena_malloc(arena, CHUNK_SIZE);
+    }
+
+    const size_t free_count = chunk_count / FREE_STRIDE;
+    void **frees = malloc(chunk_count * sizeof(void*));
+    for (size_t i = 0; i < free_count; ++i) {
+        frees[i] = chunks[FREE_STRIDE * i];
+    }
+    for (size_t i = free_count - 1; i > 0; --i) {
+        const size_t j = rand_r(&seed) % (i + 1);
+        void *tmp = frees[i];
+        frees[i] = frees[j];
+        frees[j] = tmp;
+    }
+
+    BenchResult_t result;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < free_count; ++i) {
+        myc_mem_arena_free(frees[i]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    result.free_ns = bench_elapsed_ns(&start, &end) / (double)free_count;
+
+    for (size_t i = 0; i < chunk_count; ++i) {
+        const size_t chunk_idx = rand_r(&seed) % chunk_count;
+        frees[i] = chunks[(chunk_idx % FREE_STRIDE == 0) ? chunk_idx + 1 : chunk_idx];
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < chunk_count; ++i) {
+        myc_mem_arena_realloc(frees[i], CHUNK_SIZE);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    result.realloc_ns = bench_elapsed_ns(&start, &end) / (double)chunk_count;
+
+    free(frees);
+    free(chunks);
+    myc_mem_arena_destroy(arena);
+    return result;
+}
+
+int main(void)
+{
+    printf("live chunks, random free (ns/op), same size realloc (ns/op)\n");
+    for (size_t chunk_count = MIN_CHUNK_COUNT; chunk_count <= MAX_CHUNK_COUNT; chunk_count *= 4) {
+        const BenchResult_t result = bench_run(chunk_count, (unsigned int)chunk_count);
+        printf("%11lu, %18.1f, %26.1f\n", chunk_count, result.free_ns, result.realloc_ns);
+    }
+    return 0;
+}
@@ -0,0 +1,299 @@
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "myc/core.h"
+#include "myc/memory.h"
+
+/* Replays an allocation trace recorded with 'myc_mem_arena_trace_start' as fast as possible, ignoring the recorded
+timestamps. Every allocator replays in its own child process, so the peak RSS reported for it is not inflated by the
+ones before. The footprint is sampled every few operations outside of the timed sections, and fragmentation is the
+share of the footprint not covered by live allocations when the live size peaked. */
+#define ARENA_SIZE (16 * 1024 * 1024)
+#define ARENA_RESERVE_SIZE (1024 * 1024 * 1024)
+#define SAMPLE_OP_COUNT 1024
+
+typedef enum BenchAllocatorKind {
+    BENCH_ALLOCATOR_GLIBC,
+    BENCH_ALLOCATOR_ARENA,
+    BENCH_ALLOCATOR_ARENA_THREAD_SAFE,
+    BENCH_ALLOCATOR_COUNT,
+} bench_allocator_kind_t;
+
+static const char *const bench_allocator_names[BENCH_ALLOCATOR_COUNT] = { "glibc", "arena", "arena_ts" };
+
+typedef struct BenchTrace {
+    MycMemTraceRecord_t *records;
+    size_t record_count;
+    uint32_t max_id;
+} BenchTrace_t;
+
+typedef struct BenchResult {
+    size_t op_count;
+    size_t failed_op_count;
+    double elapsed_ms;
+    double ns_per_op;
+    size_t peak_live_size;
+    size_t peak_footprint_size;
+    double fragmentation;
+    long peak_rss_kib;
+} BenchResult_t;
+
+static inline double bench_elapsed_ns(const struct timespec *start, const struct timespec *end)
+{
+    return (double)(end->tv_sec - start->tv_sec) * 1e9 + (double)(end->tv_nsec - start->tv_nsec);
+}
+
+
+
+// === TRACE ======================================================================================================= //
+
+static bool bench_trace_load(BenchTrace_t *trace, const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        MYC_LOG_ERROR("Could not open trace '%s'.", path);
+        return false;
+    }
+    MycMemTraceHeader_t header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != MYC_MEM_TRACE_MAGIC
+     || header.version != MYC_MEM_TRACE_VERSION || header.record_size != sizeof(MycMemTraceRecord_t)) {
+        MYC_LOG_ERROR("'%s' is not a supported allocation trace.", path);
+        fclose(file);
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    const long file_size = ftell(file);
+    fseek(file, sizeof(header), SEEK_SET);
+    *trace = (BenchTrace_t){ .record_count = (size_t)(file_size - (long)sizeof(header)) / sizeof(MycMemTraceRecord_t) };
+    trace->records = malloc(MYC_MAX(trace->record_count, (size_t)1) * sizeof(MycMemTraceRecord_t));
+    const bool is_read = fread(trace->records, sizeof(MycMemTraceRecord_t), trace->record_count, file) == trace->record_count;
+    fclose(file);
+    if (!is_read) {
+        MYC_LOG_ERROR("Could not read trace '%s'.", path);
+        free(trace->records);
+        return false;
+    }
+
+    /* Ids are dense, so the replay maps them to addresses with a plain array. */
+    for (size_t record_idx = 0; record_idx < trace->record_count; ++record_idx) {
+        trace->max_id = MYC_MAX(trace->max_id, trace->records[record_idx].id);
+    }
+    return true;
+}
+
+
+
+// === REPLAY ====================================================================================================== //
+
+typedef struct BenchFootprint {
+    size_t used_size;
+    size_t mapped_size;
+} BenchFootprint_t;
+
+/* The glibc heap also holds the trace and the replay state, so its footprint is taken relative to 'baseline'. */
+static BenchFootprint_t bench_footprint(MycMemArena_t *arena, const BenchFootprint_t *baseline)
+{
+    if (arena == NULL) {
+        const struct mallinfo2 info = mallinfo2();
+        return (BenchFootprint_t){
+            .used_size = info.uordblks + info.hblkhd - MYC_MIN(baseline->used_size, info.uordblks + info.hblkhd),
+            .mapped_size = info.arena + info.hblkhd - MYC_MIN(baseline->mapped_size, info.arena + info.hblkhd),
+        };
+    }
+    MycMemArenaStats_t stats;
+    myc_mem_arena_get_stats(arena, &stats);
+    return (BenchFootprint_t){ .used_size = stats.used_size, .mapped_size = stats.mapped_size };
+}
+
+static BenchResult_t bench_replay_in_process(const BenchTrace_t *trace, bench_allocator_kind_t kind)
+{
+    MycMemArena_t *arena = NULL;
+    if (kind != BENCH_ALLOCATOR_GLIBC) {
+        const myc_mem_arena_flags_t flags = (kind == BENCH_ALLOCATOR_ARENA_THREAD_SAFE) ? MYC_MEM_ARENA_FLAG_THREAD_SAFE : MYC_MEM_ARENA_FLAG_NONE;
+        if (myc_mem_arena_create_reserved(&arena, ARENA_SIZE, ARENA_RESERVE_SIZE, flags) != MYC_SUCCESS) {
+            MYC_LOG_ERROR("Could not create memory arena.");
+            exit(EXIT_FAILURE);
+        }
+    }
+    void **addrs = calloc((size_t)trace->max_id + 1, sizeof(void*));
+    size_t *sizes = calloc((size_t)trace->max_id + 1, sizeof(size_t));
+
+    const BenchFootprint_t baseline = bench_footprint(arena, &(BenchFootprint_t){ 0 });
+    BenchResult_t result = { .op_count = trace->record_count };
+    size_t live_size = 0;
+    size_t sampled_live_size = 0;
+    double elapsed_ns = 0.0;
+    for (size_t record_idx = 0; record_idx < trace->record_count; ) {
+        const size_t end_idx = MYC_MIN(record_idx + SAMPLE_OP_COUNT, trace->record_count);
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (; record_idx < end_idx; ++record_idx) {
+            const MycMemTraceRecord_t *record = &trace->records[record_idx];
+            void *addr = addrs[record->id];
+            switch (record->op) {
+                case MYC_MEM_TRACE_OP_MALLOC:
+                    addr = (arena == NULL) ? malloc(record->size) : myc_mem_arena_malloc(arena, (myc_mem_size_t)record->size);
+                    break;
+                case MYC_MEM_TRACE_OP_REALLOC:
+                    if (arena == NULL) {
+                        addr = realloc(addr, record->size);
+                    } else {
+                        addr = (addr != NULL) ? myc_mem_arena_realloc(addr, (myc_mem_size_t)record->size) : myc_mem_arena_malloc(arena, (myc_mem_size_t)record->size);
+                    }
+                    break;
+                case MYC_MEM_TRACE_OP_FREE:
+                    if (arena == NULL) {
+                        free(addr);
+                    } else if (addr != NULL) {
+                        myc_mem_arena_free(addr);
+                    }
+                    addr = NULL;
+                    break;
+            }
+            if (addr == NULL && record->op != MYC_MEM_TRACE_OP_FREE) {
+                result.failed_op_count += 1;
+                continue;
+            }
+            if (addr != NULL) {
+                *(volatile uint8_t*)addr = 1;
+            }
+            live_size = live_size - sizes[record->id] + ((addr != NULL) ? record->size : 0);
+            sizes[record->id] = (addr != NULL) ? record->size : 0;
+            addrs[record->id] = addr;
+            result.peak_live_size = MYC_MAX(result.peak_live_size, live_size);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        elapsed_ns += bench_elapsed_ns(&start, &end);
+
+        const BenchFootprint_t footprint = bench_footprint(arena, &baseline);
+        result.peak_footprint_size = MYC_MAX(result.peak_footprint_size, footprint.mapped_size);
+        if (live_size >= sampled_live_size && footprint.mapped_size > 0) {
+            sampled_live_size = live_size;
+            result.fragmentation = 1.0 - (double)MYC_MIN(live_size, footprint.mapped_size) / (double)footprint.mapped_size;
+        }
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    result.elapsed_ms = elapsed_ns * 1e-6;
+    result.ns_per_op = (trace->record_count > 0) ? elapsed_ns / (double)trace->record_count : 0.0;
+    result.peak_rss_kib = usage.ru_maxrss;
+
+    if (arena != NULL) {
+        myc_mem_arena_destroy(arena);
+    } else {
+        for (uint32_t id = 0; id <= trace->max_id; ++id) {
+            free(addrs[id]);
+        }
+    }
+    free(sizes);
+    free(addrs);
+    return result;
+}
+
+/* Replays the trace in a child process, which sends its result back through a pipe. */
+static bool bench_replay(BenchResult_t *result, const BenchTrace_t *trace, bench_allocator_kind_t kind)
+{
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return false;
+    }
+    fflush(stdout);
+    const pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        const BenchResult_t child_result = bench_replay_in_process(trace, kind);
+        const bool is_written = write(fds[1], &child_result, sizeof(child_result)) == (ssize_t)sizeof(child_result);
+        _exit(is_written ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    close(fds[1]);
+    const bool is_read = (pid > 0) && read(fds[0], result, sizeof(BenchResult_t)) == (ssize_t)sizeof(BenchResult_t);
+    close(fds[0]);
+    int status = 0;
+    if (pid > 0) waitpid(pid, &status, 0);
+    return is_read && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+}
+
+
+
+// === DRIVER ====================================================================================================== //
+
+static void bench_print_usage(const char *program)
+{
+    fprintf(stderr, "usage: %s <trace> [--csv | --json] [--allocator <glibc | arena | arena_ts>]\n", program);
+}
+
+int main(int argc, char **argv)
+{
+    bool is_json = false;
+    const char *path = NULL;
+    const char *allocator_filter = NULL;
+    for (int arg_idx = 1; arg_idx < argc; ++arg_idx) {
+        if (strcmp(argv[arg_idx], "--json") == 0) {
+            is_json = true;
+        } else if (strcmp(argv[arg_idx], "--csv") == 0) {
+            is_json = false;
+        } else if (strcmp(argv[arg_idx], "--allocator") == 0 && arg_idx + 1 < argc) {
+            allocator_filter = argv[++arg_idx];
+        } else if (argv[arg_idx][0] != '-' && path == NULL) {
+            path = argv[arg_idx];
+        } else {
+            bench_print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    BenchTrace_t trace;
+    if (path == NULL) {
+        bench_print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (!bench_trace_load(&trace, path)) {
+        return EXIT_FAILURE;
+    }
+
+    if (is_json) {
+        printf("{\n  \"trace\": \"%s\",\n  \"op_count\": %lu,\n  \"results\": [", path, trace.record_count);
+    } else {
+        printf("allocator,ops,failed_ops,elapsed_ms,ns_per_op,peak_live_kib,peak_footprint_kib,fragmentation,peak_rss_kib\n");
+    }
+    bool is_first = true;
+    int exit_code = EXIT_SUCCESS;
+    for (bench_allocator_kind_t kind = 0; kind < BENCH_ALLOCATOR_COUNT; ++kind) {
+        if (allocator_filter != NULL && strcmp(allocator_filter, bench_allocator_names[kind]) != 0) continue;
+
+        BenchResult_t result;
+        if (!bench_replay(&result, &trace, kind)) {
+            MYC_LOG_ERROR("Replay failed on '%s'.", bench_allocator_names[kind]);
+            exit_code = EXIT_FAILURE;
+            continue;
+        }
+        if (is_json) {
+            printf("%s\n    { \"allocator\": \"%s\", \"ops\": %lu, \"failed_ops\": %lu, \"elapsed_ms\": %.3f, \"ns_per_op\": %.1f, "
+                   "\"peak_live_kib\": %lu, \"peak_footprint_kib\": %lu, \"fragmentation\": %.4f, \"peak_rss_kib\": %ld }",
+                   is_first ? "" : ",", bench_allocator_names[kind], result.op_count, result.failed_op_count, result.elapsed_ms,
+                   result.ns_per_op, result.peak_live_size / 1024, result.peak_footprint_size / 1024, result.fragmentation,
+                   result.peak_rss_kib);
+        } else {
+            printf("%s,%lu,%lu,%.3f,%.1f,%lu,%lu,%.4f,%ld\n",
+                   bench_allocator_names[kind], result.op_count, result.failed_op_count, result.elapsed_ms, result.ns_per_op,
+                   result.peak_live_size / 1024, result.peak_footprint_size / 1024, result.fragmentation, result.peak_rss_kib);
+        }
+        is_first = false;
+    }
+    if (is_json) {
+        printf("\n  ]\n}\n");
+    }
+    if (is_first && exit_code == EXIT_SUCCESS) {
+        bench_print_usage(argv[0]);
+        exit_code = EXIT_FAILURE;
+    }
+    free(trace.records);
+    return exit_code;
+}
@@ -0,0 +1,498 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "myc/core.h"
+#include "myc/memory.h"
+
+/* Every workload runs in its own child process, so the peak RSS reported for it is not inflated by the ones before.
+Latencies are measured per batch of operations, which keeps the clock overhead out of the numbers,
+and each batch contributes its mean to the percentiles. */
+#define DEFAULT_OP_COUNT 1000000
+#define BATCH_OP_COUNT 16
+#define ARENA_SIZE (16 * 1024 * 1024)
+#define ARENA_RESERVE_SIZE (1024 * 1024 * 1024)
+#define LIVE_SLOT_COUNT 4096
+#define BUMP_ROUND_OP_COUNT 10000
+#define BUMP_SIZE (2 * 1024 * 1024)
+#define RING_SIZE 1024
+
+typedef enum BenchAllocatorKind {
+    BENCH_ALLOCATOR_GLIBC,
+    BENCH_ALLOCATOR_ARENA,
+    BENCH_ALLOCATOR_ARENA_THREAD_SAFE,
+    BENCH_ALLOCATOR_BUMP,
+    BENCH_ALLOCATOR_COUNT,
+} bench_allocator_kind_t;
+
+static const char *const bench_allocator_names[BENCH_ALLOCATOR_COUNT] = { "glibc", "arena", "arena_ts", "bump" };
+
+/* A thin common interface, so every workload runs unchanged on each allocator. 'reset' frees everything at once,
+which allocators without a cheaper way implement by freeing the given addresses one by one. */
+typedef struct BenchAllocator {
+    bench_allocator_kind_t kind;
+    MycMemArena_t *arena;
+    MycMemBumpAlloc_t *bump_alloc;
+} BenchAllocator_t;
+
+typedef struct BenchResult {
+    size_t op_count;
+    double ops_per_sec;
+    double ns_p50;
+    double ns_p90;
+    double ns_p99;
+    double ns_p999;
+    long peak_rss_kib;
+} BenchResult_t;
+
+typedef struct BenchTimer {
+    double *batch_ns;
+    size_t batch_count;
+    size_t batch_capacity;
+    struct timespec batch_start;
+} BenchTimer_t;
+
+typedef void (*bench_workload_fn)(BenchAllocator_t *allocator, BenchTimer_t *timer, size_t op_count, unsigned int seed);
+
+typedef struct BenchWorkload {
+    const char *name;
+    bench_workload_fn run;
+    bool is_threaded;           // Only runs on allocators which may be used from several threads.
+    bool needs_free;            // Does not run on the bump allocator.
+} BenchWorkload_t;
+
+static inline double bench_elapsed_ns(const struct timespec *start, const struct timespec *end)
+{
+    return (double)(end->tv_sec - start->tv_sec) * 1e9 + (double)(end->tv_nsec - start->tv_nsec);
+}
+
+
+
+// === ALLOCATORS ================================================================================================== //
+
+static void bench_allocator_create(BenchAllocator_t *allocator, bench_allocator_kind_t kind)
+{
+    *allocator = (BenchAllocator_t){ .kind = kind };
+    if (kind == BENCH_ALLOCATOR_GLIBC) {
+        return;
+    }
+    const myc_mem_arena_flags_t flags = (kind == BENCH_ALLOCATOR_ARENA_THREAD_SAFE) ? MYC_MEM_ARENA_FLAG_THREAD_SAFE : MYC_MEM_ARENA_FLAG_NONE;
+    if (myc_mem_arena_create_reserved(&allocator->arena, ARENA_SIZE, ARENA_RESERVE_SIZE, flags) != MYC_SUCCESS) {
+        MYC_LOG_ERROR("Could not create memory arena.");
+        exit(EXIT_FAILURE);
+    }
+    if (kind == BENCH_ALLOCATOR_BUMP && myc_mem_bump_alloc_create(&allocator->bump_alloc, allocator->arena, BUMP_SIZE) != MYC_SUCCESS) {
+        MYC_LOG_ERROR("Could not create bump allocator.");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void bench_allocator_destroy(BenchAllocator_t *allocator)
+{
+    if (allocator->bump_alloc != NULL) {
+        myc_mem_bump_alloc_destroy(allocator->bump_alloc);
+    }
+    if (allocator->arena != NULL) {
+        myc_mem_arena_destroy(allocator->arena);
+    }
+}
+
+static inline void* bench_malloc(BenchAllocator_t *allocator, size_t size)
+{
+    switch (allocator->kind) {
+        case BENCH_ALLOCATOR_GLIBC: return malloc(size);
+        case BENCH_ALLOCATOR_BUMP: return myc_mem_bump_malloc(allocator->bump_alloc, (uint32_t)size);
+        default: return myc_mem_arena_malloc(allocator->arena, (myc_mem_size_t)size);
+    }
+}
+
+static inline void* bench_realloc(BenchAllocator_t *allocator, void *addr, size_t new_size)
+{
+    return (allocator->kind == BENCH_ALLOCATOR_GLIBC) ? realloc(addr, new_size) : myc_mem_arena_realloc(addr, (myc_mem_size_t)new_size);
+}
+
+static inline void bench_free(BenchAllocator_t *allocator, void *addr)
+{
+    if (allocator->kind == BENCH_ALLOCATOR_GLIBC) {
+        free(addr);
+    } else {
+        myc_mem_arena_free(addr);
+    }
+}
+
+static void bench_reset(BenchAllocator_t *allocator, void **addrs, size_t addr_count)
+{
+    switch (allocator->kind) {
+        case BENCH_ALLOCATOR_BUMP:
+            myc_mem_bump_alloc_reset(allocator->bump_alloc);
+            break;
+        case BENCH_ALLOCATOR_ARENA:
+            myc_mem_arena_reset(allocator->arena);
+            break;
+        default:
+            for (size_t i = 0; i < addr_count; ++i) {
+                bench_free(allocator, addrs[i]);
+            }
+            break;
+    }
+}
+
+
+
+// === TIMING ====================================================================================================== //
+
+static void bench_timer_create(BenchTimer_t *timer, size_t op_count)
+{
+    timer->batch_capacity = op_count / BATCH_OP_COUNT + 1;
+    timer->batch_ns = malloc(timer->batch_capacity * sizeof(double));
+    timer->batch_count = 0;
+}
+
+static inline void bench_timer_start_batch(BenchTimer_t *timer)
+{
+    clock_gettime(CLOCK_MONOTONIC, &timer->batch_start);
+}
+
+static inline void bench_timer_end_batch(BenchTimer_t *timer, size_t op_count)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (timer->batch_count < timer->batch_capacity && op_count > 0) {
+        timer->batch_ns[timer->batch_count] = bench_elapsed_ns(&timer->batch_start, &end) / (double)op_count;
+        timer->batch_count += 1;
+    }
+}
+
+static int bench_compare_doubles(const void *lhs, const void *rhs)
+{
+    const double a = *(const double*)lhs;
+    const double b = *(const double*)rhs;
+    return (a > b) - (a < b);
+}
+
+static double bench_percentile(const double *sorted, size_t count, double percentile)
+{
+    if (count == 0) return 0.0;
+    const size_t idx = (size_t)(percentile * (double)(count - 1) + 0.5);
+    return sorted[MYC_MIN(idx, count - 1)];
+}
+
+
+
+// === WORKLOADS =================================================================================================== //
+
+/* Size of a 'mixed' request: mostly small objects, some medium buffers and a few large ones. */
+static inline size_t bench_mixed_size(unsigned int *seed)
+{
+    const unsigned int dice = rand_r(seed) % 100;
+    if (dice < 70) return 8 + rand_r(seed) % 249;
+    if (dice < 95) return 257 + rand_r(seed) % (16 * 1024);
+    return 16 * 1024 + rand_r(seed) % (240 * 1024);
+}
+
+/* Random malloc/free churn on a live set of 16-1024 byte chunks. */
+static void bench_workload_malloc_free(BenchAllocator_t *allocator, BenchTimer_t *timer, size_t op_count, unsigned int seed)
+{
+    void **slots = calloc(LIVE_SLOT_COUNT, sizeof(void*));
+    for (size_t op_idx = 0; op_idx < op_count; op_idx += BATCH_OP_COUNT) {
+        bench_timer_start_batch(timer);
+        for (size_t i = 0; i < BATCH_OP_COUNT; ++i) {
+            void **slot = &slots[rand_r(&seed) % LIVE_SLOT_COUNT];
+            if (*slot == NULL) {
+                *slot = bench_malloc(allocator, 16 + rand_r(&seed) % 1009);
+            } else {
+                bench_free(allocator, *slot);
+                *slot = NULL;
+            }
+        }
+        bench_timer_end_batch(timer, BATCH_OP_COUNT);
+    }
+    for (size_t slot_idx = 0; slot_idx < LIVE_SLOT_COUNT; ++slot_idx) {
+        if (slots[slot_idx] != NULL) bench_free(allocator, slots[slot_idx]);
+    }
+    free(slots);
+}
+
+/* Buffers growing in random steps up to 256 KiB, as appended to by a parser or a vector, then starting over. */
+static void bench_workload_realloc(BenchAllocator_t *allocator, BenchTimer_t *timer, size_t op_count, unsigned int seed)
+{
+    enum { BUFFER_COUNT = 256, BUFFER_SIZE_MAX = 256 * 1024 };
+    void *buffers[BUFFER_COUNT] = { 0 };
+    size_t sizes[BUFFER_COUNT] = { 0 };
+    for (size_t op_idx = 0; op_idx < op_count; op_idx += BATCH_OP_COUNT) {
+        bench_timer_start_batch(timer);
+        for (size_t i = 0; i < BATCH_OP_COUNT; ++i) {
+            const size_t buffer_idx = rand_r(&seed) % BUFFER_COUNT;
+            if (sizes[buffer_idx] >= BUFFER_SIZE_MAX) {
+                bench_free(allocator, buffers[buffer_idx]);
+                buffers[buffer_idx] = NULL;
+                sizes[buffer_idx] = 0;
+                continue;
+            }
+            sizes[buffer_idx] += 64 + rand_r(&seed) % 4096;
+            buffers[buffer_idx] = (buffers[buffer_idx] == NULL)
+                ? bench_malloc(allocator, sizes[buffer_idx])
+                : bench_realloc(allocator, buffers[buffer_idx], sizes[buffer_idx]);
+        }
+        bench_timer_end_batch(timer, BATCH_OP_COUNT);
+    }
+    for (size_t buffer_idx = 0; buffer_idx < BUFFER_COUNT; ++buffer_idx) {
+        if (buffers[buffer_idx] != NULL) bench_free(allocator, buffers[buffer_idx]);
+    }
+}
+
+/* Rounds of many short lived small objects which die together, e.g. per frame or per request.
+Each round ends with a reset, whose cost is spread over the round's batches. */
+static void bench_workload_bump(BenchAllocator_t *allocator, BenchTimer_t *timer, size_t op_count, unsigned int seed)
+{
+    void **addrs = malloc(BUMP_ROUND_OP_COUNT * sizeof(void*));
+    size_t addr_count = 0;
+    for (size_t op_idx = 0; op_idx < op_count; op_idx += BATCH_OP_COUNT) {
+        bench_timer_start_batch(timer);
+        for (size_t i = 0; i < BATCH_OP_COUNT; ++i) {
+            addrs[addr_count] = bench_malloc(allocator, 16 + rand_r(&seed) % 113);
+            addr_count += 1;
+            if (addr_count == BUMP_ROUND_OP_COUNT) {
+                bench_reset(allocator, addrs, addr_count);
+                addr_count = 0;
+            }
+        }
+        bench_timer_end_batch(timer, BATCH_OP_COUNT);
+    }
+    bench_reset(allocator, addrs, addr_count);
+    free(addrs);
+}
+
+/* Like 'malloc_free', but on a live set spanning small objects up to 256 KiB buffers. */
+static void bench_workload_mixed(BenchAllocator_t *allocator, BenchTimer_t *timer, size_t op_count, unsigned int seed)
+{
+    void **slots = calloc(LIVE_SLOT_COUNT, sizeof(void*));
+    for (size_t op_idx = 0; op_idx < op_count; op_idx += BATCH_OP_COUNT) {
+        bench_timer_start_batch(timer);
+        for (size_t i = 0; i < BATCH_OP_COUNT; ++i) {
+            void **slot = &slots[rand_r(&seed) % LIVE_SLOT_COUNT];
+            if (*slot == NULL) {
+                *slot = bench_malloc(allocator, bench_mixed_size(&seed));
+            } else {
+                bench_free(allocator, *slot);
+                *slot = NULL;
+            }
+        }
+        bench_timer_end_batch(timer, BATCH_OP_COUNT);
+    }
+    for (size_t slot_idx = 0; slot_idx < LIVE_SLOT_COUNT; ++slot_idx) {
+        if (slots[slot_idx] != NULL) bench_free(allocator, slots[slot_idx]);
+    }
+    free(slots);
+}
+
+/* A single producer/consumer ring, so every chunk is freed by another thread than the one which allocated it. */
+typedef struct BenchRing {
+    void *slots[RING_SIZE];
+    size_t head;                // Written by the producer only.
+    size_t tail;                // Written by the consumer only.
+    BenchAllocator_t *allocator;
+    BenchTimer_t timer;         // Latencies of the frees, the producer times the mallocs.
+    size_t op_count;
+} BenchRing_t;
+
+static void* bench_consumer_thread(void *arg)
+{
+    BenchRing_t *ring = arg;
+    size_t tail = 0;
+    for (size_t op_idx = 0; op_idx < ring->op_count; ) {
+        const size_t available = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - tail;
+        const size_t batch_op_count = MYC_MIN(available, (size_t)BATCH_OP_COUNT);
+        if (batch_op_count == 0) {
+            sched_yield();
+            continue;
+        }
+        bench_timer_start_batch(&ring->timer);
+        for (size_t i = 0; i < batch_op_count; ++i) {
+            bench_free(ring->allocator, ring->slots[(tail + i) % RING_SIZE]);
+        }
+        bench_timer_end_batch(&ring->timer, batch_op_count);
+        tail += batch_op_count;
+        op_idx += batch_op_count;
+        __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+static void bench_workload_producer_consumer(BenchAllocator_t *allocator, BenchTimer_t *timer, size_t op_count, unsigned int seed)
+{
+    BenchRing_t *ring = calloc(1, sizeof(BenchRing_t));
+    ring->allocator = allocator;
+    ring->op_count = op_count / 2;
+    bench_timer_create(&ring->timer, ring->op_count);
+
+    pthread_t consumer;
+    pthread_create(&consumer, NULL, bench_consumer_thread, ring);
+    size_t head = 0;
+    for (size_t op_idx = 0; op_idx < ring->op_count; ) {
+        const size_t space = RING_SIZE - (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE));
+        const size_t batch_op_count = MYC_MIN(MYC_MIN(space, (size_t)BATCH_OP_COUNT), ring->op_count - op_idx);
+        if (batch_op_count == 0) {
+            sched_yield();
+            continue;
+        }
+        bench_timer_start_batch(timer);
+        for (size_t i = 0; i < batch_op_count; ++i) {
+            ring->slots[(head + i) % RING_SIZE] = bench_malloc(allocator, 16 + rand_r(&seed) % 1009);
+        }
+        bench_timer_end_batch(timer, batch_op_count);
+        head += batch_op_count;
+        op_idx += batch_op_count;
+        __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+    }
+    pthread_join(consumer, NULL);
+
+    /* Both sides are reported together. */
+    const size_t free_batch_count = MYC_MIN(ring->timer.batch_count, timer->batch_capacity - timer->batch_count);
+    memcpy(timer->batch_ns + timer->batch_count, ring->timer.batch_ns, free_batch_count * sizeof(double));
+    timer->batch_count += free_batch_count;
+    free(ring->timer.batch_ns);
+    free(ring);
+}
+
+static const BenchWorkload_t bench_workloads[] = {
+    { .name = "malloc_free",        .run = bench_workload_malloc_free,          .needs_free = true },
+    { .name = "realloc",            .run = bench_workload_realloc,              .needs_free = true },
+    { .name = "bump",               .run = bench_workload_bump },
+    { .name = "mixed",              .run = bench_workload_mixed,                .needs_free = true },
+    { .name = "producer_consumer",  .run = bench_workload_producer_consumer,    .needs_free = true, .is_threaded = true },
+};
+
+static bool bench_workload_supports(const BenchWorkload_t *workload, bench_allocator_kind_t kind)
+{
+    if (workload->needs_free && kind == BENCH_ALLOCATOR_BUMP) return false;
+    if (workload->is_threaded && kind == BENCH_ALLOCATOR_ARENA) return false;
+    return true;
+}
+
+
+
+// === DRIVER ====================================================================================================== //
+
+static BenchResult_t bench_run_in_process(const BenchWorkload_t *workload, bench_allocator_kind_t kind, size_t op_count)
+{
+    BenchAllocator_t allocator;
+    BenchTimer_t timer;
+    bench_allocator_create(&allocator, kind);
+    bench_timer_create(&timer, op_count);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    workload->run(&allocator, &timer, op_count, 42);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    bench_allocator_destroy(&allocator);
+
+    qsort(timer.batch_ns, timer.batch_count, sizeof(double), bench_compare_doubles);
+    BenchResult_t result = {
+        .op_count = op_count,
+        .ops_per_sec = (double)op_count / (bench_elapsed_ns(&start, &end) * 1e-9),
+        .ns_p50 = bench_percentile(timer.batch_ns, timer.batch_count, 0.50),
+        .ns_p90 = bench_percentile(timer.batch_ns, timer.batch_count, 0.90),
+        .ns_p99 = bench_percentile(timer.batch_ns, timer.batch_count, 0.99),
+        .ns_p999 = bench_percentile(timer.batch_ns, timer.batch_count, 0.999),
+        .peak_rss_kib = usage.ru_maxrss,
+    };
+    free(timer.batch_ns);
+    return result;
+}
+
+/* Runs the workload in a child process, which sends its result back through a pipe. */
+static bool bench_run(BenchResult_t *result, const BenchWorkload_t *workload, bench_allocator_kind_t kind, size_t op_count)
+{
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return false;
+    }
+    fflush(stdout);
+    const pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        const BenchResult_t child_result = bench_run_in_process(workload, kind, op_count);
+        const bool is_written = write(fds[1], &child_result, sizeof(child_result)) == (ssize_t)sizeof(child_result);
+        _exit(is_written ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    close(fds[1]);
+    const bool is_read = (pid > 0) && read(fds[0], result, sizeof(BenchResult_t)) == (ssize_t)sizeof(BenchResult_t);
+    close(fds[0]);
+    int status = 0;
+    if (pid > 0) waitpid(pid, &status, 0);
+    return is_read && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+}
+
+static void bench_print_usage(const char *program)
+{
+    fprintf(stderr, "usage: %s [--csv | --json] [--ops <count>] [--workload <name>]\n", program);
+}
+
+int main(int argc, char **argv)
+{
+    bool is_json = false;
+    size_t op_count = DEFAULT_OP_COUNT;
+    const char *workload_filter = NULL;
+    for (int arg_idx = 1; arg_idx < argc; ++arg_idx) {
+        if (strcmp(argv[arg_idx], "--json") == 0) {
+            is_json = true;
+        } else if (strcmp(argv[arg_idx], "--csv") == 0) {
+            is_json = false;
+        } else if (strcmp(argv[arg_idx], "--ops") == 0 && arg_idx + 1 < argc) {
+            op_count = strtoul(argv[++arg_idx], NULL, 10);
+        } else if (strcmp(argv[arg_idx], "--workload") == 0 && arg_idx + 1 < argc) {
+            workload_filter = argv[++arg_idx];
+        } else {
+            bench_print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    op_count = MYC_MAX(MYC_QUANTIZE_UP(op_count, 2 * BATCH_OP_COUNT), (size_t)(2 * BATCH_OP_COUNT));
+
+    if (is_json) {
+        printf("{\n  \"op_count\": %lu,\n  \"results\": [", op_count);
+    } else {
+        printf("workload,allocator,ops,ops_per_sec,ns_p50,ns_p90,ns_p99,ns_p999,peak_rss_kib\n");
+    }
+    bool is_first = true;
+    int exit_code = EXIT_SUCCESS;
+    for (size_t workload_idx = 0; workload_idx < sizeof(bench_workloads) / sizeof(bench_workloads[0]); ++workload_idx) {
+        const BenchWorkload_t *workload = &bench_workloads[workload_idx];
+        if (workload_filter != NULL && strcmp(workload_filter, workload->name) != 0) continue;
+
+        for (bench_allocator_kind_t kind = 0; kind < BENCH_ALLOCATOR_COUNT; ++kind) {
+            if (!bench_workload_supports(workload, kind)) continue;
+            BenchResult_t result;
+            if (!bench_run(&result, workload, kind, op_count)) {
+                MYC_LOG_ERROR("Workload '%s' failed on '%s'.", workload->name, bench_allocator_names[kind]);
+                exit_code = EXIT_FAILURE;
+                continue;
+            }
+            if (is_json) {
+                printf("%s\n    { \"workload\": \"%s\", \"allocator\": \"%s\", \"ops\": %lu, \"ops_per_sec\": %.0f, "
+                       "\"ns_p50\": %.1f, \"ns_p90\": %.1f, \"ns_p99\": %.1f, \"ns_p999\": %.1f, \"peak_rss_kib\": %ld }",
+                       is_first ? "" : ",", workload->name, bench_allocator_names[kind], result.op_count, result.ops_per_sec,
+                       result.ns_p50, result.ns_p90, result.ns_p99, result.ns_p999, result.peak_rss_kib);
+            } else {
+                printf("%s,%s,%lu,%.0f,%.1f,%.1f,%.1f,%.1f,%ld\n",
+                       workload->name, bench_allocator_names[kind], result.op_count, result.ops_per_sec,
+                       result.ns_p50, result.ns_p90, result.ns_p99, result.ns_p999, result.peak_rss_kib);
+            }
+            is_first = false;
+        }
+    }
+    if (is_json) {
+        printf("\n  ]\n}\n");
+    }
+    return exit_code;
+}
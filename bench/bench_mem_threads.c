@@ -0,0 +1,86 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "myc/core.h"
+#include "myc/memory.h"
+
+#define OPS_PER_THREAD 1000000
+#define LIVE_CHUNK_COUNT 64
+#define MAX_THREAD_COUNT 16
+#define MIN_CHUNK_SIZE 272      // Above the small object sizes, so the chunk magazines and region locks are exercised.
+#define MAX_CHUNK_SIZE 1280
+
+typedef struct BenchContext {
+    MycMemArena_t *arena;
+    pthread_mutex_t *global_lock;   // Only set for the single lock baseline.
+    unsigned int seed;
+} BenchContext_t;
+
+static void* bench_thread(void *arg)
+{
+    BenchContext_t *ctx = arg;
+    void *chunks[LIVE_CHUNK_COUNT] = { 0 };
+    for (size_t i = 0; i < OPS_PER_THREAD; ++i) {
+        const size_t chunk_idx = rand_r(&ctx->seed) % LIVE_CHUNK_COUNT;
+        if (ctx->global_lock != NULL) pthread_mutex_lock(ctx->global_lock);
+        if (chunks[chunk_idx] == NULL) {
+            chunks[chunk_idx] = myc_mem_arena_malloc(ctx->arena, MIN_CHUNK_SIZE + rand_r(&ctx->seed) % (MAX_CHUNK_SIZE - MIN_CHUNK_SIZE));
+        } else {
+            myc_mem_arena_free(chunks[chunk_idx]);
+            chunks[chunk_idx] = NULL;
+        }
+        if (ctx->global_lock != NULL) pthread_mutex_unlock(ctx->global_lock);
+    }
+
+    for (size_t chunk_idx = 0; chunk_idx < LIVE_CHUNK_COUNT; ++chunk_idx) {
+        if (chunks[chunk_idx] == NULL) continue;
+        if (ctx->global_lock != NULL) pthread_mutex_lock(ctx->global_lock);
+        myc_mem_arena_free(chunks[chunk_idx]);
+        if (ctx->global_lock != NULL) pthread_mutex_unlock(ctx->global_lock);
+    }
+    return NULL;
+}
+
+static double bench_run(myc_mem_arena_flags_t flags, size_t thread_count)
+{
+    MycMemArena_t *arena;
+    if (myc_mem_arena_create_with_flags(&arena, 64 * 1024 * 1024, flags) != MYC_SUCCESS) {
+        MYC_LOG_ERROR("Could not create memory arena.");
+        exit(EXIT_FAILURE);
+    }
+    pthread_mutex_t global_lock = PTHREAD_MUTEX_INITIALIZER;
+    pthread_t threads[MAX_THREAD_COUNT];
+    BenchContext_t contexts[MAX_THREAD_COUNT];
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < thread_count; ++i) {
+        contexts[i] = (BenchContext_t){ 
+            .arena = arena, 
+            .global_lock = (flags & MYC_MEM_ARENA_FLAG_THREAD_SAFE) ? NULL : &global_lock, 
+            .seed = (unsigned int)i + 1,
+        };
+        pthread_create(&threads[i], NULL, bench_thread, &contexts[i]);
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    myc_mem_arena_destroy(arena);
+    const double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) * 1e-9;
+    return (double)(thread_count * OPS_PER_THREAD) / seconds;
+}
+
+int main(void)
+{
+    printf("threads, global lock (Mops/s), thread safe arena (Mops/s)\n");
+    for (size_t thread_count = 1; thread_count <= MAX_THREAD_COUNT; thread_count *= 2) {
+        const double locked_ops = bench_run(MYC_MEM_ARENA_FLAG_NONE, thread_count);
+        const double shared_ops = bench_run(MYC_MEM_ARENA_FLAG_THREAD_SAFE, thread_count);
+        printf("%7lu, %18.2f, %26.2f\n", thread_count, locked_ops * 1e-6, shared_ops * 1e-6);
+    }
+    return 0;
+}
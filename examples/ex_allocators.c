@@ -1,6 +1,84 @@
+#include <pthread.h>
+
 #include "myc/core.h"
 #include "myc/memory.h"
 
+static void* fill_concurrent_bump_alloc(void *bump_alloc)
+{
+    for (size_t i = 0; i < 100; ++i) {
+        myc_mem_bump_malloc(bump_alloc, 64);
+    }
+    return NULL;
+}
+
+static void run_concurrent_bump_alloc_example(void)
+{
+    MycMemArena_t *shared_arena;
+    if (myc_mem_arena_create_with_flags(&shared_arena, 30000, MYC_MEM_ARENA_FLAG_THREAD_SAFE) != MYC_SUCCESS) {
+        MYC_LOG_ERROR("Could not create thread safe memory arena.");
+        return;
+    }
+    MycMemBumpAlloc_t *bump_alloc;
+    if (myc_mem_bump_alloc_create_with_flags(&bump_alloc, shared_arena, 4000, MYC_MEM_BUMP_ALLOC_FLAG_CONCURRENT) != MYC_SUCCESS) {
+        MYC_LOG_ERROR("Could not create concurrent bump allocator.");
+        myc_mem_arena_destroy(shared_arena);
+        return;
+    }
+
+    MYC_LOG_INFO("Concurrent bump allocations of 4x100x64 bytes (grows past its initial 4000 bytes)");
+    pthread_t threads[4];
+    for (size_t i = 0; i < 4; ++i) {
+        pthread_create(&threads[i], NULL, fill_concurrent_bump_alloc, bump_alloc);
+    }
+    for (size_t i = 0; i < 4; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    myc_mem_arena_introspect(shared_arena);
+    myc_mem_bump_alloc_reset(bump_alloc);
+    MYC_LOG("free size after reset: %u bytes", myc_mem_bump_alloc_get_free_size(bump_alloc));
+
+    myc_mem_bump_alloc_destroy(bump_alloc);
+    myc_mem_arena_destroy(shared_arena);
+}
+
+static void run_growing_bump_alloc_example(MycMemArena_t *arena)
+{
+    MycMemBumpAlloc_t *bump_alloc;
+    if (myc_mem_bump_alloc_create_with_flags(&bump_alloc, arena, 1000, MYC_MEM_BUMP_ALLOC_FLAG_GROW) != MYC_SUCCESS) {
+        MYC_LOG_ERROR("Could not create growing bump allocator.");
+        return;
+    }
+    myc_mem_bump_alloc_set_node_size_max(bump_alloc, 8192);
+
+    MYC_LOG_INFO("Growing bump allocations of 40x200 bytes and one oversized allocation of 5000 bytes");
+    for (size_t i = 0; i < 40; ++i) {
+        myc_mem_bump_malloc(bump_alloc, 200);
+    }
+    MYC_LOG("addr: %p", myc_mem_bump_malloc(bump_alloc, 5000));
+    myc_mem_arena_introspect(arena);
+
+    MYC_LOG_INFO("Trimming reset after a cycle of only 4x200 bytes");
+    myc_mem_bump_alloc_reset(bump_alloc);
+    for (size_t i = 0; i < 4; ++i) {
+        myc_mem_bump_malloc(bump_alloc, 200);
+    }
+    myc_mem_bump_alloc_reset_trim(bump_alloc);
+    myc_mem_arena_introspect(arena);
+
+    MYC_LOG_INFO("Scratch allocations rewound at scope exit reuse the same memory");
+    for (size_t i = 0; i < 3; ++i) {
+        MYC_MEM_BUMP_ALLOC_SCOPE(bump_alloc) {
+            MYC_LOG("addr: %p", myc_mem_bump_malloc(bump_alloc, 300));
+        }
+    }
+    MycMemBumpAllocMark_t mark = myc_mem_bump_alloc_mark(bump_alloc);
+    myc_mem_bump_malloc(bump_alloc, 600);
+    myc_mem_bump_alloc_rewind(bump_alloc, mark);
+    MYC_LOG("free size after rewind: %u bytes", myc_mem_bump_alloc_get_free_size(bump_alloc));
+
+    myc_mem_bump_alloc_destroy(bump_alloc);
+}
+
 int main(void)
 {
     myc_err_t exit_code;
@@ -40,6 +118,42 @@ int main(void)
         MYC_LOG("addr: %p", myc_mem_bump_aligned_malloc(bump_alloc, 17 * i, 16));
     }
 
+    MycMemPoolAlloc_t *pool_alloc;
+    if ((exit_code = myc_mem_pool_alloc_create(&pool_alloc, arena, 24)) != MYC_SUCCESS) {
+        MYC_LOG_ERROR("Could not create pool allocator.");
+        goto _exit;
+    }
+    MYC_LOG_INFO("Pool allocations of %u bytes", myc_mem_pool_alloc_get_object_size(pool_alloc));
+    void *objects[5];
+    for (size_t i = 0; i < 5; ++i) {
+        objects[i] = myc_mem_pool_malloc(pool_alloc);
+        MYC_LOG("addr: %p", objects[i]);
+    }
+    myc_mem_pool_free(pool_alloc, objects[1]);
+    myc_mem_pool_free(pool_alloc, objects[3]);
+    MYC_LOG("Freed the second and fourth object, which are reused first:");
+    MYC_LOG("addr: %p", myc_mem_pool_malloc(pool_alloc));
+    MYC_LOG("addr: %p", myc_mem_pool_malloc(pool_alloc));
+    myc_mem_arena_introspect(arena);
+    myc_mem_pool_alloc_destroy(pool_alloc);
+
+    MycMemFrameAlloc_t *frame_alloc;
+    if ((exit_code = myc_mem_frame_alloc_create(&frame_alloc, arena, 1000)) != MYC_SUCCESS) {
+        MYC_LOG_ERROR("Could not create frame allocator.");
+        goto _exit;
+    }
+    for (size_t frame = 0; frame < 4; ++frame) {
+        myc_mem_frame_alloc_begin_frame(frame_alloc);
+        MYC_LOG_INFO("Frame %lu allocations", frame);
+        for (size_t i = 1; i < 4; ++i) {
+            MYC_LOG("addr: %p", myc_mem_frame_malloc(frame_alloc, 100 * i));
+        }
+    }
+    myc_mem_frame_alloc_destroy(frame_alloc);
+
+    run_growing_bump_alloc_example(arena);
+    run_concurrent_bump_alloc_example();
+
 _exit:
     myc_mem_arena_destroy(arena);
     return exit_code;
@@ -1,3 +1,5 @@
+#include <time.h>
+
 #include "myc/assert.h"
 #include "myc/log.h"
 
@@ -21,5 +23,40 @@ int main(void)
     MYC_UNREACHABLE("For example we had a return right above this line.");
     #undef abort
 
+    /* Asynchronous logging only formats the lines, a background thread writes them out. */
+    if (myc_log_async_start(MYC_LOG_ASYNC_DEFAULT_RING_SIZE, MYC_LOG_ASYNC_FULL_BLOCK) == MYC_SUCCESS) {
+        for (int i = 0; i < 3; ++i) {
+            MYC_LOG_INFO("I am asynchronous log message number %d", i);
+        }
+        myc_log_async_stop();
+    }
+
+    /* A burst which fills a small ring up to its last byte, 32 records of 128 bytes, followed by a few more lines 
+    once the writer caught up. Every line must show up exactly once. */
+    if (myc_log_async_start(4096, MYC_LOG_ASYNC_FULL_BLOCK) == MYC_SUCCESS) {
+        for (int i = 0; i < 32 + 8; ++i) {
+            if (i == 32) {
+                nanosleep(&(struct timespec){ .tv_sec = 0, .tv_nsec = 20000000 }, NULL);
+            }
+            MYC_LOG("%0115d", i);
+        }
+        myc_log_async_stop();
+    }
+
+    /* Runtime levels only silence call sites further, they are also read from the environment variable MYC_LOG_LEVEL,
+    e.g. MYC_LOG_LEVEL="error,*ex_log.c=debug". */
+    myc_log_set_level(MYC_LOG_LEVEL_ERROR);
+    MYC_LOG_INFO("I am not logged anymore.");
+    myc_log_set_module_level("*ex_log.c", MYC_LOG_LEVEL_INFO);
+    MYC_LOG_INFO("But this file may log info messages again.");
+    MYC_LOG_DEBUG("Debug messages are still off here.");
+
+    /* Hot paths can limit how often a call site logs, suppressed calls are counted and reported with the next line. */
+    for (int i = 0; i < 1000; ++i) {
+        MYC_LOG_WARN_ONCE("Retrying failed, this is only reported once.");
+        MYC_LOG_WARN_EVERY_N(400, "Retry number %d failed.", i);
+        MYC_LOG_WARN_RATELIMIT(2, "Allocation number %d failed.", i);
+    }
+
     return 0;
 }
\ No newline at end of file
@@ -1,3 +1,5 @@
+#include <string.h>
+
 #include "myc/core.h"
 #include "myc/memory.h"
 
@@ -40,10 +42,37 @@ int main(void)
     MYC_LOG_INFO("Reallocated three addresses and reverted one relocation.");
     myc_mem_arena_introspect(arena);
 
+    MycMemArenaStats_t stats;
+    myc_mem_arena_get_stats(arena, &stats);
+    MYC_LOG_INFO("%lu allocations, %lu frees, %lu reallocations in place and %lu moved. %lu bytes in use, fragmentation %.2f.", 
+                 stats.malloc_count, stats.free_count, stats.realloc_in_place_count, stats.realloc_move_count, 
+                 stats.used_size, stats.fragmentation);
+
     myc_mem_arena_reset(arena);
     MYC_LOG_INFO("Reset the memory arena.");
     myc_mem_arena_introspect(arena);
 
+    /* Purging gives the free tails between chunks back to the OS, however small they are, as long as they span a page. */
+    MycMemArena_t *purge_arena;
+    if ((exit_code = myc_mem_arena_create(&purge_arena, 64u << 20)) != MYC_SUCCESS) {
+        MYC_LOG_ERROR("Could not create memory arena.");
+        goto _exit;
+    }
+    void *chunks[600];
+    size_t chunk_count = 0;
+    while (chunk_count < 600 && (chunks[chunk_count] = myc_mem_arena_malloc(purge_arena, 100000)) != MYC_MEM_ALLOC_FAILED) {
+        memset(chunks[chunk_count++], 0xAB, 100000);
+    }
+    for (size_t i = 0; i < chunk_count; i += 2) {
+        myc_mem_arena_free(chunks[i]);
+    }
+    const size_t resident_size = myc_mem_arena_get_resident_size(purge_arena);
+    myc_mem_arena_purge(purge_arena);
+    const size_t purged_size = resident_size - myc_mem_arena_get_resident_size(purge_arena);
+    MYC_LOG_INFO("Purged %lu of %lu resident bytes after freeing every other chunk.", purged_size, resident_size);
+    MYC_ASSERT(purged_size >= (chunk_count / 2) * (100000 - 8192), "Purging must release the interior of every free tail.");
+    myc_mem_arena_destroy(purge_arena);
+
 _exit:
     myc_mem_arena_destroy(arena);
     return exit_code;
@@ -1,6 +1,8 @@
 #ifndef _MYC_LOG_H_
 #define _MYC_LOG_H_
 
+#include "myc/types.h"
+
 #ifndef __FUNC_NAME__
 #if __STDC_VERSION__ >= 199901L
     #define __FUNC_NAME__ __func__
@@ -23,9 +25,280 @@
 
 
 
+// === ASYNCHRONOUS LOGGING ======================================================================================== //
+
+#define MYC_LOG_ASYNC_DEFAULT_RING_SIZE (1u << 20)
+
+/* Behaviour of asynchronous logging once the ring is full. */
+typedef enum MycLogAsyncFullPolicy {
+    /* Lines are dropped and counted, the writer thread reports how many were lost. */
+    MYC_LOG_ASYNC_FULL_DROP = 0,
+    /* Logging threads wait until the writer thread made enough room. */
+    MYC_LOG_ASYNC_FULL_BLOCK,
+} myc_log_async_full_policy_t;
+
+/* Starts logging asynchronously: log calls only format their line into a ring of 'ring_size' bytes, which a background
+thread writes to stderr in batches. 'full_policy' decides what happens to lines which do not fit into the ring.
+Assertion failures are still written synchronously, after all pending lines. */
+myc_err_t myc_log_async_start(size_t ring_size, myc_log_async_full_policy_t full_policy);
+/* Writes out all pending lines and goes back to logging synchronously.
+!!NOTE: No other thread may log during this call. Lines still pending at exit are lost without it. */
+void myc_log_async_stop(void);
+/* Blocks until every line logged before this call has been written out. */
+void myc_log_flush(void);
+/* Returns the number of lines dropped because the ring was full, since asynchronous logging was started. */
+uint64_t myc_log_async_get_dropped_count(void);
+
+
+
+// === BINARY LOGGING ============================================================================================== //
+
+/* Binary logs are a 'MycLogBinaryHeader_t' followed by entries, which all start with a 'MycLogBinaryEntry_t' and are
+padded to a multiple of 8 bytes. A site entry describes a log call site the first time it logs: it is followed by
+the argument types (one byte each), then label, function name, file path and message format as NUL terminated strings.
+A line entry is followed by one 8 byte slot per argument, where strings store their length instead, followed by the
+bytes of all string arguments in order, each NUL terminated and padded to a multiple of 8 bytes. */
+#define MYC_LOG_BINARY_MAGIC 0x31474F4C43594D00ull
+#define MYC_LOG_BINARY_VERSION 2
+#define MYC_LOG_BINARY_STRING_SIZE(LENGTH) (((LENGTH) + 8) & ~(uint64_t)7)
+#define MYC_LOG_BINARY_ARG_COUNT_MAX 16
+
+typedef struct MycLogBinaryHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t reserved;
+} MycLogBinaryHeader_t;
+
+typedef enum MycLogBinaryEntryKind {
+    MYC_LOG_BINARY_ENTRY_SITE = 1,
+    MYC_LOG_BINARY_ENTRY_LINE,
+} myc_log_binary_entry_kind_t;
+
+typedef struct MycLogBinaryEntry {
+    uint32_t size;          // Including this header and the padding.
+    uint16_t kind;
+    uint16_t arg_count;
+    uint32_t site_id;
+    int32_t line_nr;        // Only set for site entries.
+} MycLogBinaryEntry_t;
+
+typedef enum MycLogArgType {
+    MYC_LOG_ARG_INT = 0,
+    MYC_LOG_ARG_UINT,
+    MYC_LOG_ARG_DOUBLE,
+    MYC_LOG_ARG_STRING,
+    MYC_LOG_ARG_POINTER,
+} myc_log_arg_type_t;
+
+/* Starts logging in binary form to the file at 'path': log calls only record their call site once and the raw bytes
+of their arguments, the lines are formatted offline by the 'log-decode' tool. Entries are written by the background
+thread of asynchronous logging (see 'myc_log_async_start'), with a ring of 'ring_size' bytes.
+Log calls with more than MYC_LOG_BINARY_ARG_COUNT_MAX arguments do not compile. */
+myc_err_t myc_log_binary_start(const char *path, size_t ring_size, myc_log_async_full_policy_t full_policy);
+/* Writes out all pending entries, closes the binary log and goes back to logging synchronously.
+!!NOTE: No other thread may log during this call. */
+void myc_log_binary_stop(void);
+
+// === RUNTIME LOG LEVELS ========================================================================================== //
+
+/* Levels match the compile-time ceiling '_MYC_LOG_LEVEL': log calls above it do not even compile, the runtime level can
+only lower verbosity further. */
+typedef enum MycLogLevel {
+    MYC_LOG_LEVEL_NONE = 0,
+    MYC_LOG_LEVEL_ERROR,        // MYC_LOG and MYC_LOG_ERROR.
+    MYC_LOG_LEVEL_INFO,         // MYC_LOG_WARN and MYC_LOG_INFO.
+    MYC_LOG_LEVEL_DEBUG,        // MYC_LOG_TRACE, MYC_LOG_DEBUG and MYC_LOG_TODO.
+} myc_log_level_t;
+
+/* Name of the environment variable which configures the levels at startup, see 'myc_log_configure'. */
+#define MYC_LOG_LEVEL_ENV "MYC_LOG_LEVEL"
+
+/* Call sites belong to the module named by MYC_LOG_MODULE, if it is defined before this header is included. */
+#ifndef MYC_LOG_MODULE
+    #define MYC_LOG_MODULE NULL
+#endif
+
+/* Sets the level of all call sites not matched by a module level. */
+void myc_log_set_level(myc_log_level_t level);
+/* Sets the level of all call sites whose module name or file path matches 'pattern', a glob as understood by fnmatch.
+When several patterns match a site, the one set last wins. Setting a pattern again replaces its level. */
+myc_err_t myc_log_set_module_level(const char *pattern, myc_log_level_t level);
+/* Applies a comma separated list of levels, e.g. "info,memory=debug,src/log.c=0". An entry without pattern sets the
+level of all call sites, levels are given by number or name (none, error, info, debug). Entries before an invalid one
+are still applied. The value of the environment variable MYC_LOG_LEVEL_ENV is applied this way before the first call
+site logs. */
+myc_err_t myc_log_configure(const char *config);
+
+
+
+// === CALL SITES ================================================================================================== //
+
+typedef enum MycLogLabel {
+    MYC_LOG_LABEL_NONE = 0,
+    MYC_LOG_LABEL_ERROR,
+    MYC_LOG_LABEL_TRACE,
+    MYC_LOG_LABEL_WARN,
+    MYC_LOG_LABEL_INFO,
+    MYC_LOG_LABEL_DEBUG,
+    MYC_LOG_LABEL_TODO,
+    MYC_LOG_LABEL_COUNT,
+} myc_log_label_t;
+
+/* Static description of a log call site, registered with the binary log the first time the site logs. */
+typedef struct MycLogSite {
+    const char *func_name;
+    const char *file_path;
+    const char *message_fmt;
+    const char *module_name;
+    const uint8_t *arg_types;
+    int32_t line_nr;
+    uint16_t label;
+    uint16_t arg_count;
+    uint16_t string_mask;       // Arguments recorded as strings, derived from the message format once the site registers.
+    uint32_t level_cache;       // Level generation the site was last resolved in, with the lowest bit set if enabled.
+    uint64_t registration;      // Binary log session in the upper and site id in the lower half.
+} MycLogSite_t;
+
+/* Static state of a rate limited or sampled call site. */
+typedef struct MycLogLimit {
+    uint64_t state;             // Every n: calls so far. Rate limit: window second in the upper, lines in it in the lower half.
+    uint64_t suppressed_count;  // Calls suppressed since the site last logged, only kept by the rate limit.
+} MycLogLimit_t;
+
+typedef union MycLogArg {
+    int64_t i;
+    uint64_t u;
+    double d;
+    const char *s;
+    const void *p;
+} MycLogArg_t;
+
+extern uint32_t _myc_private_log_binary_session;    // Zero while not logging in binary form.
+extern uint32_t _myc_private_log_level_generation;  // Even, advanced by two whenever a level changes.
+
+void _myc_private_log_binary(MycLogSite_t *site, const MycLogArg_t *args);
+bool _myc_private_log_site_resolve(MycLogSite_t *site);
+bool _myc_private_log_limit_rate(MycLogLimit_t *limit, uint32_t per_sec, uint64_t *suppressed_count);
+
+/* A site disabled in the current level generation only costs this first comparison. Sites which were not resolved in
+the current generation yet look up their level once. */
+static inline bool _myc_private_log_site_is_enabled(MycLogSite_t *site)
+{
+    const uint32_t generation = __atomic_load_n(&_myc_private_log_level_generation, __ATOMIC_RELAXED);
+    const uint32_t level_cache = __atomic_load_n(&site->level_cache, __ATOMIC_RELAXED);
+    if (level_cache == generation) {
+        return false;
+    }
+    return level_cache == (generation | 1) || _myc_private_log_site_resolve(site);
+}
+
+static inline bool _myc_private_log_limit_once(MycLogLimit_t *limit, uint64_t unused, uint64_t *suppressed_count)
+{
+    (void)unused;
+    (void)suppressed_count;
+    return __atomic_load_n(&limit->state, __ATOMIC_RELAXED) == 0 && __atomic_exchange_n(&limit->state, 1, __ATOMIC_RELAXED) == 0;
+}
+
+static inline bool _myc_private_log_limit_every_n(MycLogLimit_t *limit, uint64_t n, uint64_t *suppressed_count)
+{
+    const uint64_t call_idx = __atomic_fetch_add(&limit->state, 1, __ATOMIC_RELAXED);
+    if (n > 1 && call_idx % n != 0) {
+        return false;
+    }
+    *suppressed_count = (call_idx != 0 && n > 1) ? n - 1 : 0;
+    return true;
+}
+
+static inline MycLogArg_t _myc_private_log_arg_int(int64_t x) { return (MycLogArg_t){ .i = x }; }
+static inline MycLogArg_t _myc_private_log_arg_uint(uint64_t x) { return (MycLogArg_t){ .u = x }; }
+static inline MycLogArg_t _myc_private_log_arg_double(double x) { return (MycLogArg_t){ .d = x }; }
+static inline MycLogArg_t _myc_private_log_arg_string(const char *x) { return (MycLogArg_t){ .s = x }; }
+static inline MycLogArg_t _myc_private_log_arg_pointer(const void *x) { return (MycLogArg_t){ .p = x }; }
+
+/* Arguments are recorded by their C type. Only character pointers and other pointers are told apart by the conversion
+of the message format, so a 'char*' logged with '%p' is recorded as a pointer and any pointer logged with '%s' as a
+string. Conversions must otherwise match the C type of their argument, like printf expects anyway. */
+#define _MYC_LOG_GENERIC(X, INT, UINT, DOUBLE, STRING, POINTER)                                                         \
+    _Generic((X),                                                                                                       \
+        char: INT, signed char: INT, short: INT, int: INT, long: INT, long long: INT,                                   \
+        _Bool: UINT, unsigned char: UINT, unsigned short: UINT, unsigned int: UINT, unsigned long: UINT,                \
+        unsigned long long: UINT, float: DOUBLE, double: DOUBLE, long double: DOUBLE,                                   \
+        char*: STRING, const char*: STRING, default: POINTER)
+
+#define _MYC_LOG_ARG_TYPE(X) _MYC_LOG_GENERIC(X, MYC_LOG_ARG_INT, MYC_LOG_ARG_UINT, MYC_LOG_ARG_DOUBLE, MYC_LOG_ARG_STRING, MYC_LOG_ARG_POINTER)
+#define _MYC_LOG_ARG(X)                                                                                                 \
+    _MYC_LOG_GENERIC(X, _myc_private_log_arg_int, _myc_private_log_arg_uint, _myc_private_log_arg_double,               \
+            _myc_private_log_arg_string, _myc_private_log_arg_pointer)(X)
+
+/* Counts the arguments following the message format. */
+#define _MYC_LOG_ARG_COUNT(...) _MYC_LOG_ARG_COUNT_(__VA_ARGS__, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define _MYC_LOG_ARG_COUNT_(MESSAGE_FMT, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, ARG_COUNT, ...) ARG_COUNT
+
+#define _MYC_LOG_MAP_0(M, ...)
+#define _MYC_LOG_MAP_1(M, A, ...) M(A),
+#define _MYC_LOG_MAP_2(M, A, ...) M(A), _MYC_LOG_MAP_1(M, __VA_ARGS__)
+#define _MYC_LOG_MAP_3(M, A, ...) M(A), _MYC_LOG_MAP_2(M, __VA_ARGS__)
+#define _MYC_LOG_MAP_4(M, A, ...) M(A), _MYC_LOG_MAP_3(M, __VA_ARGS__)
+#define _MYC_LOG_MAP_5(M, A, ...) M(A), _MYC_LOG_MAP_4(M, __VA_ARGS__)
+#define _MYC_LOG_MAP_6(M, A, ...) M(A), _MYC_LOG_MAP_5(M, __VA_ARGS__)
+#define _MYC_LOG_MAP_7(M, A, ...) M(A), _MYC_LOG_MAP_6(M, __VA_ARGS__)
+#define _MYC_LOG_MAP_8(M, A, ...) M(A), _MYC_LOG_MAP_7(M, __VA_ARGS__)
+#define _MYC_LOG_MAP_9(M, A, ...) M(A), _MYC_LOG_MAP_8(M, __VA_ARGS__)
+#define _MYC_LOG_MAP_10(M, A, ...) M(A), _MYC_LOG_MAP_9(M, __VA_ARGS__)
+#define _MYC_LOG_MAP_11(M, A, ...) M(A), _MYC_LOG_MAP_10(M, __VA_ARGS__)
+#define _MYC_LOG_MAP_12(M, A, ...) M(A), _MYC_LOG_MAP_11(M, __VA_ARGS__)
+#define _MYC_LOG_MAP_13(M, A, ...) M(A), _MYC_LOG_MAP_12(M, __VA_ARGS__)
+#define _MYC_LOG_MAP_14(M, A, ...) M(A), _MYC_LOG_MAP_13(M, __VA_ARGS__)
+#define _MYC_LOG_MAP_15(M, A, ...) M(A), _MYC_LOG_MAP_14(M, __VA_ARGS__)
+#define _MYC_LOG_MAP_16(M, A, ...) M(A), _MYC_LOG_MAP_15(M, __VA_ARGS__)
+
+/* Logs through 'TEXT_FUNC', or records the call site and arguments while logging in binary form. Nothing is evaluated
+while the site is disabled by its runtime level, the arguments are only evaluated if 'GATE' is true as well. */
+#define _MYC_LOG_AT_SITE(LABEL, TEXT_FUNC, ...) _MYC_LOG_AT_SITE_IF(LABEL, TEXT_FUNC, true, __VA_ARGS__)
+#define _MYC_LOG_AT_SITE_IF(LABEL, TEXT_FUNC, GATE, ...)                                                                \
+    _MYC_LOG_AT_SITE_(LABEL, TEXT_FUNC, GATE, _MYC_LOG_ARG_COUNT(__VA_ARGS__), __VA_ARGS__)
+#define _MYC_LOG_AT_SITE_(LABEL, TEXT_FUNC, GATE, ARG_COUNT, ...) _MYC_LOG_AT_SITE__(LABEL, TEXT_FUNC, GATE, ARG_COUNT, __VA_ARGS__)
+#define _MYC_LOG_AT_SITE__(LABEL, TEXT_FUNC, GATE, ARG_COUNT, MESSAGE_FMT, ...)                                         \
+    do {                                                                                                                \
+        static const uint8_t _myc_log_arg_types[] = { _MYC_LOG_MAP_##ARG_COUNT(_MYC_LOG_ARG_TYPE, __VA_ARGS__) 0 };    \
+        static MycLogSite_t _myc_log_site = {                                                                           \
+            .func_name = __FUNC_NAME__, .file_path = __FILE__, .message_fmt = MESSAGE_FMT,                              \
+            .module_name = MYC_LOG_MODULE, .arg_types = _myc_log_arg_types, .line_nr = __LINE__,                        \
+            .label = LABEL, .arg_count = ARG_COUNT,                                                                     \
+        };                                                                                                              \
+        if (_myc_private_log_site_is_enabled(&_myc_log_site) && (GATE)) {                                               \
+            if (__builtin_expect(__atomic_load_n(&_myc_private_log_binary_session, __ATOMIC_RELAXED) != 0, 0)) {        \
+                const MycLogArg_t _myc_log_args[] = { _MYC_LOG_MAP_##ARG_COUNT(_MYC_LOG_ARG, __VA_ARGS__) { 0 } };     \
+                _myc_private_log_binary(&_myc_log_site, _myc_log_args);                                                 \
+            } else {                                                                                                    \
+                TEXT_FUNC(__FUNC_NAME__, __FILE__, __LINE__, MESSAGE_FMT, ##__VA_ARGS__);                               \
+            }                                                                                                           \
+        }                                                                                                               \
+    } while (0)
+
+#define _myc_private_log_plain(FUNC_NAME, FILE_PATH, LINE_NR, ...) _myc_private_log(__VA_ARGS__)
+
+/* Logs at a site whose calls pass 'LIMIT_FUNC' first, which gets the static state of the site and 'LIMIT'. Suppressed
+calls are never formatted, their count is logged right after the next line of the site. */
+#define _MYC_LOG_LIMITED(LABEL, TEXT_FUNC, LIMIT_FUNC, LIMIT, ...)                                                      \
+    do {                                                                                                                \
+        static MycLogLimit_t _myc_log_limit;                                                                            \
+        uint64_t _myc_log_suppressed_count = 0;                                                                         \
+        _MYC_LOG_AT_SITE_IF(LABEL, TEXT_FUNC,                                                                           \
+                LIMIT_FUNC(&_myc_log_limit, (LIMIT), &_myc_log_suppressed_count), __VA_ARGS__);                         \
+        if (_myc_log_suppressed_count != 0) {                                                                           \
+            _MYC_LOG_AT_SITE(MYC_LOG_LABEL_NONE, _myc_private_log_plain,                                                \
+                    "Suppressed %lu messages of this call site since it last logged.", _myc_log_suppressed_count);      \
+        }                                                                                                               \
+    } while (0)
+
+
+
 #if _MYC_LOG_LEVEL > 0
-    #define MYC_LOG(...)        _myc_private_log(__VA_ARGS__)
-    #define MYC_LOG_ERROR(...)  _myc_private_log_error(__FUNC_NAME__, __FILE__, __LINE__, __VA_ARGS__)
+    #define MYC_LOG(...)        _MYC_LOG_AT_SITE(MYC_LOG_LABEL_NONE, _myc_private_log_plain, __VA_ARGS__)
+    #define MYC_LOG_ERROR(...)  _MYC_LOG_AT_SITE(MYC_LOG_LABEL_ERROR, _myc_private_log_error, __VA_ARGS__)
+    /* Logs only the first time the call site is reached. */
+    #define MYC_LOG_ONCE(...)   _MYC_LOG_LIMITED(MYC_LOG_LABEL_NONE, _myc_private_log_plain, _myc_private_log_limit_once, 0, __VA_ARGS__)
 
     __attribute__((format(printf, 1, 2)))
     void _myc_private_log(const char *message_fmt, ...);
@@ -35,13 +308,24 @@
 #else
     #define MYC_LOG(...)
     #define MYC_LOG_ERROR(...)
+    #define MYC_LOG_ONCE(...)
 #endif // _MYC_LOG_LEVEL > 0
 
 
 
 #if _MYC_LOG_LEVEL > 1
-    #define MYC_LOG_WARN(...) _myc_private_log_warn(__FUNC_NAME__, __FILE__, __LINE__, __VA_ARGS__)
-    #define MYC_LOG_INFO(...) _myc_private_log_info(__FUNC_NAME__, __FILE__, __LINE__, __VA_ARGS__)
+    #define MYC_LOG_WARN(...) _MYC_LOG_AT_SITE(MYC_LOG_LABEL_WARN, _myc_private_log_warn, __VA_ARGS__)
+    #define MYC_LOG_INFO(...) _MYC_LOG_AT_SITE(MYC_LOG_LABEL_INFO, _myc_private_log_info, __VA_ARGS__)
+
+    /* Variants of MYC_LOG_WARN for hot paths: the first only logs the first time the call site is reached, the second
+    every 'N'th time, the third at most 'PER_SEC' times per second. Suppressed calls do not evaluate their arguments.
+    !!NOTE: The rate limit counts whole seconds of a coarse monotonic clock, a burst may span two of them. */
+    #define MYC_LOG_WARN_ONCE(...)                                                                                      \
+        _MYC_LOG_LIMITED(MYC_LOG_LABEL_WARN, _myc_private_log_warn, _myc_private_log_limit_once, 0, __VA_ARGS__)
+    #define MYC_LOG_WARN_EVERY_N(N, ...)                                                                                \
+        _MYC_LOG_LIMITED(MYC_LOG_LABEL_WARN, _myc_private_log_warn, _myc_private_log_limit_every_n, N, __VA_ARGS__)
+    #define MYC_LOG_WARN_RATELIMIT(PER_SEC, ...)                                                                        \
+        _MYC_LOG_LIMITED(MYC_LOG_LABEL_WARN, _myc_private_log_warn, _myc_private_log_limit_rate, PER_SEC, __VA_ARGS__)
 
     __attribute__((format(printf, 4, 5)))
     void _myc_private_log_warn(const char *func_name, const char *file_path, int line_nr, const char *msg_fmt, ...);
@@ -51,14 +335,17 @@
 #else
     #define MYC_LOG_WARN(...) 
     #define MYC_LOG_INFO(...)       
+    #define MYC_LOG_WARN_ONCE(...)
+    #define MYC_LOG_WARN_EVERY_N(N, ...)
+    #define MYC_LOG_WARN_RATELIMIT(PER_SEC, ...)
 #endif // _MYC_LOG_LEVEL > 1
 
 
 
 #if _MYC_LOG_LEVEL > 2
-    #define MYC_LOG_TRACE(...) _myc_private_log_trace(__FUNC_NAME__, __FILE__, __LINE__, __VA_ARGS__)
-    #define MYC_LOG_DEBUG(...) _myc_private_log_debug(__FUNC_NAME__, __FILE__, __LINE__, __VA_ARGS__)
-    #define MYC_LOG_TODO(...)  _myc_private_log_todo(__FUNC_NAME__, __FILE__, __LINE__, __VA_ARGS__)
+    #define MYC_LOG_TRACE(...) _MYC_LOG_AT_SITE(MYC_LOG_LABEL_TRACE, _myc_private_log_trace, __VA_ARGS__)
+    #define MYC_LOG_DEBUG(...) _MYC_LOG_AT_SITE(MYC_LOG_LABEL_DEBUG, _myc_private_log_debug, __VA_ARGS__)
+    #define MYC_LOG_TODO(...)  _MYC_LOG_AT_SITE(MYC_LOG_LABEL_TODO, _myc_private_log_todo, __VA_ARGS__)
 
     __attribute__((format(printf, 4, 5)))
     void _myc_private_log_trace(const char *func_name, const char *file_path, int line_nr, const char *msg_fmt, ...);
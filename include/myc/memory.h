@@ -12,42 +12,191 @@
 /* Opaque handle representing a memory arena. */
 typedef struct _MycMemoryArena MycMemArena_t;
 
+/* Size type of the arena API. Defining MYC_MEM_ARENA_64BIT (i.e. building with 'make MEM64=1') allows regions and 
+single allocations beyond 4 GiB, while arenas keep the same compact layout as with 32 bit sizes.
+!!NOTE: MYC_MEM_ARENA_64BIT has to be defined identically for the library and all code using it. */
+#ifdef MYC_MEM_ARENA_64BIT
+typedef uint64_t myc_mem_size_t;
+#else
+typedef uint32_t myc_mem_size_t;
+#endif
+
+/* Flags controlling the behaviour of a memory arena. */
+typedef enum MycMemArenaFlags {
+    MYC_MEM_ARENA_FLAG_NONE = 0,
+    /* All alloc/realloc/free calls may be made concurrently. Each thread keeps a small cache of recently freed chunks 
+    and small objects per arena, and only locks a region or small object class when that cache runs empty or full. */
+    MYC_MEM_ARENA_FLAG_THREAD_SAFE = 1 << 0,
+    /* Regions are aligned and sized to 2 MiB and advised to be backed by transparent huge pages. */
+    MYC_MEM_ARENA_FLAG_HUGE_PAGES = 1 << 1,
+    /* Regions are mapped from the explicit huge page pool (MAP_HUGETLB). 
+    Falls back to MYC_MEM_ARENA_FLAG_HUGE_PAGES if the pool cannot serve the request. */
+    MYC_MEM_ARENA_FLAG_HUGETLB = 1 << 2,
+    /* All pages of a region are faulted in when it is created, instead of on first touch. */
+    MYC_MEM_ARENA_FLAG_PREFAULT = 1 << 3,
+} myc_mem_arena_flags_t;
+
 /* Creates a new memory arena with a capacity of at least 'size' bytes. */
-myc_err_t myc_mem_arena_create(MycMemArena_t **new_arena, uint32_t size);
+myc_err_t myc_mem_arena_create(MycMemArena_t **new_arena, myc_mem_size_t size);
+/* Creates a new memory arena with a capacity of at least 'size' bytes and the behaviour given by 'flags'. */
+myc_err_t myc_mem_arena_create_with_flags(MycMemArena_t **new_arena, myc_mem_size_t size, myc_mem_arena_flags_t flags);
+/* Creates a new memory arena with a capacity of at least 'size' bytes, which reserves address space for at least 
+'reserve_size' bytes up front. The reserved memory is committed on demand, growing the arena in place, so allocations 
+and reallocations only fail (or move) once the reservation is used up. 
+!!NOTE: Cannot be combined with MYC_MEM_ARENA_FLAG_HUGETLB. */
+myc_err_t myc_mem_arena_create_reserved(MycMemArena_t **new_arena, myc_mem_size_t size, myc_mem_size_t reserve_size, myc_mem_arena_flags_t flags);
 /* Expands the memory arena by creating a new arena of at least 'add_size' bytes and adding it as a child.
+Arenas with reserved address space grow an existing region in place instead, as long as there is enough of it left.
 !!NOTE: The newly created memory region need not be contiguous to existing memory region(s). */
-myc_err_t myc_mem_arena_expand(MycMemArena_t *arena, uint32_t add_size);
-/* Destroys the memory arena and releases the resources back to the OS. */
+myc_err_t myc_mem_arena_expand(MycMemArena_t *arena, myc_mem_size_t add_size);
+/* Destroys the memory arena and releases the resources back to the OS. 
+!!NOTE: For thread safe arenas, no other thread may use the arena during or after this call. */
 void myc_mem_arena_destroy(MycMemArena_t *arena);
 
-/* Allocates a memory chunk of at least 'size' bytes. */
-void* myc_mem_arena_malloc(MycMemArena_t *arena, uint32_t size);
+/* Allocates a memory chunk of at least 'size' bytes. 
+Requests of up to 256 bytes are packed into shared runs of same sized objects, which are aligned to 16 bytes. */
+void* myc_mem_arena_malloc(MycMemArena_t *arena, myc_mem_size_t size);
 /* Resizes the memory chunk at 'addr' to be at least 'new_size' bytes, moves it if necessary and returns the new address. 
 !!NOTE: Absolute pointers into the memory will be invalid if the chunk moves. */
-void* myc_mem_arena_realloc(void *addr, uint32_t new_size);
+void* myc_mem_arena_realloc(void *addr, myc_mem_size_t new_size);
+/* Allocates a memory chunk of at least 'size' bytes, whose address is a multiple of 'alignment', which must be a power 
+of two of at most 256. Up to 256 bytes of size, it comes from the smallest small object class whose size is a multiple 
+of the alignment. Larger sizes aligned beyond 8 bytes are served by chunks starting on a 4 KiB boundary, which cost 
+about 'alignment' (at least 48) extra bytes each. The memory is freed with 'myc_mem_arena_free' as usual. */
+void* myc_mem_arena_aligned_malloc(MycMemArena_t *arena, myc_mem_size_t size, size_t alignment);
+/* Resizes the memory chunk at 'addr' like 'myc_mem_arena_realloc', but the returned address is a multiple of 
+'alignment' (see 'myc_mem_arena_aligned_malloc'). Plain reallocation only keeps the alignment of such chunks above 256 bytes. */
+void* myc_mem_arena_aligned_realloc(void *addr, myc_mem_size_t new_size, size_t alignment);
+/* Resizes the memory chunk at 'addr' to be at least 'new_size' bytes, but only if that is possible without moving it. 
+Returns MYC_FAILED and leaves the chunk as it is otherwise, so pointers into the memory always stay valid. */
+myc_err_t myc_mem_arena_try_expand(void *addr, myc_mem_size_t new_size);
 /* Frees the memory chunk at 'addr', allowing it to be reused. */
 void myc_mem_arena_free(void *addr);
-/* Resets the memory arena by freeing all currently allocated memory chunks. This does not release resources to the OS. */
+/* Allocates 'count' memory chunks of at least 'sizes[i]' bytes each and stores their addresses in 'addrs'.
+The chunks are carved out of a single free tail where possible, which takes one layout update for all of them.
+Either all chunks are allocated, or none is. */
+myc_err_t myc_mem_arena_malloc_batch(MycMemArena_t *arena, const myc_mem_size_t *sizes, size_t count, void **addrs);
+/* Frees the 'count' memory chunks at 'addrs', which may belong to different arenas. The chunks are grouped by region,
+so each region is locked once, and the layout tree of a region is brought up to date once after all its chunks were freed.
+!!NOTE: The order of 'addrs' is not preserved. */
+void myc_mem_arena_free_batch(void **addrs, size_t count);
+/* Resets the memory arena by freeing all currently allocated memory chunks. This does not release resources to the OS. 
+!!NOTE: For thread safe arenas, no other thread may use the arena during this call. */
 void myc_mem_arena_reset(MycMemArena_t *arena);
 
+/* Gives the free memory of the arena back to the OS, i.e. the page aligned interior of every free bucket tail. 
+The memory stays mapped and reads as zero once it is reused. */
+void myc_mem_arena_purge(MycMemArena_t *arena);
+/* Makes the arena purge a region by itself, once memory freed in it has been waiting for 'decay_ms' milliseconds 
+without a purge. Zero disables decay, which is the default. 
+!!NOTE: Decay is only checked while freeing, so arenas which become idle have to be purged explicitly. */
+void myc_mem_arena_set_purge_decay(MycMemArena_t *arena, uint32_t decay_ms);
+
 /* Returns the actual user size of the memory chunk at 'addr'. */
-uint32_t myc_mem_arena_get_chunk_size(void *addr);
+myc_mem_size_t myc_mem_arena_get_chunk_size(void *addr);
+/* Returns the number of bytes mapped by all regions of the arena. */
+size_t myc_mem_arena_get_mapped_size(const MycMemArena_t *arena);
+/* Returns the number of bytes of the arena which are currently resident in physical memory. */
+size_t myc_mem_arena_get_resident_size(const MycMemArena_t *arena);
+
+/* Counters and sizes of a memory arena, as reported by 'myc_mem_arena_get_stats'. All sizes are in bytes. */
+typedef struct MycMemArenaStats {
+    uint64_t malloc_count;
+    uint64_t free_count;
+    uint64_t realloc_in_place_count;        // Reallocations which kept their address.
+    uint64_t realloc_move_count;            // Reallocations which moved the memory to a new chunk.
+    uint64_t layout_reset_count;            // Calls of 'myc_mem_arena_reset', which rebuild every region layout.
+    uint64_t layout_grow_count;             // Region layouts grown in place into reserved address space.
+    size_t used_size;                       // Held by chunks, including headers, small object runs and thread caches.
+    size_t free_size;
+    size_t largest_free_size;               // Largest free tail of any bucket, which bounds a single allocation.
+    size_t mapped_size;
+    size_t reserved_size;                   // Address space reserved by all regions, including 'mapped_size'.
+    size_t internal_size;                   // Region headers and layouts.
+    size_t region_count;
+    size_t bucket_count;
+    size_t layout_depth;                    // Levels of the deepest layout tree, i.e. the node reads per tree search.
+    double fragmentation;                   // Share of the free memory outside the largest free tail, in [0, 1].
+} MycMemArenaStats_t;
+
+/* Fills 'stats' from counters the arena maintains as it goes, without walking its chunks. Thread safe arenas 
+accumulate the operation counters per thread, so the allocation paths never share them, and sum them up here.
+!!NOTE: For thread safe arenas, the result is a snapshot which need not be consistent across fields. */
+void myc_mem_arena_get_stats(MycMemArena_t *arena, MycMemArenaStats_t *stats);
 /* Prints memory usage/layout information to stdout. */
 void myc_mem_arena_introspect(const MycMemArena_t *arena);
 
 
 
+// === ALLOCATION TRACES =========================================================================================== //
+
+#define MYC_MEM_TRACE_MAGIC 0x454341525443594Dull      // "MYCTRACE" in little endian.
+#define MYC_MEM_TRACE_VERSION 1
+
+typedef enum MycMemTraceOp {
+    MYC_MEM_TRACE_OP_MALLOC = 1,
+    MYC_MEM_TRACE_OP_REALLOC = 2,
+    MYC_MEM_TRACE_OP_FREE = 3,
+} myc_mem_trace_op_t;
+
+/* A trace file starts with this header, followed by one record per operation, in the order they took effect. */
+typedef struct MycMemTraceHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t record_size;
+} MycMemTraceHeader_t;
+
+/* Allocations are identified by a number, which is unique within the trace and stays the same across reallocations. 
+Ids are handed out densely from 1 on, so a replay can keep its live allocations in a plain array. */
+typedef struct MycMemTraceRecord {
+    uint64_t timestamp_ns;          // Since tracing started.
+    uint64_t size;                  // Requested size, zero for frees.
+    uint32_t id;
+    uint32_t op;                    // One of myc_mem_trace_op_t.
+} MycMemTraceRecord_t;
+
+/* Starts recording every successful malloc/realloc/free on the arena into a binary trace file at 'path', which is 
+replayed by the 'mem-replay-bench' tool. Frees of chunks allocated before tracing started are not recorded, 
+and reallocations of those are recorded as allocations. 
+!!NOTE: For thread safe arenas, no other thread may use the arena during this call. */
+myc_err_t myc_mem_arena_trace_start(MycMemArena_t *arena, const char *path);
+/* Stops tracing the arena, flushes and closes the trace file. 
+!!NOTE: For thread safe arenas, no other thread may use the arena during this call. */
+void myc_mem_arena_trace_stop(MycMemArena_t *arena);
+
+
+
 // === MEMORY ALLOCATORS =========================================================================================== //
 
 /* Opaque handle representing a simple bump allocator. */
 typedef struct _MycMemBumpAllocator MycMemBumpAlloc_t;
 
+/* Flags controlling the behaviour of a bump allocator. */
+typedef enum MycMemBumpAllocFlags {
+    MYC_MEM_BUMP_ALLOC_FLAG_NONE = 0,
+    /* Allocations may be made concurrently, using an atomic fetch-add on the current node. When a node fills up, a new 
+    node is taken from the arena without locking, so the arena must be thread safe. 
+    Allocations with an alignment above sizeof(void*) may waste up to 'alignment' bytes each. */
+    MYC_MEM_BUMP_ALLOC_FLAG_CONCURRENT = 1 << 0,
+    /* A new node is taken from the arena whenever the nodes are full, instead of failing the allocation. Each new node 
+    is twice as large as the previous one, up to the maximum node size. Allocations larger than a quarter of the maximum 
+    node size get a dedicated node of their own, which is given back to the arena on the next reset. */
+    MYC_MEM_BUMP_ALLOC_FLAG_GROW = 1 << 1,
+} myc_mem_bump_alloc_flags_t;
+
+/* Default maximum size of the nodes taken by growing bump allocators. */
+#define MYC_MEM_BUMP_ALLOC_DEFAULT_NODE_SIZE_MAX (1u << 20)
+
 /* Creates a new bump allocator with a capacity of at least 'size' bytes. */
 myc_err_t myc_mem_bump_alloc_create(MycMemBumpAlloc_t **new_bump_alloc, MycMemArena_t *arena, uint32_t size);
+/* Creates a new bump allocator with a capacity of at least 'size' bytes and the behaviour given by 'flags'. */
+myc_err_t myc_mem_bump_alloc_create_with_flags(MycMemBumpAlloc_t **new_bump_alloc, MycMemArena_t *arena, uint32_t size, myc_mem_bump_alloc_flags_t flags);
 /* Expands the bump allocator by creating a new allocator of at least 'add_size' bytes and adding it as a child. */
 myc_err_t myc_mem_bump_alloc_expand(MycMemBumpAlloc_t *bump_alloc, uint32_t add_size);
 /* Destroys the bump allocator and frees all memory allocated by it. */
 void myc_mem_bump_alloc_destroy(MycMemBumpAlloc_t *bump_alloc);
+/* Sets the size up to which the nodes of a growing bump allocator double (see 'MYC_MEM_BUMP_ALLOC_FLAG_GROW'). */
+void myc_mem_bump_alloc_set_node_size_max(MycMemBumpAlloc_t *bump_alloc, uint32_t node_size_max);
 
 /* Allocates 'size' bytes on the bump allocator, aligned to a multiple of 'alignment' 
 !!NOTE: The given alignment must be a power of two. */
@@ -58,17 +207,100 @@ static inline void* myc_mem_bump_malloc(MycMemBumpAlloc_t *bump_alloc, uint32_t
 }
 /* Returns the number of contiguous bytes still available. */
 uint32_t myc_mem_bump_alloc_get_free_size(MycMemBumpAlloc_t *bump_alloc);
-/* Resets the bump allocator as if no allocations were made previously. */
+/* Resets the bump allocator in O(1) as if no allocations were made previously. 
+Dedicated nodes of oversized allocations (see 'MYC_MEM_BUMP_ALLOC_FLAG_GROW') are given back to the arena. 
+!!NOTE: For concurrent bump allocators, no other thread may use the allocator during this call, 
+and the reset takes time linear in the number of nodes. */
 void myc_mem_bump_alloc_reset(MycMemBumpAlloc_t *bump_alloc);
+/* Resets the bump allocator and gives every node which was not needed since the last reset back to the arena, 
+trimming the allocator down to the peak working set of the last cycle. 
+!!NOTE: For concurrent bump allocators, no other thread may use the allocator during this call. */
+void myc_mem_bump_alloc_reset_trim(MycMemBumpAlloc_t *bump_alloc);
+
+/* Savepoint of a bump allocator (see 'myc_mem_bump_alloc_mark'). */
+typedef struct MycMemBumpAllocMark {
+    struct _MycMemBumpAllocatorNode *node;
+    struct _MycMemBumpAllocatorNode *large_nodes;
+    uint32_t size_used;
+} MycMemBumpAllocMark_t;
+
+/* Returns a savepoint of the bump allocator in O(1), which 'myc_mem_bump_alloc_rewind' rolls back to. 
+!!NOTE: For concurrent bump allocators, no other thread may use the allocator during this call. */
+MycMemBumpAllocMark_t myc_mem_bump_alloc_mark(MycMemBumpAlloc_t *bump_alloc);
+/* Frees every allocation made since 'mark' was taken in O(1), apart from giving back the dedicated nodes of oversized 
+allocations. Marks nest, rewinding to a mark invalidates every mark taken after it, and a reset invalidates all marks. 
+!!NOTE: For concurrent bump allocators, no other thread may use the allocator during this call, 
+and the rewind takes time linear in the number of nodes filled since the mark. */
+void myc_mem_bump_alloc_rewind(MycMemBumpAlloc_t *bump_alloc, MycMemBumpAllocMark_t mark);
+
+typedef struct MycMemBumpAllocScope {
+    MycMemBumpAlloc_t *bump_alloc;
+    MycMemBumpAllocMark_t mark;
+    bool is_open;
+} MycMemBumpAllocScope_t;
+
+static inline MycMemBumpAllocScope_t _myc_private_mem_bump_alloc_scope_enter(MycMemBumpAlloc_t *bump_alloc) {
+    return (MycMemBumpAllocScope_t){ .bump_alloc = bump_alloc, .mark = myc_mem_bump_alloc_mark(bump_alloc), .is_open = true };
+}
+static inline void _myc_private_mem_bump_alloc_scope_exit(MycMemBumpAllocScope_t *scope) {
+    myc_mem_bump_alloc_rewind(scope->bump_alloc, scope->mark);
+}
+
+/* Runs the following block with a mark on the bump allocator, which is rewound whenever the block is left 
+(including 'return'). Usage:   MYC_MEM_BUMP_ALLOC_SCOPE(bump_alloc) { ... }
+!!NOTE: The scope is a loop of its own, so 'break' and 'continue' inside the block only leave the scope and never reach 
+an enclosing loop. Loop bodies which need those take a mark with 'myc_mem_bump_alloc_mark' at the top of the body and 
+call 'myc_mem_bump_alloc_rewind' before every 'break', 'continue' and the end of the body instead. */
+#define MYC_MEM_BUMP_ALLOC_SCOPE(BUMP_ALLOC)                                                                            \
+    for (MycMemBumpAllocScope_t _myc_private_bump_scope __attribute__((cleanup(_myc_private_mem_bump_alloc_scope_exit))) \
+            = _myc_private_mem_bump_alloc_scope_enter(BUMP_ALLOC);                                                      \
+         _myc_private_bump_scope.is_open; _myc_private_bump_scope.is_open = false)
+
+
+
+/* Opaque handle representing a fixed-size object pool (aka slab allocator). */
+typedef struct _MycMemPoolAllocator MycMemPoolAlloc_t;
+
+/* Creates a new pool allocator handing out objects of 'object_size' bytes, carved from slabs allocated on the arena. */
+myc_err_t myc_mem_pool_alloc_create(MycMemPoolAlloc_t **new_pool_alloc, MycMemArena_t *arena, uint32_t object_size);
+/* Destroys the pool allocator and gives all its slabs back to the arena. */
+void myc_mem_pool_alloc_destroy(MycMemPoolAlloc_t *pool_alloc);
+
+/* Allocates a single object from the pool in O(1), pulling a new slab from the arena if all slabs are full. */
+void* myc_mem_pool_malloc(MycMemPoolAlloc_t *pool_alloc);
+/* Returns the object at 'addr' to the pool in O(1). Slabs that become fully empty are given back to the arena. */
+void myc_mem_pool_free(MycMemPoolAlloc_t *pool_alloc, void *addr);
+/* Returns the (aligned) size of the objects handed out by the pool. */
+uint32_t myc_mem_pool_alloc_get_object_size(const MycMemPoolAlloc_t *pool_alloc);
 
 
 
 /* Opaque handle representing a frame allocator (aka tempory allocator). */
 typedef struct _MycMemFrameAllocator MycMemFrameAlloc_t;
 
-/* Creates a new frame allocator with a capacity of at least 'size' bytes. */
+#define MYC_MEM_FRAME_ALLOC_DEFAULT_FRAME_COUNT 2
+
+/* Creates a new double buffered frame allocator with a capacity of at least 'size' bytes per frame. 
+Allocations stay valid during the frame they were made in and the frame after it. */
 myc_err_t myc_mem_frame_alloc_create(MycMemFrameAlloc_t **new_frame_alloc, MycMemArena_t *arena, uint32_t size);
-/* Expands the frame allocator by creating a new allocator of at least 'add_size' bytes and adding it as a child. */
-myc_err_t myc_mem_frame_alloc_expand(MycMemFrameAlloc_t **new_frame_alloc, MycMemArena_t *arena, uint32_t size);
+/* Creates a new frame allocator with a capacity of at least 'size' bytes per frame, 
+whose allocations stay valid for 'frame_count' frames (including the frame they were made in). */
+myc_err_t myc_mem_frame_alloc_create_buffered(MycMemFrameAlloc_t **new_frame_alloc, MycMemArena_t *arena, uint32_t size, uint32_t frame_count);
+/* Expands every frame of the frame allocator by at least 'add_size' bytes. */
+myc_err_t myc_mem_frame_alloc_expand(MycMemFrameAlloc_t *frame_alloc, uint32_t add_size);
+/* Destroys the frame allocator and frees all memory allocated by it. */
+void myc_mem_frame_alloc_destroy(MycMemFrameAlloc_t *frame_alloc);
+
+/* Ends the current frame and begins the next one in O(1), invalidating all allocations made 'frame_count' frames ago. */
+void myc_mem_frame_alloc_begin_frame(MycMemFrameAlloc_t *frame_alloc);
+/* Allocates 'size' bytes in the current frame, aligned to a multiple of 'alignment'. 
+!!NOTE: The given alignment must be a power of two. */
+void* myc_mem_frame_aligned_malloc(MycMemFrameAlloc_t *frame_alloc, uint32_t size, size_t alignment);
+/* Allocates 'size' bytes in the current frame, aligned to a multiple of sizeof(void*). */
+static inline void* myc_mem_frame_malloc(MycMemFrameAlloc_t *frame_alloc, uint32_t size) {
+    return myc_mem_frame_aligned_malloc(frame_alloc, size, sizeof(void*));
+}
+/* Returns the number of contiguous bytes still available in the current frame. */
+uint32_t myc_mem_frame_alloc_get_free_size(MycMemFrameAlloc_t *frame_alloc);
 
 #endif // _MYC_MEMORY_H_
\ No newline at end of file
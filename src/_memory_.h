@@ -1,12 +1,22 @@
 #ifndef _MYC_MEMORY_INTENRAL_H_
 #define _MYC_MEMORY_INTENRAL_H_
 
+#include <pthread.h>
+
 #include "myc/core.h"
 
 #define MYC_MEM_ARENA_PAGE_SIZE 256
 _Static_assert(MYC_IS_POWER_OFF_TWO(MYC_MEM_ARENA_PAGE_SIZE), "Memory arena page size must be a power of two.");
 #define MYC_MEM_LAYOUT_NODE_CHILD_COUNT 8
+/* Every group of children is exactly one AVX2 register wide, and is aligned as such. */
+#define MYC_MEM_LAYOUT_NODE_GROUP_ALIGNMENT (MYC_MEM_LAYOUT_NODE_CHILD_COUNT * sizeof(uint32_t))
+#ifdef MYC_MEM_ARENA_64BIT
+/* Bounded by the free sizes in the layout tree, see MYC_MEM_LAYOUT_FREE_SIZE_SHIFT. */
+#define MYC_MEM_ARENA_SIZE_MAX ((size_t)UINT32_MAX << MYC_MEM_LAYOUT_FREE_SIZE_SHIFT)
+#else
 #define MYC_MEM_ARENA_SIZE_MAX (size_t)UINT32_MAX
+#endif
+#define MYC_MEM_ARENA_HUGE_PAGE_SIZE (2 * 1024 * 1024)
 #define MYC_MEM_ALLOC_FAILED (void*)0
 
 
@@ -14,69 +24,240 @@ typedef struct _MycMemoryArena MycMemArena_t;
 typedef struct _MycMemoryLayout MycMemLayout_t;
 typedef struct _MycMemoryChunkHeader MycMemChunk_t;
 typedef struct _MycMemoryChunkSearchInfo MycMemChunkSearchInfo_t;
+typedef struct _MycMemoryThreadCache MycMemThreadCache_t;
+typedef struct _MycMemoryRegionIndex MycMemRegionIndex_t;
+typedef struct _MycMemoryTrace MycMemTrace_t;
+
+/* The layout splits a region into buckets, each made of allocated chunks followed by a free tail. Buckets always 
+start on an arena page, so they are indexed by their first page. The free sizes live in the leaves of an implicit 
+tree with one leaf per page (zero for pages that do not start a bucket), whose inner nodes store the maximum of their 
+children. The shape of the tree is fixed when the region is created, so splitting or merging buckets only updates a 
+single leaf and its ancestors. */
+#define MYC_MEM_LAYOUT_LEVEL_COUNT_MAX 12
+/* Free sizes are multiples of the arena page size, so the lowest bit is used to tag the pages which start a bucket. 
+Every subtree containing a bucket is therefore non-zero, even if all its buckets are full. */
+#define MYC_MEM_LAYOUT_BUCKET_TAG 0x01u
+/* Free sizes are stored in units of half a page, which keeps the tag bit free and the tree nodes 32 bits wide, 
+while still covering buckets of up to 512 GiB. */
+#define MYC_MEM_LAYOUT_FREE_SIZE_SHIFT 7
+_Static_assert((MYC_MEM_ARENA_PAGE_SIZE >> MYC_MEM_LAYOUT_FREE_SIZE_SHIFT) == 2, "Free sizes must be stored in half pages.");
+/* The pages which start a bucket are also marked in a bitmap, summarized by coarser bitmaps with one bit per 64-bit 
+word of the level below. Finding the bucket of a page is a predecessor search over at most this many levels. */
+#define MYC_MEM_LAYOUT_BITMAP_LEVEL_COUNT_MAX 6
+#define MYC_MEM_LAYOUT_BITMAP_WORD_BITS 64
+
+typedef struct _MycMemoryLayout {
+    size_t page_count;
+    size_t page_capacity;                                       // Pages the tree was shaped for, see 'mem_layout_grow'.
+    size_t level_count;
+    uint32_t *max_free_sizes;                                   // Root node, equal to 'levels[0]'.
+    uint32_t *levels[MYC_MEM_LAYOUT_LEVEL_COUNT_MAX];           // Root level first, the leaves (pages) last.
+    uint32_t *bucket_end_pages;                                 // Page past the end of each bucket, indexed by its first page.
+    size_t bitmap_level_count;
+    uint64_t *bucket_bitmaps[MYC_MEM_LAYOUT_BITMAP_LEVEL_COUNT_MAX];  // Pages first, the single summary word last.
+    size_t free_size;                                           // Sum of all free tails, maintained with the leaves.
+    size_t bucket_count;                                        // Maintained with the leaves.
+    bool is_deferred;                                           // See 'mem_layout_defer'.
+    size_t deferred_page_start;                                 // Leaves whose ancestors are stale while deferred.
+    size_t deferred_page_end;
+} MycMemLayout_t;
 
-static inline size_t calc_parent_node_count(size_t bucket_node_count) {
-    return (bucket_node_count + MYC_MEM_LAYOUT_NODE_CHILD_COUNT - 3) / (MYC_MEM_LAYOUT_NODE_CHILD_COUNT - 1);
+static inline size_t mem_layout_page_idx(size_t offset) {
+    return offset / MYC_MEM_ARENA_PAGE_SIZE;
 }
 
-static inline size_t calc_free_size_node_count(size_t bucket_node_count) {
-    return bucket_node_count + calc_parent_node_count(bucket_node_count);
+static inline size_t mem_layout_page_offset(size_t page_idx) {
+    return page_idx * MYC_MEM_ARENA_PAGE_SIZE;
 }
 
-static inline size_t node_parent_idx(size_t node_idx) {
-    return (node_idx - 1) / MYC_MEM_LAYOUT_NODE_CHILD_COUNT;
+/* Converts a free size (a multiple of the page size) to its tree node value, excluding the tag. Node values compare 
+the same way as the free sizes they encode, so the tree is searched for the encoded size. */
+static inline uint32_t mem_layout_encode_free_size(size_t free_size) {
+    return (uint32_t)(free_size >> MYC_MEM_LAYOUT_FREE_SIZE_SHIFT);
 }
 
-static inline size_t node_children_base_idx(size_t node_idx) {
-    return (node_idx * MYC_MEM_LAYOUT_NODE_CHILD_COUNT) + 1;
+static inline size_t mem_layout_decode_free_size(uint32_t node) {
+    return (size_t)(node & ~MYC_MEM_LAYOUT_BUCKET_TAG) << MYC_MEM_LAYOUT_FREE_SIZE_SHIFT;
 }
 
-typedef struct _MycMemoryLayout {
-    size_t bucket_node_count;
-    size_t parent_node_count;
-    uint32_t *bucket_offsets;
-    uint32_t *max_free_sizes;
-} MycMemLayout_t;
+static inline uint32_t* mem_layout_leaves(const MycMemLayout_t *layout) {
+    return layout->levels[layout->level_count - 1];
+}
 
-static inline size_t mem_layout_node_count(const MycMemLayout_t *layout) {
-    return layout->bucket_node_count + layout->parent_node_count;
+static inline size_t mem_layout_bucket_free_size(const MycMemLayout_t *layout, size_t bucket_idx) {
+    return mem_layout_decode_free_size(mem_layout_leaves(layout)[bucket_idx]);
 }
 
-static inline uint32_t mem_layout_bucket_size(const MycMemLayout_t *layout, size_t bucket_idx) {
-    return layout->bucket_offsets[bucket_idx + 1] - layout->bucket_offsets[bucket_idx];
+static inline size_t mem_layout_bucket_end(const MycMemLayout_t *layout, size_t bucket_idx) {
+    return mem_layout_page_offset(layout->bucket_end_pages[bucket_idx]);
 }
 
-static inline uint32_t mem_layout_bucket_free_size(const MycMemLayout_t *layout, size_t bucket_idx) {
-    return layout->max_free_sizes[bucket_idx + layout->parent_node_count];
+static inline size_t mem_layout_bucket_size(const MycMemLayout_t *layout, size_t bucket_idx) {
+    return mem_layout_bucket_end(layout, bucket_idx) - mem_layout_page_offset(bucket_idx);
 }
 
-static inline uint32_t mem_layout_bucket_size_used(const MycMemLayout_t *layout, size_t bucket_idx) {
+static inline size_t mem_layout_bucket_size_used(const MycMemLayout_t *layout, size_t bucket_idx) {
     return mem_layout_bucket_size(layout, bucket_idx) - mem_layout_bucket_free_size(layout, bucket_idx);
 }
 
-static inline uint32_t mem_layout_bucket_free_offset(const MycMemLayout_t *layout, size_t bucket_idx) {
-    return layout->bucket_offsets[bucket_idx + 1] - mem_layout_bucket_free_size(layout, bucket_idx);
+static inline size_t mem_layout_bucket_free_offset(const MycMemLayout_t *layout, size_t bucket_idx) {
+    return mem_layout_bucket_end(layout, bucket_idx) - mem_layout_bucket_free_size(layout, bucket_idx);
+}
+
+/* Returns the number of nodes needed to store the level below a level of 'node_count' nodes, and vice versa. */
+static inline size_t calc_mem_layout_parent_count(size_t node_count) {
+    return (node_count + MYC_MEM_LAYOUT_NODE_CHILD_COUNT - 1) / MYC_MEM_LAYOUT_NODE_CHILD_COUNT;
+}
+
+/* Every level is padded to a whole number of child groups. */
+static inline size_t calc_mem_layout_level_size(size_t node_count) {
+    return MYC_QUANTIZE_UP(node_count, MYC_MEM_LAYOUT_NODE_CHILD_COUNT);
 }
 
+/* Returns the total number of bitmap words (over all levels) needed for a region of 'page_count' pages. */
+static inline size_t calc_mem_layout_bitmap_word_count(size_t page_count) {
+    size_t word_count = 0;
+    for (size_t level_bit_count = page_count; ; ) {
+        level_bit_count = (level_bit_count + MYC_MEM_LAYOUT_BITMAP_WORD_BITS - 1) / MYC_MEM_LAYOUT_BITMAP_WORD_BITS;
+        word_count += level_bit_count;
+        if (level_bit_count == 1) break;
+    }
+    return word_count;
+}
+
+/* Returns the total number of tree nodes (including padding) needed for a region of 'page_count' pages. */
+static inline size_t calc_mem_layout_node_count(size_t page_count) {
+    size_t node_count = calc_mem_layout_level_size(page_count);
+    for (size_t level_node_count = page_count; level_node_count > 1;) {
+        level_node_count = calc_mem_layout_parent_count(level_node_count);
+        node_count += calc_mem_layout_level_size(level_node_count);
+    }
+    return node_count;
+}
+
+/* Kernels scanning one aligned group of MYC_MEM_LAYOUT_NODE_CHILD_COUNT children. The best implementation for the 
+host CPU (AVX2, SSE4.1 or scalar) is picked once at load time. */
+typedef struct _MycMemLayoutKernels {
+    /* Returns the index of the smallest child >= 'size' (the first one on ties), 
+    or MYC_MEM_LAYOUT_NODE_CHILD_COUNT if no child is large enough. */
+    size_t (*find_min_suitable_child)(const uint32_t *children, uint32_t size);
+    /* Returns the largest child. */
+    uint32_t (*max_child)(const uint32_t *children);
+} MycMemLayoutKernels_t;
+
+extern MycMemLayoutKernels_t mem_layout_kernels;
+
+/* Sets up the layout tree in 'memory' for a region of 'page_count' pages, whose first 'internal_size' bytes are in use.
+The tree is shaped for 'page_capacity' pages, so the region can grow up to that many pages later on.
+!!NOTE: 'memory' must be zero initialized and aligned to MYC_MEM_LAYOUT_NODE_GROUP_ALIGNMENT. */
+void mem_layout_init(MycMemLayout_t *layout, void *memory, size_t page_capacity, size_t page_count, size_t internal_size);
+/* Resets the layout to a single bucket, whose first 'internal_size' bytes are in use. */
+void mem_layout_reset(MycMemLayout_t *layout, size_t internal_size);
+/* Grows the layout to 'page_count' pages (at most its capacity), adding the new pages to the free tail of the last bucket. */
+void mem_layout_grow(MycMemLayout_t *layout, size_t page_count);
+
+/* Requests of up to MYC_MEM_SMALL_SIZE_MAX bytes are served from small object runs instead of whole chunks. Runs are 
+chunks aligned to their own size, so the run of any object is found by masking its address. Like pool slabs, free 
+objects are linked through their own first bytes and no object carries a header. Objects are aligned to 
+MYC_MEM_SMALL_OBJECT_ALIGNMENT, so they never sit right behind a page aligned chunk header like chunk addresses do. */
+#define MYC_MEM_SMALL_CLASS_COUNT 10
+#define MYC_MEM_SMALL_SIZE_MAX 256
+#define MYC_MEM_SMALL_RUN_SIZE 4096
+#define MYC_MEM_SMALL_OBJECT_ALIGNMENT 16
+
+typedef struct _MycMemorySmallClass MycMemSmallClass_t;
+typedef struct _MycMemorySmallRun MycMemSmallRun_t;
+
+typedef struct _MycMemorySmallRun {
+    MycMemSmallClass_t *small_class;
+    MycMemSmallRun_t *prev;
+    MycMemSmallRun_t *next;
+    void *free_list;
+    uint32_t free_count;
+    uint32_t carve_offset;      // Objects past this offset have never been handed out and are not in the free list.
+                                // For aligned chunks, the offset of their object instead.
+} MycMemSmallRun_t;
+
+/* Full runs are not linked anywhere, they are found again through their objects once those are freed. */
+typedef struct _MycMemorySmallClass {
+    uint32_t object_size;
+    uint32_t object_count;      // Per run.
+    uint32_t first_object_offset;
+    MycMemSmallRun_t *partial_runs;
+    MycMemSmallRun_t *empty_run;        // A single empty run is kept around to avoid thrashing the arena.
+    pthread_mutex_t lock;
+} MycMemSmallClass_t;
+
+/* Operation counters of an arena, see 'myc_mem_arena_get_stats'. */
+typedef enum MycMemCounter {
+    MYC_MEM_COUNTER_MALLOC,
+    MYC_MEM_COUNTER_FREE,
+    MYC_MEM_COUNTER_REALLOC_IN_PLACE,
+    MYC_MEM_COUNTER_REALLOC_MOVE,
+    MYC_MEM_COUNTER_LAYOUT_RESET,
+    MYC_MEM_COUNTER_LAYOUT_GROW,
+    MYC_MEM_COUNTER_COUNT,
+} myc_mem_counter_t;
+
 typedef struct _MycMemoryArena {
-    size_t size;
+    size_t size;                            // Committed (accessible) size.
+    size_t reserve_size;                    // Mapped size, the address space past 'size' is reserved but inaccessible.
     size_t internal_size;
     MycMemLayout_t layout;
     MycMemArena_t *head;
     MycMemArena_t *next;
+    myc_mem_arena_flags_t flags;
+    pthread_mutex_t lock;
+    MycMemThreadCache_t *thread_caches;     // Only used by the head region.
+    MycMemRegionIndex_t *region_index;      // Only used by the head region.
+    pthread_mutex_t region_index_lock;      // Only used by the head region.
+    size_t region_idx;                      // Leaf of the region in the region index.
+    uint32_t purge_decay_ms;                // Only used by the head region.
+    uint32_t dirty_free_count;              // Frees since the region became dirty, decay is only checked every so often.
+    uint64_t dirty_since_ms;                // Zero while nothing was freed since the last purge.
+    size_t region_reserve_size;             // Only used by the head region, zero unless regions reserve address space.
+    MycMemSmallClass_t small_classes[MYC_MEM_SMALL_CLASS_COUNT];    // Only used by the head region.
+    uint64_t counters[MYC_MEM_COUNTER_COUNT];                       // Only used by the head region.
+    MycMemTrace_t *trace;                   // Only used by the head region, NULL unless the arena is traced.
 } MycMemArena_t;
 
+static inline bool mem_arena_is_thread_safe(const MycMemArena_t *arena) {
+    return (arena->flags & MYC_MEM_ARENA_FLAG_THREAD_SAFE) != 0;
+}
+
+static inline void mem_arena_lock(MycMemArena_t *arena) {
+    if (mem_arena_is_thread_safe(arena)) pthread_mutex_lock(&arena->lock);
+}
+
+static inline void mem_arena_unlock(MycMemArena_t *arena) {
+    if (mem_arena_is_thread_safe(arena)) pthread_mutex_unlock(&arena->lock);
+}
+
+/* Chunks are whole pages and start on a page, so both are stored in pages. 
+This keeps the header at 8 bytes, even for regions beyond 4 GiB. */
 typedef struct _MycMemoryChunkHeader {
-    uint32_t size;
-    uint32_t offset;
+    uint32_t page_count;
+    uint32_t page_idx;          // First page of the chunk within its region.
 } MycMemChunk_t;
 
-static inline MycMemChunk_t* mem_chunk_at(const MycMemArena_t *arena, uint32_t offset) {
+static inline size_t mem_chunk_size(const MycMemChunk_t *chunk) {
+    return mem_layout_page_offset(chunk->page_count);
+}
+
+static inline size_t mem_chunk_offset(const MycMemChunk_t *chunk) {
+    return mem_layout_page_offset(chunk->page_idx);
+}
+
+static inline void mem_chunk_set_size(MycMemChunk_t *chunk, size_t size) {
+    chunk->page_count = (uint32_t)mem_layout_page_idx(size);
+}
+
+static inline MycMemChunk_t* mem_chunk_at(const MycMemArena_t *arena, size_t offset) {
     return (void*)arena + offset;
 }
 
 static inline MycMemArena_t* mem_chunk_get_arena(const MycMemChunk_t* chunk) {
-    return (void*)chunk - chunk->offset;
+    return (void*)chunk - mem_chunk_offset(chunk);
 }
 
 static inline MycMemChunk_t* mem_chunk_from_addr(void *addr) {
@@ -87,6 +268,60 @@ static inline void* mem_addr_from_chunk(MycMemChunk_t *chunk) {
     return (void*)chunk + sizeof(MycMemChunk_t);
 }
 
+static inline bool mem_small_is_object(const void *addr) {
+    return ((size_t)addr % MYC_MEM_ARENA_PAGE_SIZE) != sizeof(MycMemChunk_t);
+}
+
+static inline MycMemSmallRun_t* mem_small_run_from_addr(void *addr) {
+    return (void*)((size_t)addr & ~(size_t)(MYC_MEM_SMALL_RUN_SIZE - 1)) + sizeof(MycMemChunk_t);
+}
+
+/* Sets up the small object classes of the head region 'arena'. */
+void mem_small_init(MycMemArena_t *arena);
+/* Forgets all small object runs of the arena, without freeing them. Used when the arena is reset. */
+void mem_small_reset(MycMemArena_t *arena);
+/* Releases the resources held by the small object classes. Used right before the arena is destroyed. */
+void mem_small_destroy(MycMemArena_t *arena);
+/* Allocates a small object of at least 'size' (at most MYC_MEM_SMALL_SIZE_MAX) bytes. */
+void* mem_small_malloc(MycMemArena_t *arena, uint32_t size);
+/* Allocates a small object of at least 'size' (at most MYC_MEM_SMALL_SIZE_MAX) bytes, aligned to 'alignment' (a power 
+of two up to MYC_MEM_SMALL_SIZE_MAX). */
+void* mem_small_aligned_malloc(MycMemArena_t *arena, uint32_t size, size_t alignment);
+/* Frees the small object at 'addr'. Runs that become fully empty are given back to the arena. */
+void mem_small_free(void *addr);
+/* Frees 'count' small objects of the class at once, bypassing the thread caches. */
+void mem_small_free_objects(const MycMemArena_t *arena, MycMemSmallClass_t *small_class, void *const *objects, uint32_t count);
+
+static inline uint32_t mem_small_get_object_size(void *addr) {
+    return mem_small_run_from_addr(addr)->small_class->object_size;
+}
+
+/* Allocations aligned beyond what chunks and small objects provide are served by aligned chunks. Those are laid out 
+like a run holding a single object, whose run header refers to no class and records the offset of the object. So their 
+addresses take the small object path, where a single load tells them apart from actual small objects. The object sits 
+at the first multiple of its alignment past the run header, so the chunk only grows by about the alignment. */
+static inline uint32_t calc_mem_aligned_object_offset(size_t alignment) {
+    return MYC_QUANTIZE_UP(sizeof(MycMemChunk_t) + sizeof(MycMemSmallRun_t), MYC_MAX(alignment, MYC_MEM_SMALL_OBJECT_ALIGNMENT));
+}
+
+/* Returns whether the object at 'addr', which takes the small object path, lives in an aligned chunk. */
+static inline bool mem_aligned_is_object(void *addr) {
+    return mem_small_run_from_addr(addr)->small_class == NULL;
+}
+
+static inline MycMemChunk_t* mem_aligned_chunk_from_addr(void *addr) {
+    return mem_chunk_from_addr(mem_small_run_from_addr(addr));
+}
+
+static inline uint32_t mem_aligned_get_object_offset(void *addr) {
+    return mem_small_run_from_addr(addr)->carve_offset;
+}
+
+/* Returns the region which holds the chunk or small object at 'addr'. */
+static inline MycMemArena_t* mem_arena_from_addr(void *addr) {
+    return mem_chunk_get_arena(mem_chunk_from_addr(mem_small_is_object(addr) ? (void*)mem_small_run_from_addr(addr) : addr));
+}
+
 typedef struct _MycMemoryChunkSearchInfo {
     MycMemArena_t *arena;
     size_t bucket_idx;
@@ -94,6 +329,131 @@ typedef struct _MycMemoryChunkSearchInfo {
     bool is_last_in_bucket;
 } MycMemChunkSearchInfo_t;
 
+/* Allocates a memory chunk of at least 'size' bytes, whose chunk header (not the returned address) is aligned 
+to a multiple of 'alignment'. The memory is freed with 'myc_mem_arena_free' as usual. */
+void* mem_arena_malloc_aligned_chunk(MycMemArena_t *arena, size_t size, size_t alignment);
+/* Frees a chunk back into the layout of its region, taking the region lock if needed. */
+void mem_chunk_release(MycMemChunk_t *chunk);
+
+/* Commits more of the reserved address space of the region, so the free tail of its last bucket grows by at least 
+'add_size' bytes. Fails if the region has not enough address space left. 
+!!NOTE: For thread safe arenas, the region lock must be held. */
+myc_err_t mem_arena_commit(MycMemArena_t *region, size_t add_size);
+/* Commits 'add_size' bytes in the first region of the arena which has enough reserved address space left, 
+and returns that region. Takes the region lock if needed. */
+myc_err_t mem_arena_commit_any(MycMemArena_t **committed_region, MycMemArena_t *arena, size_t add_size);
+
+/* Decay is checked on every n-th free into a dirty region, to keep the clock out of the free path. */
+#define MYC_MEM_ARENA_DECAY_CHECK_INTERVAL 64
+
+/* Marks the region dirty after memory was freed in it, and purges it if it has been dirty for longer than the decay 
+time of its arena. 
+!!NOTE: For thread safe arenas, the region lock must be held. */
+void mem_arena_note_free(MycMemArena_t *region);
+/* Returns the page aligned interior of all free bucket tails of the region to the OS. 
+!!NOTE: For thread safe arenas, the region lock must be held. */
+void mem_arena_purge_region(MycMemArena_t *region);
+
+
+
+/* Index over the regions of an arena, so the best suitable region is found in O(log n) instead of walking the region 
+list. Like the layout tree, it is an implicit max tree whose leaves are the root free sizes of the regions. 
+The index is owned by the head region and replaced by a larger copy when full. Replaced copies are only unmapped when 
+the arena is destroyed, because thread safe arenas search the index without holding any lock. */
+typedef struct _MycMemoryRegionIndex {
+    size_t size;
+    size_t capacity;
+    size_t region_count;
+    size_t level_count;
+    uint32_t *levels[MYC_MEM_LAYOUT_LEVEL_COUNT_MAX];      // Root level first, the leaves (regions) last.
+    MycMemArena_t **regions;
+    MycMemRegionIndex_t *retired;
+} MycMemRegionIndex_t;
+
+/* Creates the region index of the head region 'arena', containing only the head region itself. */
+myc_err_t mem_region_index_create(MycMemArena_t *arena);
+/* Unmaps the region index of the head region 'arena', including all replaced copies. */
+void mem_region_index_destroy(MycMemArena_t *arena);
+/* Adds the (not yet published) region to the index of its head region. */
+myc_err_t mem_region_index_insert(MycMemArena_t *region);
+/* Updates the leaf of the region after its root free size changed. Cheap if nothing changed. 
+!!NOTE: For thread safe arenas, the region lock must be held. */
+void mem_region_index_update(MycMemArena_t *region);
+/* Returns the region of the arena whose root free size best fits 'size', or NULL if no region is large enough. */
+MycMemArena_t* mem_region_index_find(const MycMemArena_t *arena, size_t size);
+
+
+
+#define MYC_MEM_THREAD_CACHE_CLASS_COUNT 8
+#define MYC_MEM_THREAD_CACHE_MAGAZINE_SIZE 32
+#define MYC_MEM_THREAD_CACHE_SLOT_COUNT 4
+#define MYC_MEM_THREAD_CACHE_SMALL_MAGAZINE_SIZE 32
+
+typedef struct _MycMemoryMagazine {
+    uint32_t chunk_count;
+    MycMemChunk_t *chunks[MYC_MEM_THREAD_CACHE_MAGAZINE_SIZE];
+} MycMemMagazine_t;
+
+/* Free small objects of one class, which are still allocated as far as their runs are concerned. They are taken from 
+and given back to the runs in batches of half a magazine, so the class lock is only taken once per batch. */
+typedef struct _MycMemorySmallMagazine {
+    uint32_t object_count;
+    void *objects[MYC_MEM_THREAD_CACHE_SMALL_MAGAZINE_SIZE];
+} MycMemSmallMagazine_t;
+
+typedef struct _MycMemoryThreadCache {
+    MycMemArena_t *arena;
+    MycMemThreadCache_t *prev;
+    MycMemThreadCache_t *next;
+    MycMemMagazine_t magazines[MYC_MEM_THREAD_CACHE_CLASS_COUNT];
+    MycMemSmallMagazine_t small_magazines[MYC_MEM_SMALL_CLASS_COUNT];
+    uint64_t counters[MYC_MEM_COUNTER_COUNT];   // Written by the owning thread only, folded into the arena on detach.
+} MycMemThreadCache_t;
+
+/* Returns the magazine index for chunks of 'chunk_size' bytes (including the header). */
+static inline size_t mem_thread_cache_class_idx(size_t chunk_size) {
+    return (chunk_size / MYC_MEM_ARENA_PAGE_SIZE) - 1;
+}
+
+/* Returns the calling thread's cache for the arena with head region 'arena', or NULL if no cache slot is available. */
+MycMemThreadCache_t* mem_thread_cache_get(MycMemArena_t *arena);
+/* Forgets all chunks cached by any thread for the arena, without freeing them. */
+void mem_thread_cache_reset_all(MycMemArena_t *arena);
+/* Detaches all thread caches from the arena. Used right before the arena is destroyed. */
+void mem_thread_cache_detach_all(MycMemArena_t *arena);
+
+/* Arenas are traced while their head region holds a trace. Every operation is recorded while holding the trace lock,
+which for reallocations is taken before the chunk moves, so an address is never recorded as reused before it was 
+recorded as released. */
+static inline bool mem_arena_is_traced(const MycMemArena_t *arena) {
+    return __atomic_load_n(&arena->head->trace, __ATOMIC_RELAXED) != NULL;
+}
+
+/* Takes the trace lock of the traced arena of region 'arena'. */
+void mem_trace_lock(MycMemArena_t *arena);
+void mem_trace_unlock(MycMemArena_t *arena);
+/* Records an operation of the traced arena of region 'arena'. 'addr' is the address before the operation, 
+'new_addr' the one after it (NULL for frees), and 'size' the requested size. 
+!!NOTE: The trace lock must be held. */
+void mem_trace_record(MycMemArena_t *arena, myc_mem_trace_op_t op, void *addr, void *new_addr, size_t size);
+
+/* Counts an operation on the arena of region 'arena'. Thread safe arenas count into the calling thread's cache, 
+so the counters never bounce between cores. Must not be called while holding the head region lock. */
+static inline void mem_arena_count(MycMemArena_t *arena, myc_mem_counter_t counter)
+{
+    arena = arena->head;
+    if (!mem_arena_is_thread_safe(arena)) {
+        arena->counters[counter] += 1;
+        return;
+    }
+    MycMemThreadCache_t *cache = mem_thread_cache_get(arena);
+    if (cache != NULL) {
+        __atomic_store_n(&cache->counters[counter], cache->counters[counter] + 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_add(&arena->counters[counter], 1, __ATOMIC_RELAXED);
+    }
+}
+
 
 
 
@@ -118,7 +478,61 @@ typedef struct _MycMemBumpAllocator {
     MycMemBumpAllocNode_t node;
     MycMemArena_t *arena;
     MycMemBumpAllocNode_t *current;
-    MycMemBumpAllocNode_t *last;
+    MycMemBumpAllocNode_t *last;            // Only a hint for concurrent bump allocators, the true last node is found from it.
+    MycMemBumpAllocNode_t *peak;            // Furthest node used since the last reset, 'current' moves back on rewinds.
+    MycMemBumpAllocNode_t *large_nodes;     // Dedicated nodes of oversized allocations, freed on reset.
+    myc_mem_bump_alloc_flags_t flags;
+    uint32_t node_size_max;
 } MycMemBumpAlloc_t;
 
+static inline bool mem_bump_alloc_is_concurrent(const MycMemBumpAlloc_t *bump_alloc) {
+    return (bump_alloc->flags & MYC_MEM_BUMP_ALLOC_FLAG_CONCURRENT) != 0;
+}
+
+static inline bool mem_bump_alloc_is_growing(const MycMemBumpAlloc_t *bump_alloc) {
+    return (bump_alloc->flags & MYC_MEM_BUMP_ALLOC_FLAG_GROW) != 0;
+}
+
+
+
+typedef struct _MycMemFrameAllocator {
+    uint32_t frame_count;
+    uint32_t frame_idx;
+    MycMemBumpAlloc_t *frames[];
+} MycMemFrameAlloc_t;
+
+
+
+#define MYC_MEM_POOL_SLAB_SIZE_MIN 4096
+#define MYC_MEM_POOL_SLAB_OBJECT_COUNT_MIN 16
+
+typedef struct _MycMemPoolAllocator MycMemPoolAlloc_t;
+typedef struct _MycMemPoolAllocatorSlab MycMemPoolAllocSlab_t;
+
+/* Slabs are chunks aligned to their own (power of two) size, so the slab header of any object is found by masking 
+its address. Free objects are linked through their own first bytes, no object carries a header. */
+typedef struct _MycMemPoolAllocatorSlab {
+    MycMemPoolAlloc_t *pool_alloc;
+    MycMemPoolAllocSlab_t *prev;
+    MycMemPoolAllocSlab_t *next;
+    void *free_list;
+    uint32_t free_count;
+    uint32_t carve_offset;      // Objects past this offset have never been handed out and are not in the free list.
+} MycMemPoolAllocSlab_t;
+
+static inline MycMemPoolAllocSlab_t* mem_pool_alloc_slab_from_addr(void *addr, uint32_t slab_size) {
+    return mem_addr_from_chunk((MycMemChunk_t*)((size_t)addr & ~((size_t)slab_size - 1)));
+}
+
+typedef struct _MycMemPoolAllocator {
+    MycMemArena_t *arena;
+    uint32_t object_size;
+    uint32_t object_count;      // Per slab.
+    uint32_t slab_size;
+    uint32_t first_object_offset;
+    MycMemPoolAllocSlab_t *partial_slabs;
+    MycMemPoolAllocSlab_t *full_slabs;
+    MycMemPoolAllocSlab_t *empty_slab;      // A single empty slab is kept around to avoid thrashing the arena.
+} MycMemPoolAlloc_t;
+
 #endif // _MYC_MEMORY_INTENRAL_H_
\ No newline at end of file
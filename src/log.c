@@ -1,115 +1,847 @@
 #include <stdarg.h>
 typedef va_list va_list_t;
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "myc/log.h"
 
-static inline void print_header(const char *label, const char *func_name, const char *file_path, int line_nr) 
+#define MYC_LOG_HEADER_FMT "%s:   In function '"MYC_FMT_BOLD("%s")"'   (file: "MYC_FMT_BOLD("%s")" | line: "MYC_FMT_BOLD("%d")"):\n"
+#define MYC_LOG_MESSAGE_PREFIX "  | "
+
+/* Lines are formatted on the stack, longer lines are formatted a second time into a heap buffer. */
+#define MYC_LOG_LINE_INLINE_SIZE 512
+
+#define MYC_LOG_RING_SIZE_MIN 4096
+#define MYC_LOG_WRITER_IOV_COUNT 64
+#define MYC_LOG_WRITER_IDLE_NS 1000000
+
+/* Binary entries are built on the stack, unless their string arguments are too long for it. */
+#define MYC_LOG_BINARY_ENTRY_INLINE_SIZE 512
+
+static const char *const log_labels[MYC_LOG_LABEL_COUNT] = {
+    [MYC_LOG_LABEL_NONE] = NULL,
+    [MYC_LOG_LABEL_ERROR] = "["MYC_FMT_RED("ERROR")"]",
+    [MYC_LOG_LABEL_TRACE] = "("MYC_FMT_RED("trace")")",
+    [MYC_LOG_LABEL_WARN] = "["MYC_FMT_YELLOW("WARNING")"]",
+    [MYC_LOG_LABEL_INFO] = "["MYC_FMT_GREEN("INFO")"]",
+    [MYC_LOG_LABEL_DEBUG] = "(debug)",
+    [MYC_LOG_LABEL_TODO] = "["MYC_FMT_BLUE("TODO")"]",
+};
+
+/* Runtime level a call site needs to be enabled, by its label. */
+static const myc_log_level_t log_label_levels[MYC_LOG_LABEL_COUNT] = {
+    [MYC_LOG_LABEL_NONE] = MYC_LOG_LEVEL_ERROR,
+    [MYC_LOG_LABEL_ERROR] = MYC_LOG_LEVEL_ERROR,
+    [MYC_LOG_LABEL_TRACE] = MYC_LOG_LEVEL_DEBUG,
+    [MYC_LOG_LABEL_WARN] = MYC_LOG_LEVEL_INFO,
+    [MYC_LOG_LABEL_INFO] = MYC_LOG_LEVEL_INFO,
+    [MYC_LOG_LABEL_DEBUG] = MYC_LOG_LEVEL_DEBUG,
+    [MYC_LOG_LABEL_TODO] = MYC_LOG_LEVEL_DEBUG,
+};
+
+static const char *const log_level_names[] = {
+    [MYC_LOG_LEVEL_NONE] = "none",
+    [MYC_LOG_LEVEL_ERROR] = "error",
+    [MYC_LOG_LEVEL_INFO] = "info",
+    [MYC_LOG_LEVEL_DEBUG] = "debug",
+};
+
+/* Records in the ring are 8 byte aligned and start with this header, followed by the text of the line. A record never
+wraps around the end of the ring, the space up to the end is filled with a skip record instead. */
+typedef struct MycLogRingRecord {
+    uint32_t length;
+    uint32_t state;
+} MycLogRingRecord_t;
+
+enum {
+    MYC_LOG_RING_RECORD_EMPTY = 0,
+    MYC_LOG_RING_RECORD_COMMITTED,
+    MYC_LOG_RING_RECORD_SKIP,
+};
+
+/* Multi producer, single consumer ring of log lines. Producers reserve records by a compare-and-swap on 'write_pos' and
+commit them by setting their state. The writer thread is the only consumer, it writes out all committed records up to
+the first uncommitted one and zeroes them again before moving 'read_pos' past them. */
+typedef struct MycLogRing {
+    uint8_t *data;
+    size_t capacity;        // Power of two.
+    int fd;                 // Either stderr, or the file of the binary log.
+    bool is_binary;
+    myc_log_async_full_policy_t full_policy;
+    pthread_t writer;
+    bool is_stopping;
+    uint64_t dropped_count;
+    uint64_t reported_dropped_count;
+    _Alignas(64) size_t write_pos;
+    _Alignas(64) size_t read_pos;
+} MycLogRing_t;
+
+static MycLogRing_t log_ring;
+static MycLogRing_t *log_active_ring = NULL;
+
+uint32_t _myc_private_log_binary_session = 0;
+static uint32_t log_binary_session_count = 0;
+static uint32_t log_binary_site_count = 0;
+
+/* A module level, matching the module name or file path of call sites. Later rules take precedence. */
+typedef struct MycLogLevelRule {
+    char *pattern;
+    myc_log_level_t level;
+} MycLogLevelRule_t;
+
+/* Call sites cache whether they are enabled together with the generation they were resolved in. Starting at two makes
+the zero initialized cache of a new site mismatch both the enabled and the disabled value. */
+uint32_t _myc_private_log_level_generation = 2;
+static pthread_mutex_t log_level_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t log_level_env_once = PTHREAD_ONCE_INIT;
+static myc_log_level_t log_default_level = MYC_LOG_LEVEL_DEBUG;
+static MycLogLevelRule_t *log_level_rules = NULL;
+static size_t log_level_rule_count = 0;
+
+static void log_line(bool is_urgent, const char *label, const char *func_name, const char *file_path, int line_nr, const char *message_fmt, va_list_t args);
+static myc_err_t log_ring_start(int fd, bool is_binary, size_t ring_size, myc_log_async_full_policy_t full_policy);
+static bool log_ring_push(MycLogRing_t *ring, const void *data, size_t length, myc_log_async_full_policy_t full_policy);
+static size_t log_ring_drain(MycLogRing_t *ring);
+static void* log_writer_main(void *arg);
+static void log_write_all(int fd, struct iovec *iov, int iov_count);
+static uint64_t log_binary_register_site(MycLogRing_t *ring, MycLogSite_t *site, uint32_t session, uint64_t registration);
+static uint16_t log_binary_string_mask(const MycLogSite_t *site);
+static void log_level_read_env(void);
+static myc_err_t log_level_configure_locked(const char *config);
+static myc_err_t log_level_set_rule_locked(const char *pattern, myc_log_level_t level);
+static void log_level_advance_generation_locked(void);
+
+static inline size_t log_ring_record_size(uint32_t length)
 {
-    fprintf(stderr, "%s:   In function '"MYC_FMT_BOLD("%s")"'   (file: "MYC_FMT_BOLD("%s")" | line: "MYC_FMT_BOLD("%d")"):\n",
-            label, func_name, file_path, line_nr);
+    return (sizeof(MycLogRingRecord_t) + length + 7) & ~(size_t)7;
 }
 
-static void print_message(const char *message_fmt, va_list_t args)
+static inline MycLogRingRecord_t* log_ring_record_at(const MycLogRing_t *ring, size_t pos)
 {
-    const size_t buffer_size = 1 + snprintf(NULL, 0, "  | %s\n", message_fmt);
-    char fmt[buffer_size];
-    snprintf(fmt, buffer_size, "  | %s\n", message_fmt);
-    vfprintf(stderr, fmt, args);
+    return (MycLogRingRecord_t*)(ring->data + (pos & (ring->capacity - 1)));
+}
+
+/* Starts logging asynchronously: log calls only format their line into a ring of 'ring_size' bytes, which a background
+thread writes to stderr in batches. 'full_policy' decides what happens to lines which do not fit into the ring. */
+myc_err_t myc_log_async_start(size_t ring_size, myc_log_async_full_policy_t full_policy)
+{
+    return log_ring_start(STDERR_FILENO, false, ring_size, full_policy);
+}
+
+/* Writes out all pending lines and goes back to logging synchronously.
+!!NOTE: No other thread may log during this call. */
+void myc_log_async_stop(void)
+{
+    MycLogRing_t *ring = log_active_ring;
+    if (ring == NULL) {
+        return;
+    }
+    __atomic_store_n(&_myc_private_log_binary_session, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&log_active_ring, NULL, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->is_stopping, true, __ATOMIC_RELEASE);
+    pthread_join(ring->writer, NULL);
+    munmap(ring->data, ring->capacity);
+    if (ring->is_binary && close(ring->fd) != 0) {
+        MYC_LOG_WARN("Closing the binary log failed.   =>   %s.", strerror(errno));
+    }
+}
+
+/* Starts logging in binary form to the file at 'path': log calls only record their call site once and the raw bytes
+of their arguments, the lines are formatted offline by the 'log-decode' tool. Entries are written by the background
+thread of asynchronous logging (see 'myc_log_async_start'), with a ring of 'ring_size' bytes. */
+myc_err_t myc_log_binary_start(const char *path, size_t ring_size, myc_log_async_full_policy_t full_policy)
+{
+    if (log_active_ring != NULL) {
+        return MYC_ERR_INVALID_ARGUMENT;
+    }
+    const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        MYC_LOG_ERROR("Cannot open binary log '%s'.   =>   %s.", path, strerror(errno));
+        return MYC_FAILED;
+    }
+
+    myc_err_t exit_code;
+    MycLogBinaryHeader_t header = { .magic = MYC_LOG_BINARY_MAGIC, .version = MYC_LOG_BINARY_VERSION };
+    struct iovec iov = { .iov_base = &header, .iov_len = sizeof(header) };
+    log_write_all(fd, &iov, 1);
+    if ((exit_code = log_ring_start(fd, true, ring_size, full_policy)) != MYC_SUCCESS) {
+        close(fd);
+        return exit_code;
+    }
+
+    /* Site ids start over with every binary log, sites registered with an older session register again. */
+    log_binary_site_count = 0;
+    log_binary_session_count += 1;
+    __atomic_store_n(&_myc_private_log_binary_session, log_binary_session_count, __ATOMIC_RELEASE);
+    return MYC_SUCCESS;
+}
+
+/* Writes out all pending entries, closes the binary log and goes back to logging synchronously.
+!!NOTE: No other thread may log during this call. */
+void myc_log_binary_stop(void)
+{
+    if (log_active_ring != NULL && log_active_ring->is_binary) {
+        myc_log_async_stop();
+    }
+}
+
+static myc_err_t log_ring_start(int fd, bool is_binary, size_t ring_size, myc_log_async_full_policy_t full_policy)
+{
+    if (log_active_ring != NULL) {
+        return MYC_ERR_INVALID_ARGUMENT;
+    }
+
+    size_t capacity = MYC_LOG_RING_SIZE_MIN;
+    while (capacity < ring_size) {
+        capacity *= 2;
+    }
+    uint8_t *data = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+        return MYC_ERR_NO_MEMORY;
+    }
+
+    MycLogRing_t *ring = &log_ring;
+    *ring = (MycLogRing_t){ .data = data, .capacity = capacity, .fd = fd, .is_binary = is_binary, .full_policy = full_policy };
+    fflush(stderr);
+    if (pthread_create(&ring->writer, NULL, log_writer_main, ring) != 0) {
+        munmap(data, capacity);
+        return MYC_FAILED;
+    }
+    __atomic_store_n(&log_active_ring, ring, __ATOMIC_RELEASE);
+    return MYC_SUCCESS;
+}
+
+/* Blocks until every line logged before this call has been written out. */
+void myc_log_flush(void)
+{
+    MycLogRing_t *ring = __atomic_load_n(&log_active_ring, __ATOMIC_ACQUIRE);
+    if (ring == NULL) {
+        fflush(stderr);
+        return;
+    }
+
+    const size_t write_pos = __atomic_load_n(&ring->write_pos, __ATOMIC_ACQUIRE);
+    const struct timespec wait_time = { .tv_sec = 0, .tv_nsec = MYC_LOG_WRITER_IDLE_NS / 16 };
+    while ((ptrdiff_t)(write_pos - __atomic_load_n(&ring->read_pos, __ATOMIC_ACQUIRE)) > 0) {
+        nanosleep(&wait_time, NULL);
+    }
+}
+
+/* Returns the number of lines dropped because the ring was full, since asynchronous logging was started. */
+uint64_t myc_log_async_get_dropped_count(void)
+{
+    return __atomic_load_n(&log_ring.dropped_count, __ATOMIC_RELAXED);
 }
 
 void _myc_private_log(const char *message_fmt, ...)
 {
     va_list_t args;
     va_start(args, message_fmt);
-    print_message(message_fmt, args);
+    log_line(false, NULL, NULL, NULL, 0, message_fmt, args);
     va_end(args);
 }
 
 void _myc_private_log_error(const char *func_name, const char *file_path, int line_nr, const char *message_fmt, ...)
 {
-    print_header("["MYC_FMT_RED("ERROR")"]", func_name, file_path, line_nr);
-    
     va_list_t args;
     va_start(args, message_fmt);
-    print_message(message_fmt, args);
+    log_line(false, log_labels[MYC_LOG_LABEL_ERROR], func_name, file_path, line_nr, message_fmt, args);
     va_end(args);
 }
 
 void _myc_private_log_trace(const char *func_name, const char *file_path, int line_nr, const char *message_fmt, ...)
 {
-    print_header("("MYC_FMT_RED("trace")")", func_name, file_path, line_nr);
-    
     va_list_t args;
     va_start(args, message_fmt);
-    print_message(message_fmt, args);
+    log_line(false, log_labels[MYC_LOG_LABEL_TRACE], func_name, file_path, line_nr, message_fmt, args);
     va_end(args);
 }
 
 void _myc_private_log_warn(const char *func_name, const char *file_path, int line_nr, const char *message_fmt, ...)
 {
-    print_header("["MYC_FMT_YELLOW("WARNING")"]", func_name, file_path, line_nr);
-    
     va_list_t args;
     va_start(args, message_fmt);
-    print_message(message_fmt, args);
+    log_line(false, log_labels[MYC_LOG_LABEL_WARN], func_name, file_path, line_nr, message_fmt, args);
     va_end(args);
 }
 
 void _myc_private_log_info(const char *func_name, const char *file_path, int line_nr, const char *message_fmt, ...)
 {
-    print_header("["MYC_FMT_GREEN("INFO")"]", func_name, file_path, line_nr);
-    
     va_list_t args;
     va_start(args, message_fmt);
-    print_message(message_fmt, args);
+    log_line(false, log_labels[MYC_LOG_LABEL_INFO], func_name, file_path, line_nr, message_fmt, args);
     va_end(args);
 }
 
 void _myc_private_log_debug(const char *func_name, const char *file_path, int line_nr, const char *message_fmt, ...)
 {
-    print_header("(debug)", func_name, file_path, line_nr);
-    
     va_list_t args;
     va_start(args, message_fmt);
-    print_message(message_fmt, args);
+    log_line(false, log_labels[MYC_LOG_LABEL_DEBUG], func_name, file_path, line_nr, message_fmt, args);
     va_end(args);
 }
 
 void _myc_private_log_todo(const char *func_name, const char *file_path, int line_nr, const char *message_fmt, ...)
 {
-    print_header("["MYC_FMT_BLUE("TODO")"]", func_name, file_path, line_nr);
-    
     va_list_t args;
     va_start(args, message_fmt);
-    print_message(message_fmt, args);
+    log_line(false, log_labels[MYC_LOG_LABEL_TODO], func_name, file_path, line_nr, message_fmt, args);
     va_end(args);
 }
 
 void _myc_private_log_assert_failed(const char *func_name, const char *file_path, int line_nr, const char *check, const char *message_fmt, ...)
 {
-    print_header("["MYC_FMT_RED("FAILED ASSERTION")"]", func_name, file_path, line_nr);
-
     const size_t buffer_size = 1 + snprintf(NULL, 0, "Assertion '"MYC_FMT_RED("%s")"' failed!   =>   %s", check, message_fmt);
     char ext_message_fmt[buffer_size];
     snprintf(ext_message_fmt, buffer_size, "Assert '"MYC_FMT_RED("%s")"' failed!   =>   %s", check, message_fmt);
 
     va_list_t args;
     va_start(args, message_fmt);
-    print_message(ext_message_fmt, args);
+    log_line(true, "["MYC_FMT_RED("FAILED ASSERTION")"]", func_name, file_path, line_nr, ext_message_fmt, args);
     va_end(args);
 }
 
 void _myc_private_log_unreachable(const char *func_name, const char *file_path, int line_nr, const char *message_fmt, ...)
 {
-    print_header("["MYC_FMT_RED("UNREACHABLE CODE")"]", func_name, file_path, line_nr);
-
     const size_t buffer_size = 1 + snprintf(NULL, 0, "Broken control flow   =>   %s", message_fmt);
     char ext_message_fmt[buffer_size];
     snprintf(ext_message_fmt, buffer_size, "Broken control flow   =>   %s", message_fmt);
 
     va_list_t args;
     va_start(args, message_fmt);
-    print_message(ext_message_fmt, args);
+    log_line(true, "["MYC_FMT_RED("UNREACHABLE CODE")"]", func_name, file_path, line_nr, ext_message_fmt, args);
     va_end(args);
-}
\ No newline at end of file
+}
+
+/* Formats the header (if there is a label) and the message into 'line', and returns the length of the whole line,
+which is only written completely if it is shorter than 'line_size'. */
+static size_t log_format(char *line, size_t line_size, const char *label, const char *func_name, const char *file_path, int line_nr, const char *message_fmt, va_list_t args)
+{
+    size_t length = (label != NULL)
+            ? (size_t)snprintf(line, line_size, MYC_LOG_HEADER_FMT MYC_LOG_MESSAGE_PREFIX, label, func_name, file_path, line_nr)
+            : (size_t)snprintf(line, line_size, MYC_LOG_MESSAGE_PREFIX);
+    const size_t offset = (length < line_size) ? length : line_size;
+    length += (size_t)vsnprintf(line + offset, line_size - offset, message_fmt, args);
+    if (length + 1 < line_size) {
+        line[length] = '\n';
+        line[length + 1] = '\0';
+    }
+    return length + 1;
+}
+
+/* Formats a line and hands it to the writer thread, or writes it to stderr right away when logging synchronously.
+Urgent lines (i.e. the last words before an abort) first wait for all pending lines and are always written directly. */
+static void log_line(bool is_urgent, const char *label, const char *func_name, const char *file_path, int line_nr, const char *message_fmt, va_list_t args)
+{
+    char inline_line[MYC_LOG_LINE_INLINE_SIZE];
+    va_list_t args_copy;
+    va_copy(args_copy, args);
+    char *line = inline_line;
+    size_t length = log_format(inline_line, sizeof(inline_line), label, func_name, file_path, line_nr, message_fmt, args);
+    if (length >= sizeof(inline_line)) {
+        line = malloc(length + 1);
+        if (line != NULL) {
+            log_format(line, length + 1, label, func_name, file_path, line_nr, message_fmt, args_copy);
+        } else {
+            line = inline_line;     // Cut off.
+            length = sizeof(inline_line) - 1;
+        }
+    }
+    va_end(args_copy);
+
+    MycLogRing_t *ring = __atomic_load_n(&log_active_ring, __ATOMIC_ACQUIRE);
+    if (ring == NULL || is_urgent || ring->is_binary || !log_ring_push(ring, line, length, ring->full_policy)) {
+        myc_log_flush();
+        fwrite(line, 1, length, stderr);
+    }
+    if (line != inline_line) {
+        free(line);
+    }
+}
+
+/* Copies the data into a new record. Returns false if the data is too long for the ring,
+data dropped because the ring is full counts as pushed. */
+static bool log_ring_push(MycLogRing_t *ring, const void *data, size_t length, myc_log_async_full_policy_t full_policy)
+{
+    const size_t record_size = log_ring_record_size((uint32_t)length);
+    if (length > UINT32_MAX || record_size > ring->capacity / 2) {
+        return false;
+    }
+
+    size_t pos = __atomic_load_n(&ring->write_pos, __ATOMIC_RELAXED);
+    size_t skip_size;
+    for (;;) {
+        const size_t offset = pos & (ring->capacity - 1);
+        skip_size = (ring->capacity - offset < record_size) ? ring->capacity - offset : 0;
+        if (pos + skip_size + record_size - __atomic_load_n(&ring->read_pos, __ATOMIC_ACQUIRE) > ring->capacity) {
+            if (full_policy == MYC_LOG_ASYNC_FULL_DROP) {
+                __atomic_fetch_add(&ring->dropped_count, 1, __ATOMIC_RELAXED);
+                return true;
+            }
+            sched_yield();
+            pos = __atomic_load_n(&ring->write_pos, __ATOMIC_RELAXED);
+            continue;
+        }
+        if (__atomic_compare_exchange_n(&ring->write_pos, &pos, pos + skip_size + record_size, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+
+    if (skip_size > 0) {
+        MycLogRingRecord_t *skip_record = log_ring_record_at(ring, pos);
+        skip_record->length = (uint32_t)(skip_size - sizeof(MycLogRingRecord_t));
+        __atomic_store_n(&skip_record->state, MYC_LOG_RING_RECORD_SKIP, __ATOMIC_RELEASE);
+    }
+    MycLogRingRecord_t *record = log_ring_record_at(ring, pos + skip_size);
+    memcpy(record + 1, data, length);
+    record->length = (uint32_t)length;
+    __atomic_store_n(&record->state, MYC_LOG_RING_RECORD_COMMITTED, __ATOMIC_RELEASE);
+    return true;
+}
+
+/* Writes out the committed records at the front of the ring with a single 'writev', and returns the number of bytes
+consumed from the ring. Records are zeroed before they are given back, so stale text is never taken for a header. */
+static size_t log_ring_drain(MycLogRing_t *ring)
+{
+    struct iovec iov[MYC_LOG_WRITER_IOV_COUNT];
+    int iov_count = 0;
+    /* A ring filled up to its capacity wraps around onto its own first record, so the records are bounded by the 
+    write position rather than by finding an empty one. */
+    const size_t write_pos = __atomic_load_n(&ring->write_pos, __ATOMIC_ACQUIRE);
+    const size_t read_pos = ring->read_pos;
+    size_t pos = read_pos;
+    while (pos != write_pos && iov_count < MYC_LOG_WRITER_IOV_COUNT) {
+        MycLogRingRecord_t *record = log_ring_record_at(ring, pos);
+        const uint32_t state = __atomic_load_n(&record->state, __ATOMIC_ACQUIRE);
+        if (state == MYC_LOG_RING_RECORD_EMPTY) {
+            break;
+        }
+        if (state == MYC_LOG_RING_RECORD_COMMITTED) {
+            iov[iov_count++] = (struct iovec){ .iov_base = record + 1, .iov_len = record->length };
+        }
+        pos += log_ring_record_size(record->length);
+    }
+    if (pos == read_pos) {
+        return 0;
+    }
+
+    log_write_all(ring->fd, iov, iov_count);
+    const size_t offset = read_pos & (ring->capacity - 1);
+    const size_t size = pos - read_pos;
+    if (offset + size <= ring->capacity) {
+        memset(ring->data + offset, 0, size);
+    } else {
+        memset(ring->data + offset, 0, ring->capacity - offset);
+        memset(ring->data, 0, offset + size - ring->capacity);
+    }
+    __atomic_store_n(&ring->read_pos, pos, __ATOMIC_RELEASE);
+    return size;
+}
+
+static void* log_writer_main(void *arg)
+{
+    MycLogRing_t *ring = arg;
+    const struct timespec idle_time = { .tv_sec = 0, .tv_nsec = MYC_LOG_WRITER_IDLE_NS };
+    for (;;) {
+        const bool is_stopping = __atomic_load_n(&ring->is_stopping, __ATOMIC_ACQUIRE);
+        const size_t drained_size = log_ring_drain(ring);
+
+        const uint64_t dropped_count = __atomic_load_n(&ring->dropped_count, __ATOMIC_RELAXED);
+        if (dropped_count != ring->reported_dropped_count) {
+            char line[MYC_LOG_LINE_INLINE_SIZE];
+            const int length = snprintf(line, sizeof(line), MYC_LOG_HEADER_FMT MYC_LOG_MESSAGE_PREFIX "%lu log messages dropped, the log ring is full.\n",
+                    "["MYC_FMT_YELLOW("WARNING")"]", __FUNC_NAME__, __FILE__, __LINE__, dropped_count - ring->reported_dropped_count);
+            struct iovec iov = { .iov_base = line, .iov_len = (size_t)length };
+            log_write_all(STDERR_FILENO, &iov, 1);
+            ring->reported_dropped_count = dropped_count;
+        }
+
+        if (drained_size == 0) {
+            if (is_stopping) {
+                break;
+            }
+            nanosleep(&idle_time, NULL);
+        }
+    }
+    return NULL;
+}
+
+static void log_write_all(int fd, struct iovec *iov, int iov_count)
+{
+    while (iov_count > 0) {
+        ssize_t written_size = writev(fd, iov, iov_count);
+        if (written_size < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written_size < 0) {
+            return;     // Nowhere left to report this.
+        }
+        while (iov_count > 0 && (size_t)written_size >= iov->iov_len) {
+            written_size -= (ssize_t)iov->iov_len;
+            ++iov;
+            --iov_count;
+        }
+        if (iov_count > 0) {
+            iov->iov_base = (uint8_t*)iov->iov_base + written_size;
+            iov->iov_len -= (size_t)written_size;
+        }
+    }
+}
+
+/* Records the call site and raw arguments of a log call in the binary log. String arguments are copied, so they may
+change right after the call. */
+void _myc_private_log_binary(MycLogSite_t *site, const MycLogArg_t *args)
+{
+    MycLogRing_t *ring = __atomic_load_n(&log_active_ring, __ATOMIC_ACQUIRE);
+    const uint32_t session = __atomic_load_n(&_myc_private_log_binary_session, __ATOMIC_ACQUIRE);
+    if (ring == NULL || session == 0) {
+        return;     // Binary logging was stopped right after the check at the call site.
+    }
+    uint64_t registration = __atomic_load_n(&site->registration, __ATOMIC_ACQUIRE);
+    if ((uint32_t)(registration >> 32) != session) {
+        registration = log_binary_register_site(ring, site, session, registration);
+    }
+
+    uint32_t string_lengths[MYC_LOG_BINARY_ARG_COUNT_MAX];
+    size_t size = sizeof(MycLogBinaryEntry_t) + site->arg_count * sizeof(MycLogArg_t);
+    for (uint16_t arg_idx = 0; arg_idx < site->arg_count; ++arg_idx) {
+        if ((site->string_mask >> arg_idx) & 1) {
+            const char *string = (args[arg_idx].s != NULL) ? args[arg_idx].s : "(null)";
+            string_lengths[arg_idx] = (uint32_t)strlen(string);
+            size += MYC_LOG_BINARY_STRING_SIZE(string_lengths[arg_idx]);
+        }
+    }
+
+    uint8_t inline_entry[MYC_LOG_BINARY_ENTRY_INLINE_SIZE];
+    uint8_t *entry = (size <= sizeof(inline_entry)) ? inline_entry : malloc(size);
+    if (entry == NULL) {
+        __atomic_fetch_add(&ring->dropped_count, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    *(MycLogBinaryEntry_t*)entry = (MycLogBinaryEntry_t){
+        .size = (uint32_t)size,
+        .kind = MYC_LOG_BINARY_ENTRY_LINE,
+        .arg_count = site->arg_count,
+        .site_id = (uint32_t)registration,
+    };
+    MycLogArg_t *slots = (MycLogArg_t*)(entry + sizeof(MycLogBinaryEntry_t));
+    uint8_t *string_data = (uint8_t*)(slots + site->arg_count);
+    for (uint16_t arg_idx = 0; arg_idx < site->arg_count; ++arg_idx) {
+        if (!((site->string_mask >> arg_idx) & 1)) {
+            memcpy(&slots[arg_idx], &args[arg_idx], sizeof(MycLogArg_t));
+            continue;
+        }
+        const char *string = (args[arg_idx].s != NULL) ? args[arg_idx].s : "(null)";
+        const size_t padded_length = MYC_LOG_BINARY_STRING_SIZE(string_lengths[arg_idx]);
+        slots[arg_idx] = (MycLogArg_t){ .u = string_lengths[arg_idx] };
+        memcpy(string_data, string, string_lengths[arg_idx]);
+        memset(string_data + string_lengths[arg_idx], 0, padded_length - string_lengths[arg_idx]);
+        string_data += padded_length;
+    }
+
+    if (!log_ring_push(ring, entry, size, ring->full_policy)) {
+        __atomic_fetch_add(&ring->dropped_count, 1, __ATOMIC_RELAXED);
+    }
+    if (entry != inline_entry) {
+        free(entry);
+    }
+}
+
+/* Assigns the site an id for this session and writes its site entry, unless another thread was faster. Site entries
+are never dropped, since none of the lines of the site could be decoded without them. */
+static uint64_t log_binary_register_site(MycLogRing_t *ring, MycLogSite_t *site, uint32_t session, uint64_t registration)
+{
+    /* The mask is the same for every thread registering the site, and published along with the registration. */
+    const uint16_t string_mask = log_binary_string_mask(site);
+    __atomic_store_n(&site->string_mask, string_mask, __ATOMIC_RELAXED);
+    const uint32_t site_id = __atomic_add_fetch(&log_binary_site_count, 1, __ATOMIC_RELAXED);
+    const uint64_t new_registration = ((uint64_t)session << 32) | site_id;
+    if (!__atomic_compare_exchange_n(&site->registration, &registration, new_registration, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        return registration;
+    }
+
+    const char *label = (log_labels[site->label] != NULL) ? log_labels[site->label] : "";
+    const char *strings[] = { label, site->func_name, site->file_path, site->message_fmt };
+    size_t size = sizeof(MycLogBinaryEntry_t) + site->arg_count;
+    for (size_t string_idx = 0; string_idx < sizeof(strings) / sizeof(strings[0]); ++string_idx) {
+        size += strlen(strings[string_idx]) + 1;
+    }
+    size = (size + 7) & ~(size_t)7;
+
+    uint8_t *entry = calloc(1, size);
+    if (entry == NULL) {
+        return new_registration;    // The lines of this site cannot be decoded, but are still logged.
+    }
+    *(MycLogBinaryEntry_t*)entry = (MycLogBinaryEntry_t){
+        .size = (uint32_t)size,
+        .kind = MYC_LOG_BINARY_ENTRY_SITE,
+        .arg_count = site->arg_count,
+        .site_id = site_id,
+        .line_nr = site->line_nr,
+    };
+    uint8_t *data = entry + sizeof(MycLogBinaryEntry_t);
+    for (uint16_t arg_idx = 0; arg_idx < site->arg_count; ++arg_idx) {
+        const bool is_pointer = site->arg_types[arg_idx] == MYC_LOG_ARG_STRING || site->arg_types[arg_idx] == MYC_LOG_ARG_POINTER;
+        data[arg_idx] = !is_pointer ? site->arg_types[arg_idx]
+                : ((string_mask >> arg_idx) & 1) ? MYC_LOG_ARG_STRING : MYC_LOG_ARG_POINTER;
+    }
+    data += site->arg_count;
+    for (size_t string_idx = 0; string_idx < sizeof(strings) / sizeof(strings[0]); ++string_idx) {
+        const size_t length = strlen(strings[string_idx]) + 1;
+        memcpy(data, strings[string_idx], length);
+        data += length;
+    }
+    log_ring_push(ring, entry, size, MYC_LOG_ASYNC_FULL_BLOCK);
+    free(entry);
+    return new_registration;
+}
+
+/* Walks the conversions of the message format like 'log-decode' does, marking the pointer arguments consumed by '%s'.
+Every other pointer is recorded as such, so a 'char*' logged with '%p' is never read as a string. */
+static uint16_t log_binary_string_mask(const MycLogSite_t *site)
+{
+    uint16_t string_mask = 0;
+    size_t arg_idx = 0;
+    const char *fmt = site->message_fmt;
+    while (*fmt != '\0' && arg_idx < site->arg_count) {
+        if (*fmt++ != '%') {
+            continue;
+        }
+        if (*fmt == '%') {
+            ++fmt;
+            continue;
+        }
+        while (*fmt != '\0' && strchr("-+ #0'", *fmt) != NULL) {
+            ++fmt;
+        }
+        for (int field = 0; field < 2; ++field) {
+            if (field == 1) {
+                if (*fmt != '.') break;
+                ++fmt;
+            }
+            if (*fmt == '*') {
+                arg_idx += 1;
+                ++fmt;
+            }
+            while (*fmt >= '0' && *fmt <= '9') {
+                ++fmt;
+            }
+        }
+        while (*fmt != '\0' && strchr("hlLqjzt", *fmt) != NULL) {
+            ++fmt;
+        }
+        if (*fmt == '\0') {
+            break;
+        }
+        if (*fmt == 's' && arg_idx < site->arg_count
+                && (site->arg_types[arg_idx] == MYC_LOG_ARG_STRING || site->arg_types[arg_idx] == MYC_LOG_ARG_POINTER)) {
+            string_mask |= (uint16_t)(1u << arg_idx);
+        }
+        if (*fmt != 'n') {
+            arg_idx += 1;
+        }
+        ++fmt;
+    }
+    return string_mask;
+}
+
+
+
+/* Sets the level of all call sites not matched by a module level. */
+void myc_log_set_level(myc_log_level_t level)
+{
+    if ((unsigned)level > MYC_LOG_LEVEL_DEBUG) {
+        level = MYC_LOG_LEVEL_DEBUG;
+    }
+    pthread_once(&log_level_env_once, log_level_read_env);
+    pthread_mutex_lock(&log_level_mutex);
+    log_default_level = level;
+    log_level_advance_generation_locked();
+    pthread_mutex_unlock(&log_level_mutex);
+}
+
+/* Sets the level of all call sites whose module name or file path matches 'pattern', a glob as understood by fnmatch.
+When several patterns match a site, the one set last wins. Setting a pattern again replaces its level. */
+myc_err_t myc_log_set_module_level(const char *pattern, myc_log_level_t level)
+{
+    pthread_once(&log_level_env_once, log_level_read_env);
+    pthread_mutex_lock(&log_level_mutex);
+    const myc_err_t result = log_level_set_rule_locked(pattern, level);
+    log_level_advance_generation_locked();
+    pthread_mutex_unlock(&log_level_mutex);
+    return result;
+}
+
+/* Applies a comma separated list of levels, e.g. "info,memory=debug,src/log.c=0". An entry without pattern sets the
+level of all call sites not matched by a module level. */
+myc_err_t myc_log_configure(const char *config)
+{
+    if (config == NULL) {
+        return MYC_ERR_INVALID_ARGUMENT;
+    }
+    pthread_once(&log_level_env_once, log_level_read_env);
+    pthread_mutex_lock(&log_level_mutex);
+    const myc_err_t result = log_level_configure_locked(config);
+    log_level_advance_generation_locked();
+    pthread_mutex_unlock(&log_level_mutex);
+    return result;
+}
+
+/* Looks up the level of a site which was not resolved in the current level generation yet, and caches the outcome in
+the site. Returns whether the site is enabled. */
+bool _myc_private_log_site_resolve(MycLogSite_t *site)
+{
+    pthread_once(&log_level_env_once, log_level_read_env);
+    pthread_mutex_lock(&log_level_mutex);
+    myc_log_level_t level = log_default_level;
+    for (size_t rule_idx = log_level_rule_count; rule_idx-- > 0; ) {
+        const char *pattern = log_level_rules[rule_idx].pattern;
+        if ((site->module_name != NULL && fnmatch(pattern, site->module_name, 0) == 0) || fnmatch(pattern, site->file_path, 0) == 0) {
+            level = log_level_rules[rule_idx].level;
+            break;
+        }
+    }
+    const bool is_enabled = log_label_levels[site->label] <= level;
+    const uint32_t generation = __atomic_load_n(&_myc_private_log_level_generation, __ATOMIC_RELAXED);
+    __atomic_store_n(&site->level_cache, generation | (uint32_t)is_enabled, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&log_level_mutex);
+    return is_enabled;
+}
+
+/* Applies the environment variable MYC_LOG_LEVEL_ENV, runs once before the first level lookup or change.
+!!NOTE: Must not log, the first call site to log is waiting for it. */
+static void log_level_read_env(void)
+{
+    const char *config = getenv(MYC_LOG_LEVEL_ENV);
+    if (config == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&log_level_mutex);
+    const myc_err_t result = log_level_configure_locked(config);
+    log_level_advance_generation_locked();
+    pthread_mutex_unlock(&log_level_mutex);
+    if (result != MYC_SUCCESS) {
+        fprintf(stderr, MYC_LOG_HEADER_FMT MYC_LOG_MESSAGE_PREFIX "Could not apply all of %s=\"%s\".\n",
+                "["MYC_FMT_YELLOW("WARNING")"]", __FUNC_NAME__, __FILE__, __LINE__, MYC_LOG_LEVEL_ENV, config);
+    }
+}
+
+/* Parses a level given by number or name. Returns false if 'text' is neither. */
+static bool log_level_parse(const char *text, myc_log_level_t *level)
+{
+    for (myc_log_level_t candidate = MYC_LOG_LEVEL_NONE; candidate <= MYC_LOG_LEVEL_DEBUG; ++candidate) {
+        if (strcasecmp(text, log_level_names[candidate]) == 0 || (text[0] == '0' + (int)candidate && text[1] == '\0')) {
+            *level = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+static myc_err_t log_level_configure_locked(const char *config)
+{
+    char *entries = strdup(config);
+    if (entries == NULL) {
+        return MYC_ERR_NO_MEMORY;
+    }
+    myc_err_t result = MYC_SUCCESS;
+    char *save_ptr = NULL;
+    for (char *entry = strtok_r(entries, ", ", &save_ptr); entry != NULL; entry = strtok_r(NULL, ", ", &save_ptr)) {
+        char *separator = strrchr(entry, '=');
+        const char *level_text = (separator != NULL) ? separator + 1 : entry;
+        myc_log_level_t level;
+        if (!log_level_parse(level_text, &level) || separator == entry) {
+            result = MYC_ERR_INVALID_ARGUMENT;
+            break;
+        }
+        if (separator == NULL) {
+            log_default_level = level;
+            continue;
+        }
+        *separator = '\0';
+        result = log_level_set_rule_locked(entry, level);
+        if (result != MYC_SUCCESS) {
+            break;
+        }
+    }
+    free(entries);
+    return result;
+}
+
+/* Appends the rule, after removing an earlier rule of the same pattern. */
+static myc_err_t log_level_set_rule_locked(const char *pattern, myc_log_level_t level)
+{
+    if (pattern == NULL || pattern[0] == '\0' || (unsigned)level > MYC_LOG_LEVEL_DEBUG) {
+        return MYC_ERR_INVALID_ARGUMENT;
+    }
+    for (size_t rule_idx = 0; rule_idx < log_level_rule_count; ++rule_idx) {
+        if (strcmp(log_level_rules[rule_idx].pattern, pattern) == 0) {
+            free(log_level_rules[rule_idx].pattern);
+            memmove(&log_level_rules[rule_idx], &log_level_rules[rule_idx + 1], (log_level_rule_count - rule_idx - 1) * sizeof(MycLogLevelRule_t));
+            log_level_rule_count -= 1;
+            break;
+        }
+    }
+
+    MycLogLevelRule_t *rules = realloc(log_level_rules, (log_level_rule_count + 1) * sizeof(MycLogLevelRule_t));
+    if (rules == NULL) {
+        return MYC_ERR_NO_MEMORY;
+    }
+    log_level_rules = rules;
+    char *pattern_copy = strdup(pattern);
+    if (pattern_copy == NULL) {
+        return MYC_ERR_NO_MEMORY;
+    }
+    log_level_rules[log_level_rule_count++] = (MycLogLevelRule_t){ .pattern = pattern_copy, .level = level };
+    return MYC_SUCCESS;
+}
+
+/* Makes every call site look up its level again the next time it is reached. Generation zero is skipped, it would
+match the cache of sites which never logged. */
+static void log_level_advance_generation_locked(void)
+{
+    uint32_t generation = __atomic_load_n(&_myc_private_log_level_generation, __ATOMIC_RELAXED) + 2;
+    if (generation == 0) {
+        generation = 2;
+    }
+    __atomic_store_n(&_myc_private_log_level_generation, generation, __ATOMIC_RELAXED);
+}
+
+/* Lets up to 'per_sec' calls of a site pass per second of the coarse monotonic clock, which is read without a system
+call. Calls which pass report how many calls were suppressed since the site last logged. */
+bool _myc_private_log_limit_rate(MycLogLimit_t *limit, uint32_t per_sec, uint64_t *suppressed_count)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    const uint64_t window = (uint64_t)(uint32_t)now.tv_sec << 32;
+
+    uint64_t state = __atomic_load_n(&limit->state, __ATOMIC_RELAXED);
+    uint64_t new_state;
+    do {
+        if ((state & ~(uint64_t)UINT32_MAX) != window) {
+            new_state = window | (per_sec != 0);
+        } else if ((uint32_t)state < per_sec) {
+            new_state = state + 1;
+        } else {
+            new_state = state;
+        }
+        if (new_state == state || (uint32_t)new_state == 0) {
+            __atomic_fetch_add(&limit->suppressed_count, 1, __ATOMIC_RELAXED);
+            return false;
+        }
+    } while (!__atomic_compare_exchange_n(&limit->state, &state, new_state, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    *suppressed_count = __atomic_exchange_n(&limit->suppressed_count, 0, __ATOMIC_RELAXED);
+    return true;
+}
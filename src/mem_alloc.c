@@ -1,3 +1,4 @@
+#include <stdlib.h>
 #include <string.h>
 
 #include "myc/core.h"
@@ -7,168 +8,717 @@
 
 // === ALLOC / REALLOC / FREE ====================================================================================== //
 
-static myc_err_t mem_chunk_alloc(MycMemChunk_t **new_chunk, MycMemArena_t *arena, uint32_t size);
+static void* mem_arena_malloc(MycMemArena_t *arena, myc_mem_size_t size);
+static void* mem_arena_realloc(void *addr, myc_mem_size_t new_size);
+static void mem_arena_free(void *addr);
+static void* mem_arena_aligned_malloc(MycMemArena_t *arena, myc_mem_size_t size, size_t alignment);
+static void* mem_arena_aligned_realloc(void *addr, myc_mem_size_t new_size, size_t alignment);
+static myc_err_t mem_arena_resize_in_place(void *addr, myc_mem_size_t new_size);
+static void mem_region_free_batch(MycMemArena_t *region, void **addrs, size_t count);
+static MycMemChunk_t* mem_arena_alloc_chunk(MycMemArena_t *arena, size_t size);
+static void mem_arena_free_chunk(MycMemChunk_t *chunk);
+static void* mem_arena_realloc_shared(void *addr, size_t new_size);
+static void* mem_small_realloc(void *addr, myc_mem_size_t new_size);
+static myc_err_t mem_chunk_alloc(MycMemChunk_t **new_chunk, MycMemArena_t *arena, size_t size, size_t alignment);
+static myc_err_t mem_chunk_alloc_shared(MycMemChunk_t **new_chunk, MycMemArena_t *arena, size_t size, size_t alignment);
 static MycMemChunkSearchInfo_t mem_chunk_find(const MycMemChunk_t *chunk);
-static myc_err_t mem_chunk_resize(MycMemChunk_t *chunk, uint32_t new_size, MycMemChunkSearchInfo_t *chunk_info);
+static myc_err_t mem_chunk_resize(MycMemChunk_t *chunk, size_t new_size, MycMemChunkSearchInfo_t *chunk_info);
+static myc_err_t mem_chunk_resize_backward(MycMemChunk_t **chunk, size_t new_size, MycMemChunkSearchInfo_t *chunk_info);
 static void mem_chunk_free(MycMemChunk_t *chunk, MycMemChunkSearchInfo_t *chunk_info);
 static void mem_chunk_revert(const MycMemChunk_t *chunk, MycMemChunkSearchInfo_t *chunk_info);
+static void mem_layout_defer(MycMemLayout_t *layout);
+static void mem_layout_flush(MycMemLayout_t *layout);
 
 /* Allocates a memory chunk of at least 'size' bytes. */
-void* myc_mem_arena_malloc(MycMemArena_t *arena, uint32_t size)
+void* myc_mem_arena_malloc(MycMemArena_t *arena, myc_mem_size_t size)
 {
+    void *addr = mem_arena_malloc(arena, size);
+    if (addr == MYC_MEM_ALLOC_FAILED) {
+        return MYC_MEM_ALLOC_FAILED;
+    }
+    mem_arena_count(arena, MYC_MEM_COUNTER_MALLOC);
+    if (mem_arena_is_traced(arena)) {
+        mem_trace_lock(arena);
+        mem_trace_record(arena, MYC_MEM_TRACE_OP_MALLOC, NULL, addr, size);
+        mem_trace_unlock(arena);
+    }
+    return addr;
+}
+
+/* Resizes the memory chunk at 'addr' to be at least 'new_size' bytes, moves it if necessary and returns the new address. 
+!!NOTE: Absolute pointers into the memory will be invalid if the chunk moves. */
+void* myc_mem_arena_realloc(void *addr, myc_mem_size_t new_size)
+{
+    MycMemArena_t *arena = mem_arena_from_addr(addr);
+    if (!mem_arena_is_traced(arena)) {
+        return mem_arena_realloc(addr, new_size);
+    }
+    mem_trace_lock(arena);
+    void *new_addr = mem_arena_realloc(addr, new_size);
+    if (new_addr != MYC_MEM_ALLOC_FAILED) {
+        mem_trace_record(arena, MYC_MEM_TRACE_OP_REALLOC, addr, new_addr, new_size);
+    }
+    mem_trace_unlock(arena);
+    return new_addr;
+}
+
+/* Allocates a memory chunk of at least 'size' bytes, whose address is a multiple of 'alignment'. */
+void* myc_mem_arena_aligned_malloc(MycMemArena_t *arena, myc_mem_size_t size, size_t alignment)
+{
+    void *addr = mem_arena_aligned_malloc(arena, size, alignment);
+    if (addr == MYC_MEM_ALLOC_FAILED) {
+        return MYC_MEM_ALLOC_FAILED;
+    }
+    mem_arena_count(arena, MYC_MEM_COUNTER_MALLOC);
+    if (mem_arena_is_traced(arena)) {
+        mem_trace_lock(arena);
+        mem_trace_record(arena, MYC_MEM_TRACE_OP_MALLOC, NULL, addr, size);
+        mem_trace_unlock(arena);
+    }
+    return addr;
+}
+
+/* Resizes the memory chunk at 'addr' like 'myc_mem_arena_realloc', keeping the address a multiple of 'alignment'. */
+void* myc_mem_arena_aligned_realloc(void *addr, myc_mem_size_t new_size, size_t alignment)
+{
+    MycMemArena_t *arena = mem_arena_from_addr(addr);
+    if (!mem_arena_is_traced(arena)) {
+        return mem_arena_aligned_realloc(addr, new_size, alignment);
+    }
+    mem_trace_lock(arena);
+    void *new_addr = mem_arena_aligned_realloc(addr, new_size, alignment);
+    if (new_addr != MYC_MEM_ALLOC_FAILED) {
+        mem_trace_record(arena, MYC_MEM_TRACE_OP_REALLOC, addr, new_addr, new_size);
+    }
+    mem_trace_unlock(arena);
+    return new_addr;
+}
+
+/* Resizes the memory chunk at 'addr' to be at least 'new_size' bytes, but only if that is possible without moving it. */
+myc_err_t myc_mem_arena_try_expand(void *addr, myc_mem_size_t new_size)
+{
+    if (new_size == 0) return MYC_ERR_INVALID_ARGUMENT;
+    MycMemArena_t *arena = mem_arena_from_addr(addr);
+    const myc_err_t exit_code = mem_arena_resize_in_place(addr, new_size);
+    if (exit_code != MYC_SUCCESS) {
+        return exit_code;
+    }
+
+    mem_arena_count(arena, MYC_MEM_COUNTER_REALLOC_IN_PLACE);
+    if (mem_arena_is_traced(arena)) {
+        mem_trace_lock(arena);
+        mem_trace_record(arena, MYC_MEM_TRACE_OP_REALLOC, addr, addr, new_size);
+        mem_trace_unlock(arena);
+    }
+    return MYC_SUCCESS;
+}
+
+/* Frees the memory chunk at 'addr', allowing it to be reused. */
+void myc_mem_arena_free(void *addr)
+{
+    MycMemArena_t *arena = mem_arena_from_addr(addr);
+    mem_arena_count(arena, MYC_MEM_COUNTER_FREE);
+    if (mem_arena_is_traced(arena)) {
+        /* Recorded before the memory is released, so no other thread can record reusing it first. */
+        mem_trace_lock(arena);
+        mem_trace_record(arena, MYC_MEM_TRACE_OP_FREE, addr, NULL, 0);
+        mem_trace_unlock(arena);
+    }
+    mem_arena_free(addr);
+}
+
+/* Allocates 'count' memory chunks of at least 'sizes[i]' bytes each and stores their addresses in 'addrs'. */
+myc_err_t myc_mem_arena_malloc_batch(MycMemArena_t *arena, const myc_mem_size_t *sizes, size_t count, void **addrs)
+{
+    size_t batch_size = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (sizes[i] == 0) return MYC_ERR_INVALID_ARGUMENT;
+        if (sizes[i] > MYC_MEM_SMALL_SIZE_MAX) {
+            batch_size += MYC_QUANTIZE_UP((size_t)sizes[i] + sizeof(MycMemChunk_t), MYC_MEM_ARENA_PAGE_SIZE);
+        }
+    }
+
+    /* The chunks are allocated as one, which is then carved up by writing their headers. Chunks need not be tracked 
+    by the layout individually, so this leaves a valid bucket behind. Only if there is no room for all of them 
+    together, they are allocated one by one. */
+    MycMemChunk_t *batch_chunk = NULL;
+    if (batch_size > 0) {
+        const myc_err_t exit_code = mem_arena_is_thread_safe(arena) 
+            ? mem_chunk_alloc_shared(&batch_chunk, arena, batch_size, MYC_MEM_ARENA_PAGE_SIZE) 
+            : mem_chunk_alloc(&batch_chunk, arena, batch_size, MYC_MEM_ARENA_PAGE_SIZE);
+        if (exit_code != MYC_SUCCESS) {
+            batch_chunk = NULL;
+        }
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (sizes[i] > MYC_MEM_SMALL_SIZE_MAX && batch_chunk != NULL) continue;
+        addrs[i] = mem_arena_malloc(arena, sizes[i]);
+        if (addrs[i] != MYC_MEM_ALLOC_FAILED) continue;
+
+        for (size_t j = 0; j < i; ++j) {
+            if (sizes[j] > MYC_MEM_SMALL_SIZE_MAX && batch_chunk != NULL) continue;
+            mem_arena_free(addrs[j]);
+        }
+        if (batch_chunk != NULL) {
+            mem_chunk_release(batch_chunk);
+        }
+        return MYC_ERR_NO_MEMORY;
+    }
+    if (batch_chunk != NULL) {
+        MycMemArena_t *region = mem_chunk_get_arena(batch_chunk);
+        size_t chunk_offset = mem_chunk_offset(batch_chunk);
+        for (size_t i = 0; i < count; ++i) {
+            if (sizes[i] <= MYC_MEM_SMALL_SIZE_MAX) continue;
+            MycMemChunk_t *chunk = mem_chunk_at(region, chunk_offset);
+            mem_chunk_set_size(chunk, MYC_QUANTIZE_UP((size_t)sizes[i] + sizeof(MycMemChunk_t), MYC_MEM_ARENA_PAGE_SIZE));
+            chunk->page_idx = (uint32_t)mem_layout_page_idx(chunk_offset);
+            addrs[i] = mem_addr_from_chunk(chunk);
+            chunk_offset += mem_chunk_size(chunk);
+        }
+    }
+
+    const bool is_traced = mem_arena_is_traced(arena);
+    if (is_traced) mem_trace_lock(arena);
+    for (size_t i = 0; i < count; ++i) {
+        mem_arena_count(arena, MYC_MEM_COUNTER_MALLOC);
+        if (is_traced) mem_trace_record(arena, MYC_MEM_TRACE_OP_MALLOC, NULL, addrs[i], sizes[i]);
+    }
+    if (is_traced) mem_trace_unlock(arena);
+    return MYC_SUCCESS;
+}
+
+static int mem_addr_compare(const void *lhs, const void *rhs)
+{
+    const uintptr_t lhs_addr = (uintptr_t)*(void* const*)lhs;
+    const uintptr_t rhs_addr = (uintptr_t)*(void* const*)rhs;
+    return (lhs_addr > rhs_addr) - (lhs_addr < rhs_addr);
+}
+
+/* Frees the 'count' memory chunks at 'addrs', which may belong to different arenas. */
+void myc_mem_arena_free_batch(void **addrs, size_t count)
+{
+    /* Small objects are freed right away, while the chunks are kept at the front for the regions. */
+    size_t chunk_count = 0;
+    for (size_t i = 0; i < count; ++i) {
+        MycMemArena_t *arena = mem_arena_from_addr(addrs[i]);
+        mem_arena_count(arena, MYC_MEM_COUNTER_FREE);
+        if (mem_arena_is_traced(arena)) {
+            mem_trace_lock(arena);
+            mem_trace_record(arena, MYC_MEM_TRACE_OP_FREE, addrs[i], NULL, 0);
+            mem_trace_unlock(arena);
+        }
+        if (mem_small_is_object(addrs[i]) && mem_aligned_is_object(addrs[i])) {
+            addrs[chunk_count] = mem_addr_from_chunk(mem_aligned_chunk_from_addr(addrs[i]));
+            chunk_count += 1;
+        } else if (mem_small_is_object(addrs[i])) {
+            mem_small_free(addrs[i]);
+        } else {
+            addrs[chunk_count] = addrs[i];
+            chunk_count += 1;
+        }
+    }
+
+    /* Regions never overlap, so sorting by address lines up the chunks of each region in order. */
+    qsort(addrs, chunk_count, sizeof(void*), mem_addr_compare);
+    size_t first_idx = 0;
+    while (first_idx < chunk_count) {
+        MycMemArena_t *region = mem_chunk_get_arena(mem_chunk_from_addr(addrs[first_idx]));
+        size_t end_idx = first_idx + 1;
+        while (end_idx < chunk_count && mem_chunk_get_arena(mem_chunk_from_addr(addrs[end_idx])) == region) {
+            end_idx += 1;
+        }
+        mem_region_free_batch(region, addrs + first_idx, end_idx - first_idx);
+        first_idx = end_idx;
+    }
+}
+
+/* Allocates a memory chunk of at least 'size' bytes, whose chunk header (not the returned address) is aligned 
+to a multiple of 'alignment'. The memory is freed with 'myc_mem_arena_free' as usual. */
+void* mem_arena_malloc_aligned_chunk(MycMemArena_t *arena, size_t size, size_t alignment)
+{
+    MYC_ASSERT(MYC_IS_POWER_OFF_TWO(alignment), "Given alignment must be a power of two.");
     if (size == 0) return MYC_MEM_ALLOC_FAILED;
     size = MYC_QUANTIZE_UP(size + sizeof(MycMemChunk_t), MYC_MEM_ARENA_PAGE_SIZE);
+    alignment = MYC_MAX(alignment, MYC_MEM_ARENA_PAGE_SIZE);
 
     MycMemChunk_t *chunk;
-    if (mem_chunk_alloc(&chunk, arena, size) != MYC_SUCCESS) {
+    myc_err_t exit_code = mem_arena_is_thread_safe(arena) 
+        ? mem_chunk_alloc_shared(&chunk, arena, size, alignment) 
+        : mem_chunk_alloc(&chunk, arena, size, alignment);
+    if (exit_code != MYC_SUCCESS) {
         return MYC_MEM_ALLOC_FAILED;
     }
     void *addr = mem_addr_from_chunk(chunk);
     return addr;
 }
 
-/* Resizes the memory chunk at 'addr' to be at least 'new_size' bytes, moves it if necessary and returns the new address. 
-!!NOTE: Absolute pointers into the memory will be invalid if the chunk moves. */
-void* myc_mem_arena_realloc(void *addr, uint32_t new_size)
+/* Frees a chunk back into the layout of its region, taking the region lock if needed. */
+void mem_chunk_release(MycMemChunk_t *chunk)
+{
+    MycMemArena_t *arena = mem_chunk_get_arena(chunk);
+    mem_arena_lock(arena);
+    MycMemChunkSearchInfo_t chunk_info = mem_chunk_find(chunk);
+    mem_chunk_free(chunk, &chunk_info);
+    mem_arena_note_free(arena);
+    mem_arena_unlock(arena);
+}
+
+static void* mem_arena_malloc(MycMemArena_t *arena, myc_mem_size_t size)
+{
+    if (size == 0) return MYC_MEM_ALLOC_FAILED;
+    if (size <= MYC_MEM_SMALL_SIZE_MAX) {
+        return mem_small_malloc(arena, (uint32_t)size);
+    }
+    const size_t chunk_size = MYC_QUANTIZE_UP((size_t)size + sizeof(MycMemChunk_t), MYC_MEM_ARENA_PAGE_SIZE);
+
+    MycMemChunk_t *chunk = mem_arena_alloc_chunk(arena, chunk_size);
+    if (chunk == NULL) {
+        return MYC_MEM_ALLOC_FAILED;
+    }
+    void *addr = mem_addr_from_chunk(chunk);
+    return addr;
+}
+
+static void mem_arena_free(void *addr)
+{
+    if (!mem_small_is_object(addr)) {
+        mem_arena_free_chunk(mem_chunk_from_addr(addr));
+    } else if (mem_aligned_is_object(addr)) {
+        mem_arena_free_chunk(mem_aligned_chunk_from_addr(addr));
+    } else {
+        mem_small_free(addr);
+    }
+}
+
+static void* mem_arena_aligned_malloc(MycMemArena_t *arena, myc_mem_size_t size, size_t alignment)
+{
+    MYC_ASSERT(MYC_IS_POWER_OFF_TWO(alignment), "Given alignment must be a power of two.");
+    MYC_ASSERT(alignment <= MYC_MEM_ARENA_PAGE_SIZE, "Given alignment exceeds the arena page size.");
+    if (size == 0) return MYC_MEM_ALLOC_FAILED;
+    if (alignment <= sizeof(MycMemChunk_t)) {
+        return mem_arena_malloc(arena, size);
+    }
+    /* Small objects are aligned to the largest power of two dividing their class size, so a class whose size is a 
+    multiple of the alignment serves the request without any padding. */
+    if (size <= MYC_MEM_SMALL_SIZE_MAX) {
+        return mem_small_aligned_malloc(arena, (uint32_t)size, alignment);
+    }
+
+    /* Aligning the chunk to a whole run keeps the object within the run its address masks to, which is what tells it 
+    apart from small objects when freed. The padding in front of the chunk stays free for other allocations, and the 
+    object only sits past the run header rounded up to the alignment. */
+    const uint32_t object_offset = calc_mem_aligned_object_offset(alignment);
+    const size_t chunk_size = (size_t)size + object_offset - sizeof(MycMemChunk_t);
+    MycMemSmallRun_t *run = mem_arena_malloc_aligned_chunk(arena, chunk_size, MYC_MEM_SMALL_RUN_SIZE);
+    if (run == MYC_MEM_ALLOC_FAILED) {
+        return MYC_MEM_ALLOC_FAILED;
+    }
+    run->small_class = NULL;
+    run->carve_offset = object_offset;
+    return (void*)mem_chunk_from_addr(run) + object_offset;
+}
+
+static void* mem_arena_aligned_realloc(void *addr, myc_mem_size_t new_size, size_t alignment)
+{
+    if (new_size == 0) return MYC_MEM_ALLOC_FAILED;
+    if (alignment <= sizeof(MycMemChunk_t) && !(mem_small_is_object(addr) && mem_aligned_is_object(addr))) {
+        return mem_arena_realloc(addr, new_size);
+    }
+    MycMemArena_t *arena = mem_arena_from_addr(addr)->head;
+    if ((uintptr_t)addr % alignment == 0 && mem_arena_resize_in_place(addr, new_size) == MYC_SUCCESS) {
+        mem_arena_count(arena, MYC_MEM_COUNTER_REALLOC_IN_PLACE);
+        return addr;
+    }
+
+    void *new_addr = mem_arena_aligned_malloc(arena, new_size, alignment);
+    if (new_addr == MYC_MEM_ALLOC_FAILED) {
+        return MYC_MEM_ALLOC_FAILED;
+    }
+    memcpy(new_addr, addr, MYC_MIN((size_t)myc_mem_arena_get_chunk_size(addr), (size_t)new_size));
+    mem_arena_free(addr);
+    mem_arena_count(arena, MYC_MEM_COUNTER_REALLOC_MOVE);
+    return new_addr;
+}
+
+/* Resizes the chunk, aligned chunk or small object at 'addr', but only where it is. */
+static myc_err_t mem_arena_resize_in_place(void *addr, myc_mem_size_t new_size)
+{
+    size_t header_size = sizeof(MycMemChunk_t);
+    MycMemChunk_t *chunk = mem_chunk_from_addr(addr);
+    if (mem_small_is_object(addr) && !mem_aligned_is_object(addr)) {
+        return (new_size <= mem_small_get_object_size(addr)) ? MYC_SUCCESS : MYC_FAILED;
+    }
+    if (mem_small_is_object(addr)) {
+        header_size = mem_aligned_get_object_offset(addr);
+        chunk = mem_aligned_chunk_from_addr(addr);
+    }
+
+    const size_t new_chunk_size = MYC_QUANTIZE_UP((size_t)new_size + header_size, MYC_MEM_ARENA_PAGE_SIZE);
+    MycMemArena_t *arena = mem_chunk_get_arena(chunk);
+    mem_arena_lock(arena);
+    MycMemChunkSearchInfo_t chunk_info = mem_chunk_find(chunk);
+    const myc_err_t exit_code = mem_chunk_resize(chunk, new_chunk_size, &chunk_info);
+    mem_arena_unlock(arena);
+    return exit_code;
+}
+
+static void* mem_arena_realloc(void *addr, myc_mem_size_t new_size)
 {
     if (new_size == 0) return MYC_MEM_ALLOC_FAILED;
-    new_size = MYC_QUANTIZE_UP(new_size + sizeof(MycMemChunk_t), MYC_MEM_ARENA_PAGE_SIZE);
+    if (mem_small_is_object(addr) && mem_aligned_is_object(addr)) {
+        const uint32_t object_offset = mem_aligned_get_object_offset(addr);
+        return mem_arena_aligned_realloc(addr, new_size, MYC_MIN(object_offset & -object_offset, MYC_MEM_ARENA_PAGE_SIZE));
+    }
+    if (mem_small_is_object(addr)) {
+        return mem_small_realloc(addr, new_size);
+    }
+    const size_t new_chunk_size = MYC_QUANTIZE_UP((size_t)new_size + sizeof(MycMemChunk_t), MYC_MEM_ARENA_PAGE_SIZE);
 
     MycMemChunk_t *chunk = mem_chunk_from_addr(addr);    
+    if (mem_arena_is_thread_safe(mem_chunk_get_arena(chunk))) {
+        return mem_arena_realloc_shared(addr, new_chunk_size);
+    }
+
     MycMemChunkSearchInfo_t chunk_info = mem_chunk_find(chunk);
-    if (mem_chunk_resize(chunk, new_size, &chunk_info) != MYC_SUCCESS) {
-        mem_chunk_free(chunk, &chunk_info); // Free first to allow overlapping allocation.
-        MycMemChunk_t *new_chunk;
-        if (mem_chunk_alloc(&new_chunk, chunk_info.arena->head, new_size) != MYC_SUCCESS) {
-            mem_chunk_revert(chunk, &chunk_info);
-            return MYC_MEM_ALLOC_FAILED;
-        }
-        void *new_addr = mem_addr_from_chunk(new_chunk);
-        const size_t move_size = MYC_MIN(chunk->size, new_chunk->size) - sizeof(MycMemChunk_t);
-        addr = memmove(new_addr, addr, move_size);
+    if (mem_chunk_resize(chunk, new_chunk_size, &chunk_info) == MYC_SUCCESS) {
+        mem_arena_count(chunk_info.arena, MYC_MEM_COUNTER_REALLOC_IN_PLACE);
+        return addr;
+    }
+    if (mem_chunk_resize_backward(&chunk, new_chunk_size, &chunk_info) == MYC_SUCCESS) {
+        mem_arena_count(chunk_info.arena, MYC_MEM_COUNTER_REALLOC_MOVE);
+        return mem_addr_from_chunk(chunk);
+    }
+
+    mem_chunk_free(chunk, &chunk_info); // Free first to allow overlapping allocation.
+    MycMemChunk_t *new_chunk;
+    if (mem_chunk_alloc(&new_chunk, chunk_info.arena->head, new_chunk_size, MYC_MEM_ARENA_PAGE_SIZE) != MYC_SUCCESS) {
+        mem_chunk_revert(chunk, &chunk_info);
+        return MYC_MEM_ALLOC_FAILED;
     }
+    void *new_addr = mem_addr_from_chunk(new_chunk);
+    const size_t move_size = MYC_MIN(mem_chunk_size(chunk), mem_chunk_size(new_chunk)) - sizeof(MycMemChunk_t);
+    addr = memmove(new_addr, addr, move_size);
+    mem_arena_note_free(chunk_info.arena);  // Only now, since a purge would wipe the old contents.
+    mem_arena_count(chunk_info.arena, MYC_MEM_COUNTER_REALLOC_MOVE);
     return addr;
 }
 
-/* Frees the memory chunk at 'addr', allowing it to be reused. */
-void myc_mem_arena_free(void *addr)
+static MycMemChunk_t* mem_arena_alloc_chunk(MycMemArena_t *arena, size_t size)
+{
+    MycMemChunk_t *chunk;
+    if (!mem_arena_is_thread_safe(arena)) {
+        return (mem_chunk_alloc(&chunk, arena, size, MYC_MEM_ARENA_PAGE_SIZE) == MYC_SUCCESS) ? chunk : NULL;
+    }
+
+    const size_t class_idx = mem_thread_cache_class_idx(size);
+    if (class_idx < MYC_MEM_THREAD_CACHE_CLASS_COUNT) {
+        MycMemThreadCache_t *cache = mem_thread_cache_get(arena);
+        if (cache != NULL && cache->magazines[class_idx].chunk_count > 0) {
+            MycMemMagazine_t *magazine = &cache->magazines[class_idx];
+            magazine->chunk_count -= 1;
+            return magazine->chunks[magazine->chunk_count];
+        }
+    }
+    return (mem_chunk_alloc_shared(&chunk, arena, size, MYC_MEM_ARENA_PAGE_SIZE) == MYC_SUCCESS) ? chunk : NULL;
+}
+
+static void mem_arena_free_chunk(MycMemChunk_t *chunk)
+{
+    MycMemArena_t *arena = mem_chunk_get_arena(chunk);
+    if (!mem_arena_is_thread_safe(arena)) {
+        MycMemChunkSearchInfo_t chunk_info = mem_chunk_find(chunk);
+        mem_chunk_free(chunk, &chunk_info);
+        mem_arena_note_free(arena);
+        return;
+    }
+
+    const size_t class_idx = mem_thread_cache_class_idx(mem_chunk_size(chunk));
+    MycMemThreadCache_t *cache = (class_idx < MYC_MEM_THREAD_CACHE_CLASS_COUNT) ? mem_thread_cache_get(arena->head) : NULL;
+    if (cache == NULL) {
+        mem_chunk_release(chunk);
+        return;
+    }
+
+    MycMemMagazine_t *magazine = &cache->magazines[class_idx];
+    if (magazine->chunk_count == MYC_MEM_THREAD_CACHE_MAGAZINE_SIZE) {
+        /* Give the older half back to the layouts, keeping the most recently freed (and most likely cached) chunks. */
+        const uint32_t release_count = MYC_MEM_THREAD_CACHE_MAGAZINE_SIZE / 2;
+        for (uint32_t i = 0; i < release_count; ++i) {
+            mem_chunk_release(magazine->chunks[i]);
+        }
+        memmove(magazine->chunks, magazine->chunks + release_count, (magazine->chunk_count - release_count) * sizeof(MycMemChunk_t*));
+        magazine->chunk_count -= release_count;
+    }
+    magazine->chunks[magazine->chunk_count] = chunk;
+    magazine->chunk_count += 1;
+}
+
+/* Frees the chunks at 'addrs' (sorted by address) in the region at once, bypassing the thread caches. */
+static void mem_region_free_batch(MycMemArena_t *region, void **addrs, size_t count)
+{
+    mem_arena_lock(region);
+    /* Deferring pays off once the nodes above the freed pages are fewer than the node updates of freeing one by one. */
+    MycMemLayout_t *layout = &region->layout;
+    const size_t page_span = mem_chunk_from_addr(addrs[count - 1])->page_idx - mem_chunk_from_addr(addrs[0])->page_idx;
+    const bool is_deferred = (page_span / MYC_MEM_LAYOUT_NODE_CHILD_COUNT) <= count * layout->level_count;
+    if (is_deferred) {
+        mem_layout_defer(layout);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        MycMemChunk_t *chunk = mem_chunk_from_addr(addrs[i]);
+        MycMemChunkSearchInfo_t chunk_info = mem_chunk_find(chunk);
+        mem_chunk_free(chunk, &chunk_info);
+    }
+    if (is_deferred) {
+        mem_layout_flush(layout);
+        mem_region_index_update(region);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        mem_arena_note_free(region);    // Only now, since a purge needs the tree to be up to date.
+    }
+    mem_arena_unlock(region);
+}
+
+static void* mem_arena_realloc_shared(void *addr, size_t new_size)
 {
     MycMemChunk_t *chunk = mem_chunk_from_addr(addr);
+    MycMemArena_t *arena = mem_chunk_get_arena(chunk);
+
+    mem_arena_lock(arena);
     MycMemChunkSearchInfo_t chunk_info = mem_chunk_find(chunk);
-    mem_chunk_free(chunk, &chunk_info);
+    myc_err_t exit_code = mem_chunk_resize(chunk, new_size, &chunk_info);
+    MycMemChunk_t *moved_chunk = chunk;
+    const bool is_moved_back = (exit_code != MYC_SUCCESS) && mem_chunk_resize_backward(&moved_chunk, new_size, &chunk_info) == MYC_SUCCESS;
+    mem_arena_unlock(arena);
+    if (exit_code == MYC_SUCCESS) {
+        mem_arena_count(arena, MYC_MEM_COUNTER_REALLOC_IN_PLACE);
+        return addr;
+    }
+    if (is_moved_back) {
+        mem_arena_count(arena, MYC_MEM_COUNTER_REALLOC_MOVE);
+        return mem_addr_from_chunk(moved_chunk);
+    }
+
+    /* Unlike the single threaded path, the old chunk cannot be freed up front, 
+    because another thread could claim its memory before the contents are moved. */
+    MycMemChunk_t *new_chunk = mem_arena_alloc_chunk(arena->head, new_size);
+    if (new_chunk == NULL) {
+        return MYC_MEM_ALLOC_FAILED;
+    }
+    void *new_addr = mem_addr_from_chunk(new_chunk);
+    const size_t move_size = MYC_MIN(mem_chunk_size(chunk), mem_chunk_size(new_chunk));
+    memcpy(new_addr, addr, move_size - sizeof(MycMemChunk_t));
+    mem_arena_free_chunk(chunk);
+    mem_arena_count(arena, MYC_MEM_COUNTER_REALLOC_MOVE);
+    return new_addr;
 }
 
 
+/* Small objects never grow in place, but are moved into a larger class or a chunk. */
+static void* mem_small_realloc(void *addr, myc_mem_size_t new_size)
+{
+    const uint32_t object_size = mem_small_get_object_size(addr);
+    MycMemArena_t *arena = mem_chunk_get_arena(mem_chunk_from_addr(mem_small_run_from_addr(addr)))->head;
+    if (new_size <= object_size) {
+        mem_arena_count(arena, MYC_MEM_COUNTER_REALLOC_IN_PLACE);
+        return addr;
+    }
+    void *new_addr = mem_arena_malloc(arena, new_size);
+    if (new_addr == MYC_MEM_ALLOC_FAILED) {
+        return MYC_MEM_ALLOC_FAILED;
+    }
+    memcpy(new_addr, addr, object_size);
+    mem_small_free(addr);
+    mem_arena_count(arena, MYC_MEM_COUNTER_REALLOC_MOVE);
+    return new_addr;
+}
 
-// === CHUNK MANAGEMENT ============================================================================================ //
 
-static myc_err_t find_best_suitable_arena(MycMemArena_t** arena, uint32_t chunk_size);
-static size_t mem_layout_find_min_suitable_bucket(const MycMemLayout_t *layout, uint32_t chunk_size);
-#define UPDATE_PARENTS true
-#define DONT_UPDATE_PARENTS false
-static void mem_layout_update_free_sizes(MycMemLayout_t *layout, size_t bucket_idx, int32_t size_diff, bool update_parents);
-static void mem_layout_merge_bucket_with_previous(MycMemLayout_t *layout, size_t bucket_idx);
-static void mem_layout_split_bucket_at(MycMemLayout_t *layout, size_t bucket_idx, uint32_t split_offset);
-static void mem_layout_rebuild(MycMemLayout_t *layout);
-static void mem_layout_update_parent_node_count(MycMemLayout_t *layout);
 
-static myc_err_t mem_chunk_alloc(MycMemChunk_t **new_chunk, MycMemArena_t *arena, uint32_t size)
+// === CHUNK MANAGEMENT ============================================================================================ //
+
+static myc_err_t find_best_suitable_arena(MycMemArena_t** arena, size_t chunk_size);
+static void mem_chunk_alloc_in_region(MycMemChunk_t **new_chunk, MycMemArena_t *arena, size_t size, size_t alignment);
+static inline size_t calc_chunk_search_size(size_t size, size_t alignment);
+static size_t mem_layout_find_min_suitable_bucket(const MycMemLayout_t *layout, size_t chunk_size);
+static size_t mem_layout_find_bucket(const MycMemLayout_t *layout, size_t page_idx);
+static void mem_layout_set_bucket_free_size(MycMemLayout_t *layout, size_t bucket_idx, size_t free_size);
+static void mem_layout_update_free_sizes(MycMemLayout_t *layout, size_t bucket_idx, int64_t size_diff);
+static size_t mem_layout_merge_bucket_with_previous(MycMemLayout_t *layout, size_t bucket_idx);
+static void mem_layout_split_bucket_at(MycMemLayout_t *layout, size_t bucket_idx, size_t split_offset);
+static void mem_layout_move_bucket_start(MycMemLayout_t *layout, size_t bucket_idx, size_t new_start_offset, size_t prev_bucket_idx);
+static void mem_layout_set_leaf(MycMemLayout_t *layout, size_t page_idx, uint32_t leaf);
+static void mem_layout_set_bucket_bit(MycMemLayout_t *layout, size_t page_idx, bool is_set);
+
+static myc_err_t mem_chunk_alloc(MycMemChunk_t **new_chunk, MycMemArena_t *arena, size_t size, size_t alignment)
 {
     myc_err_t exit_code;
-    if ((exit_code = find_best_suitable_arena(&arena, size)) != MYC_SUCCESS) {
+    const size_t search_size = calc_chunk_search_size(size, alignment);
+    if (find_best_suitable_arena(&arena, search_size) != MYC_SUCCESS 
+     && (exit_code = mem_arena_commit_any(&arena, arena, search_size)) != MYC_SUCCESS) {
         return exit_code;
     }
+    mem_chunk_alloc_in_region(new_chunk, arena, size, alignment);
+    return MYC_SUCCESS;
+}
 
-    size_t bucket_idx = mem_layout_find_min_suitable_bucket(&arena->layout, size);
-    uint32_t chunk_offset = mem_layout_bucket_free_offset(&arena->layout, bucket_idx);
-    mem_layout_update_free_sizes(&arena->layout, bucket_idx, (int32_t)(-size), UPDATE_PARENTS);
+static myc_err_t mem_chunk_alloc_shared(MycMemChunk_t **new_chunk, MycMemArena_t *arena, size_t size, size_t alignment)
+{
+    const size_t search_size = calc_chunk_search_size(size, alignment);
+    /* The region search reads the root free sizes without holding any lock, 
+    so the chosen region has to be checked again once it is locked. */
+    for (;;) {
+        MycMemArena_t *arena_i = arena;
+        if (find_best_suitable_arena(&arena_i, search_size) != MYC_SUCCESS 
+         && mem_arena_commit_any(&arena_i, arena, search_size) != MYC_SUCCESS) {
+            return MYC_FAILED;
+        }
+        mem_arena_lock(arena_i);
+        const bool is_suitable = arena_i->layout.max_free_sizes[0] >= mem_layout_encode_free_size(search_size);
+        if (is_suitable) {
+            mem_chunk_alloc_in_region(new_chunk, arena_i, size, alignment);
+        }
+        mem_arena_unlock(arena_i);
+        if (is_suitable) {
+            return MYC_SUCCESS;
+        }
+    }
+}
+
+static void mem_chunk_alloc_in_region(MycMemChunk_t **new_chunk, MycMemArena_t *arena, size_t size, size_t alignment)
+{
+    size_t bucket_idx = mem_layout_find_min_suitable_bucket(&arena->layout, calc_chunk_search_size(size, alignment));
+    size_t chunk_offset = mem_layout_bucket_free_offset(&arena->layout, bucket_idx);
+    if (alignment <= MYC_MEM_ARENA_PAGE_SIZE) {
+        mem_layout_update_free_sizes(&arena->layout, bucket_idx, -(int64_t)size);
+    } else {
+        const size_t free_addr = (size_t)mem_chunk_at(arena, chunk_offset);
+        chunk_offset += MYC_QUANTIZE_UP(free_addr, alignment) - free_addr;
+    }
 
     MycMemChunk_t *chunk = mem_chunk_at(arena, chunk_offset);
-    chunk->size = size;
-    chunk->offset = chunk_offset;
+    mem_chunk_set_size(chunk, size);
+    chunk->page_idx = (uint32_t)mem_layout_page_idx(chunk_offset);
+    if (alignment > MYC_MEM_ARENA_PAGE_SIZE) {
+        /* Claiming a chunk somewhere inside the free tail of a bucket is exactly what a revert does. */
+        MycMemChunkSearchInfo_t chunk_info = { .arena = arena, .bucket_idx = bucket_idx };
+        mem_chunk_revert(chunk, &chunk_info);
+    }
+    mem_region_index_update(arena);
     *new_chunk = chunk;
-    return MYC_SUCCESS;
+}
+
+/* Returns the free size needed to fit a chunk of 'size' bytes at the given alignment, wherever the free tail starts. */
+static inline size_t calc_chunk_search_size(size_t size, size_t alignment)
+{
+    return (alignment <= MYC_MEM_ARENA_PAGE_SIZE) ? size : size + alignment - MYC_MEM_ARENA_PAGE_SIZE;
 }
 
 static MycMemChunkSearchInfo_t mem_chunk_find(const MycMemChunk_t *chunk)
 {
     MycMemArena_t *arena = mem_chunk_get_arena(chunk);
-    size_t start_idx = 0;
-    size_t mid_idx;
-    size_t end_idx = arena->layout.bucket_node_count;
-    while (start_idx < end_idx - 1) {
-        mid_idx = (start_idx + end_idx) / 2;
-        if (chunk->offset < arena->layout.bucket_offsets[mid_idx]) {
-            end_idx = mid_idx;
-        } else {
-            start_idx = mid_idx;
-        }
-    }
-
-    const size_t bucket_idx = start_idx;
+    const size_t bucket_idx = mem_layout_find_bucket(&arena->layout, chunk->page_idx);
     MycMemChunkSearchInfo_t chunk_info = {
         .arena = arena,
         .bucket_idx = bucket_idx,
-        .is_first_in_bucket = (chunk->offset == arena->layout.bucket_offsets[bucket_idx]),
-        .is_last_in_bucket = (chunk->offset + chunk->size == mem_layout_bucket_free_offset(&arena->layout, bucket_idx)),
+        .is_first_in_bucket = (chunk->page_idx == bucket_idx),
+        .is_last_in_bucket = (mem_chunk_offset(chunk) + mem_chunk_size(chunk) == mem_layout_bucket_free_offset(&arena->layout, bucket_idx)),
     };
     return chunk_info;
 }
 
-static myc_err_t mem_chunk_resize(MycMemChunk_t *chunk, uint32_t new_size, MycMemChunkSearchInfo_t *chunk_info)
+static myc_err_t mem_chunk_resize(MycMemChunk_t *chunk, size_t new_size, MycMemChunkSearchInfo_t *chunk_info)
 {
     MYC_ASSERT(!(chunk_info->bucket_idx == 0 && chunk_info->is_first_in_bucket), "First chunk is internal and never resized.");
-    if (new_size == chunk->size) {
+    if (new_size == mem_chunk_size(chunk)) {
         return MYC_SUCCESS;
     }
 
     MycMemLayout_t *layout = &chunk_info->arena->layout;
-    int32_t size_diff = (int32_t)(new_size - chunk->size);
+    const int64_t size_diff = (int64_t)new_size - (int64_t)mem_chunk_size(chunk);
     if (chunk_info->is_last_in_bucket) {
-        if (size_diff > (int32_t)mem_layout_bucket_free_size(layout, chunk_info->bucket_idx)) {
+        const size_t free_size = mem_layout_bucket_free_size(layout, chunk_info->bucket_idx);
+        /* The last bucket of a region can grow in place into its reserved address space, so the chunk need not move. */
+        const bool is_last_bucket = layout->bucket_end_pages[chunk_info->bucket_idx] == layout->page_count;
+        if (size_diff > (int64_t)free_size 
+         && (!is_last_bucket || mem_arena_commit(chunk_info->arena, (size_t)size_diff - free_size) != MYC_SUCCESS)) {
             return MYC_FAILED;
         }
-        mem_layout_update_free_sizes(layout, chunk_info->bucket_idx, -size_diff, UPDATE_PARENTS);
+        mem_layout_update_free_sizes(layout, chunk_info->bucket_idx, -size_diff);
     } else {
         if (size_diff > 0) {
             return MYC_FAILED;
         }
-        const uint32_t split_offset = chunk->offset + chunk->size;
+        const size_t split_offset = mem_chunk_offset(chunk) + mem_chunk_size(chunk);
         mem_layout_split_bucket_at(layout, chunk_info->bucket_idx, split_offset);
-        mem_layout_update_free_sizes(layout, chunk_info->bucket_idx, -size_diff, DONT_UPDATE_PARENTS);
-        mem_layout_rebuild(layout);
+        mem_layout_update_free_sizes(layout, chunk_info->bucket_idx, -size_diff);
     }
 
-    chunk->size += size_diff;
-    MYC_ASSERT(chunk->size == new_size, "Chunk size and new size must match after successful resize.");
+    mem_chunk_set_size(chunk, new_size);
+    mem_region_index_update(chunk_info->arena);
+    if (size_diff < 0) {
+        mem_arena_note_free(chunk_info->arena);
+    }
+    return MYC_SUCCESS;
+}
+
+/* Grows the chunk, which cannot grow in place, back into the free tail of the previous bucket right before it, after 
+taking all of its own free tail if it is the last chunk of its bucket. The contents move back along with the chunk start, 
+which is still much cheaper than moving them into a new chunk, and keeps the free memory in one piece. */
+static myc_err_t mem_chunk_resize_backward(MycMemChunk_t **chunk, size_t new_size, MycMemChunkSearchInfo_t *chunk_info)
+{
+    if (!chunk_info->is_first_in_bucket || chunk_info->bucket_idx == 0) {
+        return MYC_FAILED;
+    }
+    MycMemChunk_t *old_chunk = *chunk;
+    MycMemLayout_t *layout = &chunk_info->arena->layout;
+    const size_t old_size = mem_chunk_size(old_chunk);
+    const size_t tail_size = chunk_info->is_last_in_bucket ? mem_layout_bucket_free_size(layout, chunk_info->bucket_idx) : 0;
+    const size_t prev_bucket_idx = mem_layout_find_bucket(layout, chunk_info->bucket_idx - 1);
+    if (new_size <= old_size + tail_size || new_size > old_size + tail_size + mem_layout_bucket_free_size(layout, prev_bucket_idx)) {
+        return MYC_FAILED;
+    }
+
+    const size_t back_size = new_size - old_size - tail_size;
+    const size_t new_offset = mem_chunk_offset(old_chunk) - back_size;
+    mem_layout_move_bucket_start(layout, chunk_info->bucket_idx, new_offset, prev_bucket_idx);
+    chunk_info->bucket_idx = mem_layout_page_idx(new_offset);
+    mem_layout_update_free_sizes(layout, prev_bucket_idx, -(int64_t)back_size);
+    mem_layout_update_free_sizes(layout, chunk_info->bucket_idx, -(int64_t)tail_size);
+
+    MycMemChunk_t *new_chunk = mem_chunk_at(chunk_info->arena, new_offset);
+    memmove(mem_addr_from_chunk(new_chunk), mem_addr_from_chunk(old_chunk), old_size - sizeof(MycMemChunk_t));
+    mem_chunk_set_size(new_chunk, new_size);
+    new_chunk->page_idx = (uint32_t)mem_layout_page_idx(new_offset);
+    mem_region_index_update(chunk_info->arena);
+    *chunk = new_chunk;
     return MYC_SUCCESS;
 }
 
 static void mem_chunk_free(MycMemChunk_t *chunk, MycMemChunkSearchInfo_t *chunk_info)
 {
     MYC_ASSERT(!(chunk_info->bucket_idx == 0 && chunk_info->is_first_in_bucket), "First chunk is internal and never freed.");
-    bool is_chunk_valid = chunk->offset < mem_layout_bucket_free_offset(&chunk_info->arena->layout, chunk_info->bucket_idx);
+    bool is_chunk_valid = mem_chunk_offset(chunk) < mem_layout_bucket_free_offset(&chunk_info->arena->layout, chunk_info->bucket_idx);
     MYC_ASSERT(is_chunk_valid, "Attempt to free invalid memory chunk.");
 
     MycMemLayout_t *layout = &chunk_info->arena->layout;
+    const size_t chunk_end = mem_chunk_offset(chunk) + mem_chunk_size(chunk);
     if (chunk_info->is_first_in_bucket && chunk_info->is_last_in_bucket) {
-        const uint32_t bucket_size = mem_layout_bucket_size(layout, chunk_info->bucket_idx);
-        mem_layout_merge_bucket_with_previous(layout, chunk_info->bucket_idx);
-        chunk_info->bucket_idx -= 1;
-        mem_layout_update_free_sizes(layout, chunk_info->bucket_idx, (int32_t)bucket_size, DONT_UPDATE_PARENTS);
-        mem_layout_rebuild(layout);
+        const size_t bucket_size = mem_layout_bucket_size(layout, chunk_info->bucket_idx);
+        chunk_info->bucket_idx = mem_layout_merge_bucket_with_previous(layout, chunk_info->bucket_idx);
+        mem_layout_update_free_sizes(layout, chunk_info->bucket_idx, (int64_t)bucket_size);
     } else if (chunk_info->is_first_in_bucket) {
-        layout->bucket_offsets[chunk_info->bucket_idx] += chunk->size;
-        chunk_info->bucket_idx -= 1;
-        mem_layout_update_free_sizes(layout, chunk_info->bucket_idx, (int32_t)chunk->size, UPDATE_PARENTS);
+        const size_t prev_bucket_idx = mem_layout_find_bucket(layout, chunk_info->bucket_idx - 1);
+        mem_layout_move_bucket_start(layout, chunk_info->bucket_idx, chunk_end, prev_bucket_idx);
+        chunk_info->bucket_idx = prev_bucket_idx;
+        mem_layout_update_free_sizes(layout, chunk_info->bucket_idx, (int64_t)mem_chunk_size(chunk));
     } else if (chunk_info->is_last_in_bucket) {
-        mem_layout_update_free_sizes(layout, chunk_info->bucket_idx, (int32_t)chunk->size, UPDATE_PARENTS);
+        mem_layout_update_free_sizes(layout, chunk_info->bucket_idx, (int64_t)mem_chunk_size(chunk));
     } else {
-        const uint32_t split_offset = chunk->offset + chunk->size;
-        mem_layout_split_bucket_at(layout, chunk_info->bucket_idx, split_offset);
-        mem_layout_update_free_sizes(layout, chunk_info->bucket_idx, (int32_t)chunk->size, DONT_UPDATE_PARENTS);
-        mem_layout_rebuild(layout);
+        mem_layout_split_bucket_at(layout, chunk_info->bucket_idx, chunk_end);
+        mem_layout_update_free_sizes(layout, chunk_info->bucket_idx, (int64_t)mem_chunk_size(chunk));
     }
+    mem_region_index_update(chunk_info->arena);
 }
 
 static void mem_chunk_revert(const MycMemChunk_t *chunk, MycMemChunkSearchInfo_t *chunk_info)
@@ -176,133 +726,265 @@ static void mem_chunk_revert(const MycMemChunk_t *chunk, MycMemChunkSearchInfo_t
     MYC_ASSERT(!(chunk_info->bucket_idx == 0 && chunk_info->is_first_in_bucket), "First chunk is internal and never reverted.");
 
     MycMemLayout_t *layout = &chunk_info->arena->layout;
-    const bool is_first_free_chunk = chunk->offset == mem_layout_bucket_free_offset(layout, chunk_info->bucket_idx);
-    const bool is_last_free_chunk = chunk->offset + chunk->size == layout->bucket_offsets[chunk_info->bucket_idx + 1];
+    const bool is_first_free_chunk = mem_chunk_offset(chunk) == mem_layout_bucket_free_offset(layout, chunk_info->bucket_idx);
     if (is_first_free_chunk) {
-        mem_layout_update_free_sizes(layout, chunk_info->bucket_idx, (int32_t)(-chunk->size), UPDATE_PARENTS);
-    } else if (is_last_free_chunk) {
-        mem_layout_update_free_sizes(layout, chunk_info->bucket_idx, (int32_t)(-chunk->size), UPDATE_PARENTS);
-        chunk_info->bucket_idx += 1;
-        layout->bucket_offsets[chunk_info->bucket_idx] -= chunk->size;
+        mem_layout_update_free_sizes(layout, chunk_info->bucket_idx, -(int64_t)mem_chunk_size(chunk));
     } else {
-        mem_layout_split_bucket_at(layout, chunk_info->bucket_idx, chunk->offset);
-        chunk_info->bucket_idx += 1;
-        mem_layout_update_free_sizes(layout, chunk_info->bucket_idx, (int32_t)(-chunk->size), DONT_UPDATE_PARENTS);
-        mem_layout_rebuild(layout);
+        /* The chunk becomes the first chunk of a new bucket, which may be left without any free space. */
+        mem_layout_split_bucket_at(layout, chunk_info->bucket_idx, mem_chunk_offset(chunk));
+        chunk_info->bucket_idx = chunk->page_idx;
+        mem_layout_update_free_sizes(layout, chunk_info->bucket_idx, -(int64_t)mem_chunk_size(chunk));
     }
+    mem_region_index_update(chunk_info->arena);
 }
 
 
 
 // === LAYOUT MANAGEMENT =========================================================================================== //
 
-static myc_err_t find_best_suitable_arena(MycMemArena_t** arena, uint32_t chunk_size)
+static myc_err_t find_best_suitable_arena(MycMemArena_t** arena, size_t chunk_size)
 {
-    myc_err_t is_found = MYC_FAILED;
-    uint32_t min_suitable_free_size = UINT32_MAX;
-    for (MycMemArena_t *arena_i = *arena; arena_i != NULL; arena_i = arena_i->next) {
-        const uint32_t max_free_size = arena_i->layout.max_free_sizes[0];
-        if (max_free_size >= chunk_size && max_free_size <= min_suitable_free_size) {
-            min_suitable_free_size = max_free_size;
-            *arena = arena_i;
-            is_found = MYC_SUCCESS;
-        }
+    MycMemArena_t *region = mem_region_index_find(*arena, chunk_size);
+    if (region == NULL) {
+        return MYC_FAILED;
     }
-    return is_found;
+    *arena = region;
+    return MYC_SUCCESS;
 }
 
-static size_t mem_layout_find_min_suitable_bucket(const MycMemLayout_t *layout, uint32_t chunk_size)
+static size_t mem_layout_find_min_suitable_bucket(const MycMemLayout_t *layout, size_t chunk_size)
 {
+    const uint32_t search_size = mem_layout_encode_free_size(chunk_size);
     size_t node_idx = 0;
-    uint32_t min_suitable_free_size = layout->max_free_sizes[node_idx];
-    while (node_idx < layout->parent_node_count) {
-        const size_t start_idx = node_children_base_idx(node_idx);
-        const size_t end_idx = MYC_MIN(start_idx + MYC_MEM_LAYOUT_NODE_CHILD_COUNT, mem_layout_node_count(layout));
-        for (size_t child_idx = start_idx; child_idx < end_idx; ++child_idx) {
-            const uint32_t max_free_size = layout->max_free_sizes[child_idx];
-            if (max_free_size >= chunk_size && max_free_size <= min_suitable_free_size) {
-                min_suitable_free_size = max_free_size;
-                node_idx = child_idx;
-            }
-        }
+    for (size_t level = 1; level < layout->level_count; ++level) {
+        const uint32_t *children = &layout->levels[level][node_idx * MYC_MEM_LAYOUT_NODE_CHILD_COUNT];
+        node_idx = (node_idx * MYC_MEM_LAYOUT_NODE_CHILD_COUNT) + mem_layout_kernels.find_min_suitable_child(children, search_size);
     }
-    const size_t bucket_idx = node_idx - layout->parent_node_count;
+    const size_t bucket_idx = node_idx;
     return bucket_idx;
 }
 
-static void mem_layout_update_free_sizes(MycMemLayout_t *layout, size_t bucket_idx, int32_t size_diff, bool update_parents)
+/* Returns the bucket containing the page at 'page_idx', which is the last page at or before it that starts a bucket. */
+static size_t mem_layout_find_bucket(const MycMemLayout_t *layout, size_t page_idx)
 {
-    size_t node_idx = bucket_idx + layout->parent_node_count;
-    layout->max_free_sizes[node_idx] += size_diff;
-
-    bool keep_updating = update_parents;
-    while (node_idx > 0 && keep_updating) {
-        const size_t parent_idx = node_parent_idx(node_idx);
-        const size_t start_idx = node_children_base_idx(node_idx);
-        const size_t end_idx = MYC_MIN(start_idx + MYC_MEM_LAYOUT_NODE_CHILD_COUNT, mem_layout_node_count(layout));
-        uint32_t new_max_free_size = layout->max_free_sizes[parent_idx];
-        for (size_t child_idx = start_idx; child_idx < end_idx; ++child_idx) {
-            new_max_free_size = MYC_MAX(layout->max_free_sizes[child_idx], new_max_free_size);
+    /* Walk up until a word at or left of the page has a bit set at or before it... */
+    size_t level = 0;
+    size_t bit_idx = page_idx;
+    uint64_t word;
+    for (;;) {
+        const size_t bit_offset = bit_idx % MYC_MEM_LAYOUT_BITMAP_WORD_BITS;
+        word = layout->bucket_bitmaps[level][bit_idx / MYC_MEM_LAYOUT_BITMAP_WORD_BITS] & (~0ull >> (MYC_MEM_LAYOUT_BITMAP_WORD_BITS - 1 - bit_offset));
+        if (word != 0) {
+            break;
         }
-        keep_updating = (new_max_free_size != layout->max_free_sizes[parent_idx]);
-        layout->max_free_sizes[parent_idx] = new_max_free_size;
-        node_idx = parent_idx;
+        MYC_ASSERT(bit_idx >= MYC_MEM_LAYOUT_BITMAP_WORD_BITS, "The first page always starts a bucket.");
+        bit_idx = (bit_idx / MYC_MEM_LAYOUT_BITMAP_WORD_BITS) - 1;
+        level += 1;
     }
+    bit_idx = (bit_idx & ~(size_t)(MYC_MEM_LAYOUT_BITMAP_WORD_BITS - 1)) + (MYC_MEM_LAYOUT_BITMAP_WORD_BITS - 1 - (size_t)__builtin_clzll(word));
+
+    /* ...and walk back down along the highest set bits. */
+    while (level > 0) {
+        level -= 1;
+        word = layout->bucket_bitmaps[level][bit_idx];
+        bit_idx = (bit_idx * MYC_MEM_LAYOUT_BITMAP_WORD_BITS) + (MYC_MEM_LAYOUT_BITMAP_WORD_BITS - 1 - (size_t)__builtin_clzll(word));
+    }
+    const size_t bucket_idx = bit_idx;
+    return bucket_idx;
 }
 
-static void mem_layout_merge_bucket_with_previous(MycMemLayout_t *layout, size_t bucket_idx)
+static void mem_layout_set_bucket_free_size(MycMemLayout_t *layout, size_t bucket_idx, size_t free_size)
 {
-    const size_t node_idx = bucket_idx + layout->parent_node_count;
-    
-    uint32_t *bucket = &layout->bucket_offsets[bucket_idx];
-    size_t move_size = (layout->bucket_node_count - bucket_idx) * sizeof(uint32_t);
-    memmove(bucket, bucket + 1, move_size);
+    mem_layout_set_leaf(layout, bucket_idx, mem_layout_encode_free_size(free_size) | MYC_MEM_LAYOUT_BUCKET_TAG);
+}
 
-    uint32_t *node = &layout->max_free_sizes[node_idx];
-    move_size = (mem_layout_node_count(layout) - node_idx - 1) * sizeof(uint32_t);
-    memmove(node, node + 1, move_size);
+static void mem_layout_update_free_sizes(MycMemLayout_t *layout, size_t bucket_idx, int64_t size_diff)
+{
+    const size_t free_size = (size_t)((int64_t)mem_layout_bucket_free_size(layout, bucket_idx) + size_diff);
+    mem_layout_set_bucket_free_size(layout, bucket_idx, free_size);
+}
 
-    layout->bucket_node_count -= 1;
-    mem_layout_update_parent_node_count(layout);
+/* Merges the bucket into its previous bucket, without changing the free size of either, and returns the merged bucket. */
+static size_t mem_layout_merge_bucket_with_previous(MycMemLayout_t *layout, size_t bucket_idx)
+{
+    const size_t prev_bucket_idx = mem_layout_find_bucket(layout, bucket_idx - 1);
+    layout->bucket_end_pages[prev_bucket_idx] = layout->bucket_end_pages[bucket_idx];
+    mem_layout_set_leaf(layout, bucket_idx, 0);
+    return prev_bucket_idx;
 }
 
-static void mem_layout_split_bucket_at(MycMemLayout_t *layout, size_t bucket_idx, uint32_t split_offset)
+/* Splits the bucket in two at 'split_offset'. The free tail stays with the new bucket, as far as it fits. */
+static void mem_layout_split_bucket_at(MycMemLayout_t *layout, size_t bucket_idx, size_t split_offset)
 {
-    const size_t node_idx = bucket_idx + layout->parent_node_count;
-    const uint32_t new_bucket_size = layout->bucket_offsets[bucket_idx + 1] - split_offset;
+    const size_t new_bucket_idx = mem_layout_page_idx(split_offset);
+    const size_t new_bucket_size = mem_layout_bucket_end(layout, bucket_idx) - split_offset;
+    const size_t free_size = mem_layout_bucket_free_size(layout, bucket_idx);
+
+    layout->bucket_end_pages[new_bucket_idx] = layout->bucket_end_pages[bucket_idx];
+    layout->bucket_end_pages[bucket_idx] = (uint32_t)new_bucket_idx;
+    mem_layout_set_bucket_free_size(layout, new_bucket_idx, MYC_MIN(free_size, new_bucket_size));
+    mem_layout_set_bucket_free_size(layout, bucket_idx, (free_size > new_bucket_size) ? free_size - new_bucket_size : 0);
+}
 
-    uint32_t *bucket = &layout->bucket_offsets[bucket_idx];
-    size_t move_size = (layout->bucket_node_count - bucket_idx) * sizeof(uint32_t);
-    memmove(bucket + 2, bucket + 1, move_size);
+/* Moves the start of the bucket (and so the end of its previous bucket) to 'new_start_offset'. */
+static void mem_layout_move_bucket_start(MycMemLayout_t *layout, size_t bucket_idx, size_t new_start_offset, size_t prev_bucket_idx)
+{
+    const size_t new_bucket_idx = mem_layout_page_idx(new_start_offset);
+    const uint32_t leaf = mem_layout_leaves(layout)[bucket_idx];
+    layout->bucket_end_pages[new_bucket_idx] = layout->bucket_end_pages[bucket_idx];
+    layout->bucket_end_pages[prev_bucket_idx] = (uint32_t)new_bucket_idx;
+    mem_layout_set_leaf(layout, bucket_idx, 0);
+    mem_layout_set_leaf(layout, new_bucket_idx, leaf);
+}
 
-    uint32_t *node = &layout->max_free_sizes[node_idx];
-    move_size = (mem_layout_node_count(layout) - node_idx) * sizeof(uint32_t);
-    memmove(node + 1, node, move_size);
+/* Sets the leaf of the page at 'page_idx' and updates its ancestors, stopping as soon as one of them is unchanged. */
+static void mem_layout_set_leaf(MycMemLayout_t *layout, size_t page_idx, uint32_t leaf)
+{
+    size_t level = layout->level_count - 1;
+    size_t node_idx = page_idx;
+    const uint32_t old_leaf = layout->levels[level][node_idx];
+    if ((old_leaf == 0) != (leaf == 0)) {
+        mem_layout_set_bucket_bit(layout, page_idx, leaf != 0);
+        __atomic_store_n(&layout->bucket_count, (leaf != 0) ? layout->bucket_count + 1 : layout->bucket_count - 1, __ATOMIC_RELAXED);
+    }
+    /* Stats are read without holding the region lock, hence the atomic stores. */
+    __atomic_store_n(&layout->free_size, layout->free_size - mem_layout_decode_free_size(old_leaf) + mem_layout_decode_free_size(leaf), __ATOMIC_RELAXED);
+    layout->levels[level][node_idx] = leaf;
+    if (layout->is_deferred) {
+        layout->deferred_page_start = MYC_MIN(layout->deferred_page_start, page_idx);
+        layout->deferred_page_end = MYC_MAX(layout->deferred_page_end, page_idx + 1);
+        return;
+    }
+    while (level > 0) {
+        const uint32_t *children = &layout->levels[level][node_idx & ~(size_t)(MYC_MEM_LAYOUT_NODE_CHILD_COUNT - 1)];
+        const uint32_t max_free_size = mem_layout_kernels.max_child(children);
+        level -= 1;
+        node_idx /= MYC_MEM_LAYOUT_NODE_CHILD_COUNT;
+        if (layout->levels[level][node_idx] == max_free_size) {
+            break;
+        }
+        layout->levels[level][node_idx] = max_free_size;
+    }
+}
+
+/* Marks or unmarks the page as a bucket start, updating the summary bits of every word that becomes (non-)zero. */
+static void mem_layout_set_bucket_bit(MycMemLayout_t *layout, size_t page_idx, bool is_set)
+{
+    size_t bit_idx = page_idx;
+    for (size_t level = 0; level < layout->bitmap_level_count; ++level) {
+        uint64_t *word = &layout->bucket_bitmaps[level][bit_idx / MYC_MEM_LAYOUT_BITMAP_WORD_BITS];
+        const uint64_t bit = 1ull << (bit_idx % MYC_MEM_LAYOUT_BITMAP_WORD_BITS);
+        const bool was_zero = (*word == 0);
+        *word = is_set ? (*word | bit) : (*word & ~bit);
+        if (was_zero == (*word == 0)) {
+            break;
+        }
+        bit_idx /= MYC_MEM_LAYOUT_BITMAP_WORD_BITS;
+    }
+}
+
+/* Stops updating the ancestors of changed leaves until 'mem_layout_flush', which updates them all in one sweep per level. 
+Only the leaves and bucket bitmaps are valid in between, so the tree must not be searched. */
+static void mem_layout_defer(MycMemLayout_t *layout)
+{
+    layout->is_deferred = true;
+    layout->deferred_page_start = layout->page_count;
+    layout->deferred_page_end = 0;
+}
 
-    layout->bucket_node_count += 1;
-    layout->bucket_offsets[bucket_idx + 1] = split_offset;
-    layout->max_free_sizes[node_idx] = MYC_MAX((int32_t)(layout->max_free_sizes[node_idx] - new_bucket_size), 0);
-    layout->max_free_sizes[node_idx + 1] = MYC_MIN(layout->max_free_sizes[node_idx + 1], new_bucket_size);
-    mem_layout_update_parent_node_count(layout);
+static void mem_layout_flush(MycMemLayout_t *layout)
+{
+    layout->is_deferred = false;
+    if (layout->deferred_page_start >= layout->deferred_page_end) {
+        return;
+    }
+    size_t node_start = layout->deferred_page_start;
+    size_t node_end = layout->deferred_page_end;
+    for (size_t level = layout->level_count - 1; level > 0; --level) {
+        node_start /= MYC_MEM_LAYOUT_NODE_CHILD_COUNT;
+        node_end = calc_mem_layout_parent_count(node_end);
+        for (size_t node_idx = node_start; node_idx < node_end; ++node_idx) {
+            const uint32_t *children = &layout->levels[level][node_idx * MYC_MEM_LAYOUT_NODE_CHILD_COUNT];
+            layout->levels[level - 1][node_idx] = mem_layout_kernels.max_child(children);
+        }
+    }
 }
 
-static void mem_layout_update_parent_node_count(MycMemLayout_t *layout)
+/* Sets up the layout tree in 'memory' for a region of 'page_count' pages, whose first 'internal_size' bytes are in use.
+The tree is shaped for 'page_capacity' pages, so the region can grow up to that many pages later on.
+!!NOTE: 'memory' must be zero initialized. */
+void mem_layout_init(MycMemLayout_t *layout, void *memory, size_t page_capacity, size_t page_count, size_t internal_size)
 {
-    const size_t new_prarent_node_count = calc_parent_node_count(layout->bucket_node_count);
-    if (new_prarent_node_count != layout->parent_node_count) {
-        uint32_t *node = &layout->max_free_sizes[layout->parent_node_count];
-        size_t move_offset = new_prarent_node_count - layout->parent_node_count;
-        size_t move_size = layout->bucket_node_count * sizeof(uint32_t);
-        memmove(node + move_offset, node, move_size);
+    MYC_ASSERT(page_count <= page_capacity, "Layout page count exceeds its capacity.");
+    size_t level_node_counts[MYC_MEM_LAYOUT_LEVEL_COUNT_MAX];
+    size_t level_count = 0;
+    for (size_t level_node_count = page_capacity; ; level_node_count = calc_mem_layout_parent_count(level_node_count)) {
+        MYC_ASSERT(level_count < MYC_MEM_LAYOUT_LEVEL_COUNT_MAX, "Too many pages for the layout tree.");
+        level_node_counts[level_count] = level_node_count;
+        level_count += 1;
+        if (level_node_count == 1) break;
+    }
+
+    uint32_t *nodes = memory;
+    for (size_t level = 0; level < level_count; ++level) {
+        layout->levels[level] = nodes;
+        nodes += calc_mem_layout_level_size(level_node_counts[level_count - level - 1]);
+    }
+    layout->page_count = page_count;
+    layout->page_capacity = page_capacity;
+    layout->level_count = level_count;
+    layout->max_free_sizes = layout->levels[0];
+    layout->free_size = 0;
+    layout->bucket_count = 0;
+    layout->is_deferred = false;
+
+    uint64_t *words = (void*)nodes;
+    layout->bitmap_level_count = 0;
+    for (size_t level_bit_count = page_capacity; ; ) {
+        level_bit_count = (level_bit_count + MYC_MEM_LAYOUT_BITMAP_WORD_BITS - 1) / MYC_MEM_LAYOUT_BITMAP_WORD_BITS;
+        MYC_ASSERT(layout->bitmap_level_count < MYC_MEM_LAYOUT_BITMAP_LEVEL_COUNT_MAX, "Too many pages for the bucket bitmaps.");
+        layout->bucket_bitmaps[layout->bitmap_level_count] = words;
+        layout->bitmap_level_count += 1;
+        words += level_bit_count;
+        if (level_bit_count == 1) break;
     }
-    layout->parent_node_count = new_prarent_node_count;
+    layout->bucket_end_pages = (void*)words;
+    layout->bucket_end_pages[0] = (uint32_t)page_count;
+    mem_layout_set_bucket_free_size(layout, 0, mem_layout_page_offset(page_count) - internal_size);
 }
 
-static void mem_layout_rebuild(MycMemLayout_t *layout)
+/* Resets the layout to a single bucket, whose first 'internal_size' bytes are in use. */
+void mem_layout_reset(MycMemLayout_t *layout, size_t internal_size)
 {
-    memset(layout->max_free_sizes, 0, layout->parent_node_count * sizeof(uint32_t));
-    for (size_t node_idx = mem_layout_node_count(layout); node_idx > 0; --node_idx) {
-        const size_t parent_idx = node_parent_idx(node_idx);
-        layout->max_free_sizes[parent_idx] = MYC_MAX(layout->max_free_sizes[node_idx], layout->max_free_sizes[parent_idx]);
+    /* Every non-zero node and bitmap word lies on the path of some bucket start, so clearing those paths clears them all. */
+    size_t bucket_idx = 0;
+    while (bucket_idx < layout->page_count) {
+        const size_t next_bucket_idx = layout->bucket_end_pages[bucket_idx];
+        size_t node_idx = bucket_idx;
+        for (size_t level = layout->level_count; level-- > 0; node_idx /= MYC_MEM_LAYOUT_NODE_CHILD_COUNT) {
+            layout->levels[level][node_idx] = 0;
+        }
+        size_t bit_idx = bucket_idx;
+        for (size_t level = 0; level < layout->bitmap_level_count; ++level, bit_idx /= MYC_MEM_LAYOUT_BITMAP_WORD_BITS) {
+            layout->bucket_bitmaps[level][bit_idx / MYC_MEM_LAYOUT_BITMAP_WORD_BITS] = 0;
+        }
+        bucket_idx = next_bucket_idx;
     }
-}
\ No newline at end of file
+
+    __atomic_store_n(&layout->free_size, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&layout->bucket_count, 0, __ATOMIC_RELAXED);
+    layout->bucket_end_pages[0] = (uint32_t)layout->page_count;
+    mem_layout_set_bucket_free_size(layout, 0, mem_layout_page_offset(layout->page_count) - internal_size);
+}
+
+/* Grows the layout to 'page_count' pages (at most its capacity), adding the new pages to the free tail of the last bucket. */
+void mem_layout_grow(MycMemLayout_t *layout, size_t page_count)
+{
+    MYC_ASSERT(page_count >= layout->page_count && page_count <= layout->page_capacity, "Layout can not grow to the given page count.");
+    const size_t last_bucket_idx = mem_layout_find_bucket(layout, layout->page_count - 1);
+    const size_t add_size = mem_layout_page_offset(page_count - layout->page_count);
+    const size_t free_size = mem_layout_bucket_free_size(layout, last_bucket_idx) + add_size;
+    layout->bucket_end_pages[last_bucket_idx] = (uint32_t)page_count;
+    layout->page_count = page_count;
+    mem_layout_set_bucket_free_size(layout, last_bucket_idx, free_size);
+}
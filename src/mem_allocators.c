@@ -1,9 +1,73 @@
 #include "myc/core.h"
 #include "./_memory_.h"
 
+
+
+// === BUMP ALLOCATOR ============================================================================================== //
+
+/* Concurrent allocations hand out multiples of sizeof(void*) from offsets which are multiples of sizeof(void*). */
+_Static_assert(sizeof(MycMemBumpAlloc_t) % sizeof(void*) == 0, "Bump allocator header breaks concurrent alignment.");
+_Static_assert(sizeof(MycMemBumpAllocNode_t) % sizeof(void*) == 0, "Bump allocator node header breaks concurrent alignment.");
+
+static myc_err_t mem_bump_alloc_node_create(MycMemBumpAllocNode_t **new_node, MycMemArena_t *arena, uint32_t size);
+static void mem_bump_alloc_append_concurrent(MycMemBumpAlloc_t *bump_alloc, MycMemBumpAllocNode_t *node);
+static void mem_bump_alloc_free_nodes(MycMemBumpAllocNode_t *node);
+static void* mem_bump_aligned_malloc_slow(MycMemBumpAlloc_t *bump_alloc, uint32_t size, size_t alignment);
+static void* mem_bump_aligned_malloc_large(MycMemBumpAlloc_t *bump_alloc, uint64_t reserve_size, size_t alignment);
+static void* mem_bump_aligned_malloc_concurrent(MycMemBumpAlloc_t *bump_alloc, uint32_t size, size_t alignment);
+
+/* Returns the number of bytes a fresh node needs to fit 'size' bytes at the given alignment. Nodes start at multiples 
+of sizeof(void*), so only larger alignments need padding. */
+static inline uint64_t mem_bump_alloc_reserve_size(uint32_t size, size_t alignment)
+{
+    const uint32_t padding_size = (alignment > sizeof(void*)) ? (uint32_t)(alignment - sizeof(void*)) : 0;
+    return (uint64_t)MYC_QUANTIZE_UP(size, sizeof(void*)) + padding_size;
+}
+
+/* Allocations of growing bump allocators above this size get a dedicated node. */
+static inline uint64_t mem_bump_alloc_large_size_min(const MycMemBumpAlloc_t *bump_alloc)
+{
+    return bump_alloc->node_size_max / 4;
+}
+
+/* Returns the size of a node following 'node' with room for 'reserve_size' bytes. Growing bump allocators double the 
+node size up to the maximum node size, the others keep it. */
+static inline uint32_t mem_bump_alloc_next_node_size(const MycMemBumpAlloc_t *bump_alloc, const MycMemBumpAllocNode_t *node, uint64_t reserve_size)
+{
+    uint64_t node_size = node->capacity;
+    if (mem_bump_alloc_is_growing(bump_alloc)) {
+        node_size = MYC_MIN(2 * node_size, bump_alloc->node_size_max);
+    }
+    return (uint32_t)(MYC_MAX(node_size, reserve_size + sizeof(MycMemBumpAllocNode_t)) - sizeof(MycMemBumpAllocNode_t));
+}
+
+/* Reserves 'size' bytes at the given alignment within the node, if they fit. */
+static inline void* mem_bump_alloc_node_malloc(MycMemBumpAllocNode_t *node, uint32_t size, size_t alignment)
+{
+    void *const end_ptr = mem_bump_alloc_node_end_ptr(node);
+    void *const free_ptr = mem_bump_alloc_node_free_ptr(node);
+    void *const aligned_free_ptr = (void*)MYC_QUANTIZE_UP((size_t)free_ptr, alignment);
+    if (aligned_free_ptr + size > end_ptr) {
+        return MYC_MEM_ALLOC_FAILED;
+    }
+    node->size_used += size + (aligned_free_ptr - free_ptr);
+    return aligned_free_ptr;
+}
+
 /* Creates a new bump allocator with a capacity of at least 'size' bytes. */
 myc_err_t myc_mem_bump_alloc_create(MycMemBumpAlloc_t **new_bump_alloc, MycMemArena_t *arena, uint32_t size)
 {
+    return myc_mem_bump_alloc_create_with_flags(new_bump_alloc, arena, size, MYC_MEM_BUMP_ALLOC_FLAG_NONE);
+}
+
+/* Creates a new bump allocator with a capacity of at least 'size' bytes and the behaviour given by 'flags'. */
+myc_err_t myc_mem_bump_alloc_create_with_flags(MycMemBumpAlloc_t **new_bump_alloc, MycMemArena_t *arena, uint32_t size, myc_mem_bump_alloc_flags_t flags)
+{
+    if ((flags & MYC_MEM_BUMP_ALLOC_FLAG_CONCURRENT) && !mem_arena_is_thread_safe(arena)) {
+        MYC_LOG_TRACE("Concurrent bump allocators need a thread safe arena.");
+        return MYC_ERR_INVALID_ARGUMENT;
+    }
+
     MycMemBumpAlloc_t *bump_alloc = myc_mem_arena_malloc(arena, size + sizeof(MycMemBumpAlloc_t));
     if (bump_alloc == MYC_MEM_ALLOC_FAILED) {
         MYC_LOG_TRACE("Cannot allocate enough memory.");
@@ -17,6 +81,10 @@ myc_err_t myc_mem_bump_alloc_create(MycMemBumpAlloc_t **new_bump_alloc, MycMemAr
     bump_alloc->arena = arena;
     bump_alloc->current = &bump_alloc->node;
     bump_alloc->last = &bump_alloc->node;
+    bump_alloc->peak = &bump_alloc->node;
+    bump_alloc->large_nodes = NULL;
+    bump_alloc->flags = flags;
+    bump_alloc->node_size_max = MYC_MEM_BUMP_ALLOC_DEFAULT_NODE_SIZE_MAX;
     *new_bump_alloc = bump_alloc;
     return MYC_SUCCESS;
 }
@@ -24,28 +92,33 @@ myc_err_t myc_mem_bump_alloc_create(MycMemBumpAlloc_t **new_bump_alloc, MycMemAr
 /* Expands the bump allocator by creating a new allocator of at least 'add_size' bytes and adding it as a child. */
 myc_err_t myc_mem_bump_alloc_expand(MycMemBumpAlloc_t *bump_alloc, uint32_t add_size)
 {
-    MycMemBumpAllocNode_t *node = myc_mem_arena_malloc(bump_alloc->arena, add_size + sizeof(MycMemBumpAllocNode_t));
-    if (node == MYC_MEM_ALLOC_FAILED) {
-        MYC_LOG_TRACE("Cannot allocate enough memory.");
-        return MYC_ERR_NO_MEMORY;
+    myc_err_t exit_code;
+    MycMemBumpAllocNode_t *node;
+    if ((exit_code = mem_bump_alloc_node_create(&node, bump_alloc->arena, add_size)) != MYC_SUCCESS) {
+        return exit_code;
     }
 
-    uint32_t chunk_size = myc_mem_arena_get_chunk_size(node);
-    node->capacity = chunk_size;
-    node->size_used = sizeof(MycMemBumpAllocNode_t);
-    node->next = NULL;
-    bump_alloc->last->next = node;
-    bump_alloc->last = node;
+    if (mem_bump_alloc_is_concurrent(bump_alloc)) {
+        mem_bump_alloc_append_concurrent(bump_alloc, node);
+    } else {
+        bump_alloc->last->next = node;
+        bump_alloc->last = node;
+    }
     return MYC_SUCCESS;
 }
 
 /* Destroys the bump allocator and frees all memory allocated by it. */
 void myc_mem_bump_alloc_destroy(MycMemBumpAlloc_t *bump_alloc)
 {
+    mem_bump_alloc_free_nodes(bump_alloc->node.next);
+    mem_bump_alloc_free_nodes(bump_alloc->large_nodes);
     myc_mem_arena_free(bump_alloc);
-    for (MycMemBumpAllocNode_t *node = bump_alloc->node.next; node != NULL; node = node->next) {
-        myc_mem_arena_free(node);
-    }
+}
+
+/* Sets the size up to which the nodes of a growing bump allocator double (see 'MYC_MEM_BUMP_ALLOC_FLAG_GROW'). */
+void myc_mem_bump_alloc_set_node_size_max(MycMemBumpAlloc_t *bump_alloc, uint32_t node_size_max)
+{
+    bump_alloc->node_size_max = node_size_max;
 }
 
 /* Allocates 'size' bytes on the bump allocator, aligned to a multiple of 'alignment' 
@@ -53,31 +126,486 @@ void myc_mem_bump_alloc_destroy(MycMemBumpAlloc_t *bump_alloc)
 void* myc_mem_bump_aligned_malloc(MycMemBumpAlloc_t *bump_alloc, uint32_t size, size_t alignment)
 {
     MYC_ASSERT(MYC_IS_POWER_OFF_TWO(alignment), "Given alignment must be a power of two.");
+    if (mem_bump_alloc_is_concurrent(bump_alloc)) {
+        return mem_bump_aligned_malloc_concurrent(bump_alloc, size, alignment);
+    }
 
-    for (MycMemBumpAllocNode_t *node = bump_alloc->current; node != NULL; node = node->next) {
-        void *const end_ptr = mem_bump_alloc_node_end_ptr(node);
-        void *const free_ptr = mem_bump_alloc_node_free_ptr(node);
-        void *const aligned_free_ptr = (void*)MYC_QUANTIZE_UP((size_t)free_ptr, alignment);
-        if (aligned_free_ptr + size <= end_ptr) {
-            node->size_used += size + (aligned_free_ptr - free_ptr);
-            bump_alloc->current = node;
-            return aligned_free_ptr;
-        }
+    void *addr = mem_bump_alloc_node_malloc(bump_alloc->current, size, alignment);
+    if (addr != MYC_MEM_ALLOC_FAILED) {
+        return addr;
     }
-    return MYC_MEM_ALLOC_FAILED;
+    return mem_bump_aligned_malloc_slow(bump_alloc, size, alignment);
 }
 
 /* Returns the number of contiguous bytes still available. */
 uint32_t myc_mem_bump_alloc_get_free_size(MycMemBumpAlloc_t *bump_alloc)
 {
-    return bump_alloc->current->capacity - bump_alloc->current->size_used;
+    const MycMemBumpAllocNode_t *current = __atomic_load_n(&bump_alloc->current, __ATOMIC_ACQUIRE);
+    const uint32_t size_used = __atomic_load_n(&current->size_used, __ATOMIC_RELAXED);
+    return (size_used < current->capacity) ? current->capacity - size_used : 0;
 }
 
-/* Resets the bump allocator as if no allocations were made previously. */
+/* Resets the bump allocator in O(1) as if no allocations were made previously. 
+Dedicated nodes of oversized allocations (see 'MYC_MEM_BUMP_ALLOC_FLAG_GROW') are given back to the arena. 
+!!NOTE: For concurrent bump allocators, no other thread may use the allocator during this call, 
+and the reset takes time linear in the number of nodes. */
 void myc_mem_bump_alloc_reset(MycMemBumpAlloc_t *bump_alloc)
 {
+    if (bump_alloc->large_nodes != NULL) {
+        mem_bump_alloc_free_nodes(bump_alloc->large_nodes);
+        bump_alloc->large_nodes = NULL;
+    }
     bump_alloc->node.size_used = sizeof(MycMemBumpAlloc_t);
-    for (MycMemBumpAllocNode_t *node = bump_alloc->node.next; node != NULL; node = node->next) {
+    bump_alloc->current = &bump_alloc->node;
+    bump_alloc->peak = &bump_alloc->node;
+    if (mem_bump_alloc_is_concurrent(bump_alloc)) {
+        /* Concurrent allocations never reset a node lazily (see 'myc_mem_bump_aligned_malloc'), 
+        because another thread may already be allocating from it. */
+        for (MycMemBumpAllocNode_t *node = bump_alloc->node.next; node != NULL; node = node->next) {
+            node->size_used = sizeof(MycMemBumpAllocNode_t);
+        }
+    }
+}
+
+/* Resets the bump allocator and gives every node which was not needed since the last reset back to the arena, 
+trimming the allocator down to the peak working set of the last cycle. 
+!!NOTE: For concurrent bump allocators, no other thread may use the allocator during this call. */
+void myc_mem_bump_alloc_reset_trim(MycMemBumpAlloc_t *bump_alloc)
+{
+    /* Nodes are only ever used in list order, so the nodes past the peak one were not needed since the last reset. */
+    MycMemBumpAllocNode_t *peak = bump_alloc->peak;
+    mem_bump_alloc_free_nodes(peak->next);
+    peak->next = NULL;
+    bump_alloc->last = peak;
+    myc_mem_bump_alloc_reset(bump_alloc);
+}
+
+/* Returns a savepoint of the bump allocator in O(1), which 'myc_mem_bump_alloc_rewind' rolls back to. 
+!!NOTE: For concurrent bump allocators, no other thread may use the allocator during this call. */
+MycMemBumpAllocMark_t myc_mem_bump_alloc_mark(MycMemBumpAlloc_t *bump_alloc)
+{
+    return (MycMemBumpAllocMark_t){
+        .node = bump_alloc->current,
+        .large_nodes = bump_alloc->large_nodes,
+        .size_used = bump_alloc->current->size_used,
+    };
+}
+
+/* Frees every allocation made since 'mark' was taken in O(1), apart from giving back the dedicated nodes of oversized 
+allocations. Marks nest, rewinding to a mark invalidates every mark taken after it, and a reset invalidates all marks. 
+!!NOTE: For concurrent bump allocators, no other thread may use the allocator during this call, 
+and the rewind takes time linear in the number of nodes filled since the mark. */
+void myc_mem_bump_alloc_rewind(MycMemBumpAlloc_t *bump_alloc, MycMemBumpAllocMark_t mark)
+{
+    while (bump_alloc->large_nodes != mark.large_nodes) {
+        MycMemBumpAllocNode_t *large_node = bump_alloc->large_nodes;
+        bump_alloc->large_nodes = large_node->next;
+        myc_mem_arena_free(large_node);
+    }
+
+    if (mem_bump_alloc_is_concurrent(bump_alloc)) {
+        /* Nodes past the mark are not reset lazily either (see 'myc_mem_bump_alloc_reset'). */
+        for (MycMemBumpAllocNode_t *node = mark.node; node != bump_alloc->current; ) {
+            node = node->next;
+            node->size_used = sizeof(MycMemBumpAllocNode_t);
+        }
+    }
+    mark.node->size_used = mark.size_used;
+    bump_alloc->current = mark.node;
+}
+
+static myc_err_t mem_bump_alloc_node_create(MycMemBumpAllocNode_t **new_node, MycMemArena_t *arena, uint32_t size)
+{
+    MycMemBumpAllocNode_t *node = myc_mem_arena_malloc(arena, size + sizeof(MycMemBumpAllocNode_t));
+    if (node == MYC_MEM_ALLOC_FAILED) {
+        MYC_LOG_TRACE("Cannot allocate enough memory.");
+        return MYC_ERR_NO_MEMORY;
+    }
+
+    uint32_t chunk_size = myc_mem_arena_get_chunk_size(node);
+    node->capacity = chunk_size;
+    node->size_used = sizeof(MycMemBumpAllocNode_t);
+    node->next = NULL;
+    *new_node = node;
+    return MYC_SUCCESS;
+}
+
+/* Links the node behind the last node, starting the search from the 'last' hint. */
+static void mem_bump_alloc_append_concurrent(MycMemBumpAlloc_t *bump_alloc, MycMemBumpAllocNode_t *node)
+{
+    MycMemBumpAllocNode_t *last = __atomic_load_n(&bump_alloc->last, __ATOMIC_ACQUIRE);
+    MycMemBumpAllocNode_t *next = NULL;
+    while (!__atomic_compare_exchange_n(&last->next, &next, node, false, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+        last = next;
+        next = NULL;
+    }
+    __atomic_store_n(&bump_alloc->last, node, __ATOMIC_RELEASE);
+}
+
+static void mem_bump_alloc_free_nodes(MycMemBumpAllocNode_t *node)
+{
+    while (node != NULL) {
+        MycMemBumpAllocNode_t *next_node = node->next;
+        myc_mem_arena_free(node);
+        node = next_node;
+    }
+}
+
+/* Moves on to the next node when the current one is full. Without growing, the remaining nodes are searched for one 
+with enough room. Growing bump allocators only ever look at the next node, and link a new node behind the current one 
+if that does not fit, so the slow path stays O(1) as well. */
+static void* mem_bump_aligned_malloc_slow(MycMemBumpAlloc_t *bump_alloc, uint32_t size, size_t alignment)
+{
+    const bool is_growing = mem_bump_alloc_is_growing(bump_alloc);
+    const uint64_t reserve_size = mem_bump_alloc_reserve_size(size, alignment);
+    if (is_growing && reserve_size > mem_bump_alloc_large_size_min(bump_alloc)) {
+        return mem_bump_aligned_malloc_large(bump_alloc, reserve_size, alignment);
+    }
+
+    MycMemBumpAllocNode_t *current = bump_alloc->current;
+    bool is_past_peak = (current == bump_alloc->peak);
+    for (MycMemBumpAllocNode_t *node = current->next; node != NULL; node = node->next) {
+        /* Nodes past the current one have not been used since the last reset or rewind, but are only reset here. */
         node->size_used = sizeof(MycMemBumpAllocNode_t);
+        is_past_peak = is_past_peak || (node == bump_alloc->peak);
+        void *addr = mem_bump_alloc_node_malloc(node, size, alignment);
+        if (addr != MYC_MEM_ALLOC_FAILED) {
+            bump_alloc->current = node;
+            if (is_past_peak) {
+                bump_alloc->peak = node;
+            }
+            return addr;
+        }
+        if (is_growing) {
+            break;
+        }
+    }
+    if (!is_growing) {
+        return MYC_MEM_ALLOC_FAILED;
+    }
+
+    MycMemBumpAllocNode_t *node;
+    if (mem_bump_alloc_node_create(&node, bump_alloc->arena, mem_bump_alloc_next_node_size(bump_alloc, current, reserve_size)) != MYC_SUCCESS) {
+        return MYC_MEM_ALLOC_FAILED;
+    }
+    node->next = current->next;
+    current->next = node;
+    if (bump_alloc->last == current) {
+        bump_alloc->last = node;
+    }
+    if (bump_alloc->peak == current) {
+        bump_alloc->peak = node;
+    }
+    bump_alloc->current = node;
+    return mem_bump_alloc_node_malloc(node, size, alignment);
+}
+
+/* Allocates a dedicated node for an oversized allocation, leaving the current node as it is. */
+static void* mem_bump_aligned_malloc_large(MycMemBumpAlloc_t *bump_alloc, uint64_t reserve_size, size_t alignment)
+{
+    if (reserve_size > MYC_MIN(MYC_MEM_ARENA_SIZE_MAX, UINT32_MAX) / 2) {
+        return MYC_MEM_ALLOC_FAILED;
+    }
+    MycMemBumpAllocNode_t *node;
+    if (mem_bump_alloc_node_create(&node, bump_alloc->arena, (uint32_t)reserve_size) != MYC_SUCCESS) {
+        return MYC_MEM_ALLOC_FAILED;
+    }
+    node->size_used = node->capacity;
+
+    if (mem_bump_alloc_is_concurrent(bump_alloc)) {
+        node->next = __atomic_load_n(&bump_alloc->large_nodes, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&bump_alloc->large_nodes, &node->next, node, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    } else {
+        node->next = bump_alloc->large_nodes;
+        bump_alloc->large_nodes = node;
+    }
+    return (void*)MYC_QUANTIZE_UP((size_t)node + sizeof(MycMemBumpAllocNode_t), alignment);
+}
+
+/* Reserves space with a fetch-add on the current node. Nodes which are too full are skipped by moving 'current' 
+forward, and a new node is appended when the last node fills up. The fetch-add may push 'size_used' past the capacity, 
+in which case the reservation is simply dropped. */
+static void* mem_bump_aligned_malloc_concurrent(MycMemBumpAlloc_t *bump_alloc, uint32_t size, size_t alignment)
+{
+    const uint64_t reserve_size = mem_bump_alloc_reserve_size(size, alignment);
+    if (reserve_size > MYC_MEM_ARENA_SIZE_MAX / 2) {
+        return MYC_MEM_ALLOC_FAILED;
+    }
+    if (mem_bump_alloc_is_growing(bump_alloc) && reserve_size > mem_bump_alloc_large_size_min(bump_alloc)) {
+        return mem_bump_aligned_malloc_large(bump_alloc, reserve_size, alignment);
+    }
+
+    for (;;) {
+        MycMemBumpAllocNode_t *node = __atomic_load_n(&bump_alloc->current, __ATOMIC_ACQUIRE);
+        /* Checking first keeps threads from pushing 'size_used' further past the capacity of a full node. */
+        if (__atomic_load_n(&node->size_used, __ATOMIC_RELAXED) + reserve_size <= node->capacity) {
+            const uint32_t offset = __atomic_fetch_add(&node->size_used, (uint32_t)reserve_size, __ATOMIC_RELAXED);
+            if (offset + reserve_size <= node->capacity) {
+                return (void*)MYC_QUANTIZE_UP((size_t)node + offset, alignment);
+            }
+        }
+
+        MycMemBumpAllocNode_t *next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+        if (next == NULL) {
+            const uint32_t add_size = mem_bump_alloc_next_node_size(bump_alloc, node, reserve_size);
+            if (mem_bump_alloc_node_create(&next, bump_alloc->arena, add_size) != MYC_SUCCESS) {
+                return MYC_MEM_ALLOC_FAILED;
+            }
+            MycMemBumpAllocNode_t *expected_next = NULL;
+            if (!__atomic_compare_exchange_n(&node->next, &expected_next, next, false, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+                myc_mem_arena_free(next);   // Another thread was faster.
+                next = expected_next;
+            } else {
+                __atomic_store_n(&bump_alloc->last, next, __ATOMIC_RELEASE);
+            }
+        }
+        if (__atomic_compare_exchange_n(&bump_alloc->current, &node, next, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            __atomic_compare_exchange_n(&bump_alloc->peak, &node, next, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+
+
+// === FRAME ALLOCATOR ============================================================================================= //
+
+/* Creates a new double buffered frame allocator with a capacity of at least 'size' bytes per frame. 
+Allocations stay valid during the frame they were made in and the frame after it. */
+myc_err_t myc_mem_frame_alloc_create(MycMemFrameAlloc_t **new_frame_alloc, MycMemArena_t *arena, uint32_t size)
+{
+    return myc_mem_frame_alloc_create_buffered(new_frame_alloc, arena, size, MYC_MEM_FRAME_ALLOC_DEFAULT_FRAME_COUNT);
+}
+
+/* Creates a new frame allocator with a capacity of at least 'size' bytes per frame, 
+whose allocations stay valid for 'frame_count' frames (including the frame they were made in). */
+myc_err_t myc_mem_frame_alloc_create_buffered(MycMemFrameAlloc_t **new_frame_alloc, MycMemArena_t *arena, uint32_t size, uint32_t frame_count)
+{
+    if (frame_count == 0) {
+        MYC_LOG_TRACE("Frame count must be at least one.");
+        return MYC_ERR_INVALID_ARGUMENT;
+    }
+
+    MycMemFrameAlloc_t *frame_alloc = myc_mem_arena_malloc(arena, sizeof(MycMemFrameAlloc_t) + frame_count * sizeof(MycMemBumpAlloc_t*));
+    if (frame_alloc == MYC_MEM_ALLOC_FAILED) {
+        MYC_LOG_TRACE("Cannot allocate enough memory.");
+        return MYC_ERR_NO_MEMORY;
+    }
+
+    myc_err_t exit_code;
+    for (uint32_t frame_idx = 0; frame_idx < frame_count; ++frame_idx) {
+        if ((exit_code = myc_mem_bump_alloc_create(&frame_alloc->frames[frame_idx], arena, size)) != MYC_SUCCESS) {
+            frame_alloc->frame_count = frame_idx;
+            myc_mem_frame_alloc_destroy(frame_alloc);
+            return exit_code;
+        }
+    }
+    frame_alloc->frame_count = frame_count;
+    frame_alloc->frame_idx = 0;
+    *new_frame_alloc = frame_alloc;
+    return MYC_SUCCESS;
+}
+
+/* Expands every frame of the frame allocator by at least 'add_size' bytes. */
+myc_err_t myc_mem_frame_alloc_expand(MycMemFrameAlloc_t *frame_alloc, uint32_t add_size)
+{
+    myc_err_t exit_code;
+    for (uint32_t frame_idx = 0; frame_idx < frame_alloc->frame_count; ++frame_idx) {
+        if ((exit_code = myc_mem_bump_alloc_expand(frame_alloc->frames[frame_idx], add_size)) != MYC_SUCCESS) {
+            return exit_code;
+        }
+    }
+    return MYC_SUCCESS;
+}
+
+/* Destroys the frame allocator and frees all memory allocated by it. */
+void myc_mem_frame_alloc_destroy(MycMemFrameAlloc_t *frame_alloc)
+{
+    for (uint32_t frame_idx = 0; frame_idx < frame_alloc->frame_count; ++frame_idx) {
+        myc_mem_bump_alloc_destroy(frame_alloc->frames[frame_idx]);
+    }
+    myc_mem_arena_free(frame_alloc);
+}
+
+/* Ends the current frame and begins the next one in O(1), invalidating all allocations made 'frame_count' frames ago. */
+void myc_mem_frame_alloc_begin_frame(MycMemFrameAlloc_t *frame_alloc)
+{
+    frame_alloc->frame_idx = (frame_alloc->frame_idx + 1) % frame_alloc->frame_count;
+    myc_mem_bump_alloc_reset(frame_alloc->frames[frame_alloc->frame_idx]);
+}
+
+/* Allocates 'size' bytes in the current frame, aligned to a multiple of 'alignment'. 
+!!NOTE: The given alignment must be a power of two. */
+void* myc_mem_frame_aligned_malloc(MycMemFrameAlloc_t *frame_alloc, uint32_t size, size_t alignment)
+{
+    return myc_mem_bump_aligned_malloc(frame_alloc->frames[frame_alloc->frame_idx], size, alignment);
+}
+
+/* Returns the number of contiguous bytes still available in the current frame. */
+uint32_t myc_mem_frame_alloc_get_free_size(MycMemFrameAlloc_t *frame_alloc)
+{
+    return myc_mem_bump_alloc_get_free_size(frame_alloc->frames[frame_alloc->frame_idx]);
+}
+
+
+
+// === POOL ALLOCATOR ============================================================================================== //
+
+static myc_err_t mem_pool_alloc_add_slab(MycMemPoolAlloc_t *pool_alloc);
+static void mem_pool_slab_list_push(MycMemPoolAllocSlab_t **list, MycMemPoolAllocSlab_t *slab);
+static void mem_pool_slab_list_remove(MycMemPoolAllocSlab_t **list, MycMemPoolAllocSlab_t *slab);
+static void mem_pool_slab_list_free(MycMemPoolAllocSlab_t *list);
+
+/* Creates a new pool allocator handing out objects of 'object_size' bytes, carved from slabs allocated on the arena. */
+myc_err_t myc_mem_pool_alloc_create(MycMemPoolAlloc_t **new_pool_alloc, MycMemArena_t *arena, uint32_t object_size)
+{
+    if (object_size == 0 || object_size > MYC_MIN(MYC_MEM_ARENA_SIZE_MAX, UINT32_MAX) / (2 * MYC_MEM_POOL_SLAB_OBJECT_COUNT_MIN)) {
+        MYC_LOG_TRACE("Invalid object size (%u).", object_size);
+        return MYC_ERR_INVALID_ARGUMENT;
+    }
+
+    MycMemPoolAlloc_t *pool_alloc = myc_mem_arena_malloc(arena, sizeof(MycMemPoolAlloc_t));
+    if (pool_alloc == MYC_MEM_ALLOC_FAILED) {
+        MYC_LOG_TRACE("Cannot allocate enough memory.");
+        return MYC_ERR_NO_MEMORY;
+    }
+
+    /* Objects must at least fit the free list link and keep it aligned. */
+    object_size = MYC_MAX(object_size, sizeof(void*));
+    object_size = MYC_QUANTIZE_UP(object_size, sizeof(void*));
+    const uint32_t first_object_offset = MYC_QUANTIZE_UP(sizeof(MycMemChunk_t) + sizeof(MycMemPoolAllocSlab_t), 16);
+    uint32_t slab_size = MYC_MEM_POOL_SLAB_SIZE_MIN;
+    while (slab_size < first_object_offset + object_size * MYC_MEM_POOL_SLAB_OBJECT_COUNT_MIN) {
+        slab_size *= 2;
+    }
+
+    pool_alloc->arena = arena;
+    pool_alloc->object_size = object_size;
+    pool_alloc->object_count = (slab_size - first_object_offset) / object_size;
+    pool_alloc->slab_size = slab_size;
+    pool_alloc->first_object_offset = first_object_offset;
+    pool_alloc->partial_slabs = NULL;
+    pool_alloc->full_slabs = NULL;
+    pool_alloc->empty_slab = NULL;
+    *new_pool_alloc = pool_alloc;
+    return MYC_SUCCESS;
+}
+
+/* Destroys the pool allocator and gives all its slabs back to the arena. */
+void myc_mem_pool_alloc_destroy(MycMemPoolAlloc_t *pool_alloc)
+{
+    mem_pool_slab_list_free(pool_alloc->partial_slabs);
+    mem_pool_slab_list_free(pool_alloc->full_slabs);
+    if (pool_alloc->empty_slab != NULL) {
+        myc_mem_arena_free(pool_alloc->empty_slab);
+    }
+    myc_mem_arena_free(pool_alloc);
+}
+
+/* Allocates a single object from the pool in O(1), pulling a new slab from the arena if all slabs are full. */
+void* myc_mem_pool_malloc(MycMemPoolAlloc_t *pool_alloc)
+{
+    if (pool_alloc->partial_slabs == NULL && mem_pool_alloc_add_slab(pool_alloc) != MYC_SUCCESS) {
+        return MYC_MEM_ALLOC_FAILED;
+    }
+
+    MycMemPoolAllocSlab_t *slab = pool_alloc->partial_slabs;
+    void *addr;
+    if (slab->free_list != NULL) {
+        addr = slab->free_list;
+        slab->free_list = *(void**)addr;
+    } else {
+        addr = (void*)mem_chunk_from_addr(slab) + slab->carve_offset;
+        slab->carve_offset += pool_alloc->object_size;
+    }
+
+    slab->free_count -= 1;
+    if (slab->free_count == 0) {
+        mem_pool_slab_list_remove(&pool_alloc->partial_slabs, slab);
+        mem_pool_slab_list_push(&pool_alloc->full_slabs, slab);
+    }
+    return addr;
+}
+
+/* Returns the object at 'addr' to the pool in O(1). Slabs that become fully empty are given back to the arena. */
+void myc_mem_pool_free(MycMemPoolAlloc_t *pool_alloc, void *addr)
+{
+    MycMemPoolAllocSlab_t *slab = mem_pool_alloc_slab_from_addr(addr, pool_alloc->slab_size);
+    MYC_ASSERT(slab->pool_alloc == pool_alloc, "Object was not allocated by this pool allocator.");
+
+    *(void**)addr = slab->free_list;
+    slab->free_list = addr;
+    if (slab->free_count == 0) {
+        mem_pool_slab_list_remove(&pool_alloc->full_slabs, slab);
+        mem_pool_slab_list_push(&pool_alloc->partial_slabs, slab);
+    }
+
+    slab->free_count += 1;
+    if (slab->free_count == pool_alloc->object_count) {
+        mem_pool_slab_list_remove(&pool_alloc->partial_slabs, slab);
+        if (pool_alloc->empty_slab == NULL) {
+            slab->free_list = NULL;
+            slab->carve_offset = pool_alloc->first_object_offset;
+            pool_alloc->empty_slab = slab;
+        } else {
+            myc_mem_arena_free(slab);
+        }
+    }
+}
+
+/* Returns the (aligned) size of the objects handed out by the pool. */
+uint32_t myc_mem_pool_alloc_get_object_size(const MycMemPoolAlloc_t *pool_alloc)
+{
+    return pool_alloc->object_size;
+}
+
+static myc_err_t mem_pool_alloc_add_slab(MycMemPoolAlloc_t *pool_alloc)
+{
+    MycMemPoolAllocSlab_t *slab = pool_alloc->empty_slab;
+    if (slab != NULL) {
+        pool_alloc->empty_slab = NULL;
+    } else {
+        const uint32_t slab_user_size = pool_alloc->slab_size - sizeof(MycMemChunk_t);
+        slab = mem_arena_malloc_aligned_chunk(pool_alloc->arena, slab_user_size, pool_alloc->slab_size);
+        if (slab == MYC_MEM_ALLOC_FAILED) {
+            MYC_LOG_TRACE("Cannot allocate enough memory.");
+            return MYC_ERR_NO_MEMORY;
+        }
+        slab->pool_alloc = pool_alloc;
+        slab->free_list = NULL;
+        slab->carve_offset = pool_alloc->first_object_offset;
+    }
+    slab->free_count = pool_alloc->object_count;
+    mem_pool_slab_list_push(&pool_alloc->partial_slabs, slab);
+    return MYC_SUCCESS;
+}
+
+static void mem_pool_slab_list_push(MycMemPoolAllocSlab_t **list, MycMemPoolAllocSlab_t *slab)
+{
+    slab->prev = NULL;
+    slab->next = *list;
+    if (slab->next != NULL) {
+        slab->next->prev = slab;
+    }
+    *list = slab;
+}
+
+static void mem_pool_slab_list_remove(MycMemPoolAllocSlab_t **list, MycMemPoolAllocSlab_t *slab)
+{
+    if (slab->prev != NULL) {
+        slab->prev->next = slab->next;
+    } else {
+        *list = slab->next;
+    }
+    if (slab->next != NULL) {
+        slab->next->prev = slab->prev;
+    }
+}
+
+static void mem_pool_slab_list_free(MycMemPoolAllocSlab_t *list)
+{
+    while (list != NULL) {
+        MycMemPoolAllocSlab_t *next_slab = list->next;
+        myc_mem_arena_free(list);
+        list = next_slab;
     }
 }
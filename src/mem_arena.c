@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "myc/core.h"
@@ -10,9 +11,9 @@
 
 
 /* Libc mmap wrapper. */
-static inline void* mem_mmap(size_t size) 
+static inline void* mem_mmap(size_t size, int prot, int extra_flags) 
 {
-    void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    void *mem = mmap(NULL, size, prot, MAP_PRIVATE | MAP_ANONYMOUS | extra_flags, -1, 0);
     MYC_ASSERT(!(mem == MAP_FAILED && errno == EINVAL), "Invalid mmap parameters.");
     return mem;
 }
@@ -26,48 +27,168 @@ static inline int mem_munmap(void *mem, size_t size)
     return err;
 }
 
+/* Maps 'size' bytes aligned to 'alignment', by mapping 'alignment' bytes more and trimming both ends. */
+static void* mem_mmap_aligned(size_t size, size_t alignment, int prot, int extra_flags)
+{
+    void *mem = mem_mmap(size + alignment, prot, extra_flags);
+    if (mem == MAP_FAILED) {
+        return mem;
+    }
+    void *aligned_mem = (void*)MYC_QUANTIZE_UP((size_t)mem, alignment);
+    if (aligned_mem > mem) {
+        mem_munmap(mem, (size_t)(aligned_mem - mem));
+    }
+    if (aligned_mem + size < mem + size + alignment) {
+        mem_munmap(aligned_mem + size, (size_t)((mem + size + alignment) - (aligned_mem + size)));
+    }
+    return aligned_mem;
+}
+
+/* Advises transparent huge pages and faults the pages in, as far as requested by the arena 'flags'. */
+static void mem_arena_advise(void *mem, size_t size, myc_mem_arena_flags_t flags)
+{
+    if ((flags & MYC_MEM_ARENA_FLAG_HUGE_PAGES) && madvise(mem, size, MADV_HUGEPAGE) != 0) {
+        MYC_LOG_TRACE("'madvise' failed, transparent huge pages are not available.   =>   %s.", strerror(errno));
+    }
+    if (flags & MYC_MEM_ARENA_FLAG_PREFAULT) {
+        /* MAP_POPULATE would have faulted the pages in before the advice, i.e. as small pages. */
+        const size_t SYSTEM_PAGE_SIZE = (size_t)sysconf(_SC_PAGE_SIZE);
+        for (size_t offset = 0; offset < size; offset += SYSTEM_PAGE_SIZE) {
+            *(volatile char*)(mem + offset) = 0;
+        }
+    }
+}
+
+/* Maps the memory of a region of 'reserve_size' bytes, as requested by the arena 'flags'. Only the first 'size' bytes 
+are committed, the rest is address space without access, which is committed later on by 'mem_arena_commit'.
+!!NOTE: If huge pages are requested, both sizes must be multiples of the huge page size. */
+static void* mem_arena_map(size_t size, size_t reserve_size, myc_mem_arena_flags_t flags)
+{
+    const int populate_flag = (flags & MYC_MEM_ARENA_FLAG_PREFAULT) ? MAP_POPULATE : 0;
+    if (reserve_size > size) {
+        /* Reserved address space neither counts towards the commit charge nor is it backed by any memory. */
+        void *mem = (flags & MYC_MEM_ARENA_FLAG_HUGE_PAGES) 
+            ? mem_mmap_aligned(reserve_size, MYC_MEM_ARENA_HUGE_PAGE_SIZE, PROT_NONE, MAP_NORESERVE) 
+            : mem_mmap(reserve_size, PROT_NONE, MAP_NORESERVE);
+        if (mem == MAP_FAILED) {
+            return mem;
+        }
+        if (mprotect(mem, size, PROT_READ | PROT_WRITE) != 0) {
+            const int mprotect_errno = errno;
+            mem_munmap(mem, reserve_size);
+            errno = mprotect_errno;
+            return MAP_FAILED;
+        }
+        mem_arena_advise(mem, size, flags);
+        return mem;
+    }
+
+    if (flags & MYC_MEM_ARENA_FLAG_HUGETLB) {
+        /* Not using the wrapper, since the kernel reports an empty or missing huge page pool in different ways. */
+        void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | populate_flag, -1, 0);
+        if (mem != MAP_FAILED) {
+            return mem;
+        }
+        MYC_LOG_TRACE("'mmap' with MAP_HUGETLB failed, falling back to transparent huge pages.   =>   %s.", strerror(errno));
+    } else if (!(flags & MYC_MEM_ARENA_FLAG_HUGE_PAGES)) {
+        return mem_mmap(size, PROT_READ | PROT_WRITE, populate_flag);
+    }
+
+    /* Transparent huge pages only back huge page aligned memory. */
+    void *mem = mem_mmap_aligned(size, MYC_MEM_ARENA_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, 0);
+    if (mem == MAP_FAILED) {
+        return mem;
+    }
+    mem_arena_advise(mem, size, flags | MYC_MEM_ARENA_FLAG_HUGE_PAGES);
+    return mem;
+}
+
 
 
 // === CREATE / DESTROY ============================================================================================ //
 
-static myc_err_t mem_arena_create_internal(MycMemArena_t **new_arena, uint32_t size);
+static myc_err_t mem_arena_create_internal(MycMemArena_t **new_arena, size_t size, size_t reserve_size, myc_mem_arena_flags_t flags);
 static void mem_arena_reset_layout(MycMemArena_t *arena);
 
 /* Creates a new memory arena with a capacity of at least 'size' bytes. */
-myc_err_t myc_mem_arena_create(MycMemArena_t **new_arena, uint32_t size)
+myc_err_t myc_mem_arena_create(MycMemArena_t **new_arena, myc_mem_size_t size)
+{
+    return myc_mem_arena_create_with_flags(new_arena, size, MYC_MEM_ARENA_FLAG_NONE);
+}
+
+/* Creates a new memory arena with a capacity of at least 'size' bytes and the behaviour given by 'flags'. */
+myc_err_t myc_mem_arena_create_with_flags(MycMemArena_t **new_arena, myc_mem_size_t size, myc_mem_arena_flags_t flags)
+{
+    return myc_mem_arena_create_reserved(new_arena, size, 0, flags);
+}
+
+/* Creates a new memory arena with a capacity of at least 'size' bytes, which reserves address space for at least 
+'reserve_size' bytes up front. The reserved memory is committed on demand, growing the arena in place. */
+myc_err_t myc_mem_arena_create_reserved(MycMemArena_t **new_arena, myc_mem_size_t size, myc_mem_size_t reserve_size, myc_mem_arena_flags_t flags)
 {
     myc_err_t exit_code;
     MycMemArena_t *arena;
-    if ((exit_code = mem_arena_create_internal(&arena, size)) != MYC_SUCCESS) {
+    if ((exit_code = mem_arena_create_internal(&arena, size, reserve_size, flags)) != MYC_SUCCESS) {
         return exit_code;
     }
     arena->head = arena;
+    arena->region_reserve_size = (reserve_size > size) ? reserve_size : 0;
+    if ((exit_code = mem_region_index_create(arena)) != MYC_SUCCESS) {
+        pthread_mutex_destroy(&arena->lock);
+        mem_munmap(arena, arena->reserve_size);
+        return exit_code;
+    }
+    mem_small_init(arena);
     *new_arena = arena;
     return MYC_SUCCESS;
 }
 
 /* Expands the memory arena by creating a new arena of at least 'add_size' bytes, which is added as a child.
+Arenas with reserved address space grow an existing region in place instead, as long as there is enough of it left.
 !!NOTE: The newly created memory region need not be contiguous to existing memory region(s). */
-myc_err_t myc_mem_arena_expand(MycMemArena_t *arena, uint32_t add_size)
+myc_err_t myc_mem_arena_expand(MycMemArena_t *arena, myc_mem_size_t add_size)
 {
     myc_err_t exit_code;
     MycMemArena_t *add_arena;
-    if ((exit_code = mem_arena_create_internal(&add_arena, add_size)) != MYC_SUCCESS) {
+    if (mem_arena_commit_any(&add_arena, arena, add_size) == MYC_SUCCESS) {
+        return MYC_SUCCESS;
+    }
+    if ((exit_code = mem_arena_create_internal(&add_arena, add_size, arena->region_reserve_size, arena->flags)) != MYC_SUCCESS) {
         return exit_code;
     }
     add_arena->head = arena;
+    if ((exit_code = mem_region_index_insert(add_arena)) != MYC_SUCCESS) {
+        pthread_mutex_destroy(&add_arena->lock);
+        mem_munmap(add_arena, add_arena->reserve_size);
+        return exit_code;
+    }
+
+    /* Other threads may be walking the region list without holding any lock, 
+    so the new region must be fully initialized before it is published. */
+    mem_arena_lock(arena);
     add_arena->next = arena->next;
-    arena->next = add_arena;
+    __atomic_store_n(&arena->next, add_arena, __ATOMIC_RELEASE);
+    mem_arena_unlock(arena);
     return MYC_SUCCESS;
 }
 
 /* Destroys the memory arena and releases the resources back to the OS. */
 void myc_mem_arena_destroy(MycMemArena_t *arena)
 {
+    if (mem_arena_is_traced(arena)) {
+        myc_mem_arena_trace_stop(arena);
+    }
+    if (mem_arena_is_thread_safe(arena)) {
+        mem_thread_cache_detach_all(arena);
+    }
+    mem_region_index_destroy(arena);
+    mem_small_destroy(arena);
+
     myc_err_t exit_code = MYC_SUCCESS;
     while (arena != NULL) {
         MycMemArena_t *next_arena = arena->next;
-        if (mem_munmap(arena, arena->size) != 0) {
+        pthread_mutex_destroy(&arena->lock);
+        if (mem_munmap(arena, arena->reserve_size) != 0) {
             MYC_LOG_TRACE("'munmap' failed at %p.   =>   %s.", arena, strerror(errno));
             exit_code = MYC_FAILED;
         }
@@ -84,97 +205,518 @@ void myc_mem_arena_destroy(MycMemArena_t *arena)
 /* Resets the memory arena by freeing all currently allocated memory chunks. This does not release resources to the OS. */
 void myc_mem_arena_reset(MycMemArena_t *arena)
 {
+    if (mem_arena_is_thread_safe(arena)) {
+        mem_thread_cache_reset_all(arena);
+    }
+    mem_small_reset(arena);
     for (MycMemArena_t *arena_i = arena; arena_i != NULL; arena_i = arena_i->next) {
         mem_arena_reset_layout(arena_i);
+        mem_region_index_update(arena_i);
     }
+    __atomic_fetch_add(&arena->head->counters[MYC_MEM_COUNTER_LAYOUT_RESET], 1, __ATOMIC_RELAXED);
+}
+
+/* The layout tree directly follows the region header, aligned for the layout kernels. */
+static inline size_t calc_mem_arena_layout_offset(void)
+{
+    return MYC_QUANTIZE_UP(sizeof(MycMemArena_t), MYC_MEM_LAYOUT_NODE_GROUP_ALIGNMENT);
 }
 
-static inline size_t calc_mem_arena_allocation_size(uint32_t requested_size)
+static inline size_t calc_mem_arena_internal_size(size_t page_count)
 {
     typedef uint32_t MycMemLayoutNode_t;
-    const size_t SYSTEM_PAGE_SIZE = (size_t)sysconf(_SC_PAGE_SIZE);
-    MYC_ASSERT(MYC_IS_POWER_OFF_TWO(SYSTEM_PAGE_SIZE), "Broken system page size.");
+    const size_t layout_size = (calc_mem_layout_node_count(page_count) + page_count) * sizeof(MycMemLayoutNode_t) 
+                             + calc_mem_layout_bitmap_word_count(page_count) * sizeof(uint64_t);
+    return MYC_QUANTIZE_UP(calc_mem_arena_layout_offset() + layout_size, MYC_MEM_ARENA_PAGE_SIZE);
+}
 
-    const size_t user_size = MYC_QUANTIZE_UP((size_t)requested_size, MYC_MEM_ARENA_PAGE_SIZE);
-    const size_t page_count = user_size / MYC_MEM_ARENA_PAGE_SIZE;
-    const size_t max_bucket_node_count = page_count / 2 + 1;
-    const size_t max_free_size_node_count = calc_free_size_node_count(max_bucket_node_count);
-    const size_t max_layout_size = ((max_bucket_node_count + 1) * sizeof(MycMemLayoutNode_t)) + (max_free_size_node_count * sizeof(MycMemLayoutNode_t));
-    const size_t total_size = sizeof(MycMemArena_t) + max_layout_size + user_size;
-    const size_t allocation_size = MYC_QUANTIZE_UP(total_size, SYSTEM_PAGE_SIZE);
-    return allocation_size;
+static inline bool mem_arena_uses_huge_pages(myc_mem_arena_flags_t flags)
+{
+    return (flags & (MYC_MEM_ARENA_FLAG_HUGE_PAGES | MYC_MEM_ARENA_FLAG_HUGETLB)) != 0;
 }
 
-static inline size_t calc_mem_arena_page_count(size_t allocation_size)
+/* Returns the granularity regions are mapped with, which is the huge page size if huge pages are requested. */
+static inline size_t calc_mem_arena_map_granularity(myc_mem_arena_flags_t flags)
 {
-    /* The steps below try to kind of visualize the page count calculation, but to be honest the maths is kind of a mess.
-    In essence it is the formula for calculating the allocation size above and solving for page count (with some simplification), which boils down to:
-    #pages = [total_size - sizeof(Arena_t) - 4*sizeof(LayoutNode_t) - (sizeof(LayoutNode_t) / (#NODE_CHILD - 1))]  
-           / [ARENA_PAGE_SIZE + sizeof(LayoutNode_t) + (sizeof(LayoutNode_t) / 2(#NODE_CHILD - 1))]. */
+    const size_t SYSTEM_PAGE_SIZE = (size_t)sysconf(_SC_PAGE_SIZE);
+    MYC_ASSERT(MYC_IS_POWER_OFF_TWO(SYSTEM_PAGE_SIZE), "Broken system page size.");
+    return mem_arena_uses_huge_pages(flags) ? MYC_MAX(SYSTEM_PAGE_SIZE, (size_t)MYC_MEM_ARENA_HUGE_PAGE_SIZE) : SYSTEM_PAGE_SIZE;
+}
 
-    typedef uint32_t MycMemLayoutNode_t;
-    const size_t DIV_ERR_SCALAR = 2 * (MYC_MEM_LAYOUT_NODE_CHILD_COUNT - 1);    // Scalar used to avoid integer division rounding errors.
-    const size_t static_memory_cost = ((sizeof(MycMemArena_t) + (4 * sizeof(MycMemLayoutNode_t))) * DIV_ERR_SCALAR) + (2 * sizeof(MycMemLayoutNode_t));
-    const size_t memory_budget = (allocation_size * DIV_ERR_SCALAR) - static_memory_cost;
-    const size_t memory_cost = ((MYC_MEM_ARENA_PAGE_SIZE + sizeof(MycMemLayoutNode_t)) * DIV_ERR_SCALAR) + sizeof(MycMemLayoutNode_t);
-    const size_t page_count = memory_budget / memory_cost;
-    return page_count;
+static inline size_t calc_mem_arena_allocation_size(size_t requested_size, myc_mem_arena_flags_t flags)
+{
+    const size_t MAP_GRANULARITY = calc_mem_arena_map_granularity(flags);
+
+    /* The layout covers every page of the region (including its own), so its size depends on the allocation size.
+    Start from a lower bound (a leaf and a bucket end per page) and add whole (huge) pages until the user size fits. */
+    const size_t user_size = MYC_QUANTIZE_UP(requested_size, MYC_MEM_ARENA_PAGE_SIZE);
+    const size_t min_layout_size = (user_size / MYC_MEM_ARENA_PAGE_SIZE) * 2 * sizeof(uint32_t);
+    size_t allocation_size = MYC_QUANTIZE_UP(calc_mem_arena_layout_offset() + min_layout_size + user_size, MAP_GRANULARITY);
+    while (allocation_size - calc_mem_arena_internal_size(allocation_size / MYC_MEM_ARENA_PAGE_SIZE) < user_size) {
+        allocation_size += MAP_GRANULARITY;
+    }
+    return allocation_size;
 }
 
-static myc_err_t mem_arena_create_internal(MycMemArena_t **new_arena, uint32_t size)
+static myc_err_t mem_arena_create_internal(MycMemArena_t **new_arena, size_t size, size_t reserve_size, myc_mem_arena_flags_t flags)
 {
-    const size_t allocation_size = calc_mem_arena_allocation_size(size);
-    const size_t page_count = calc_mem_arena_page_count(allocation_size);
-    const size_t user_size = page_count * MYC_MEM_ARENA_PAGE_SIZE;
-    const size_t max_bucket_count = page_count / 2 + 1;
+    const bool is_reserved = reserve_size > size;
+    if (is_reserved && (flags & MYC_MEM_ARENA_FLAG_HUGETLB)) {
+        MYC_LOG_TRACE("Huge TLB pages can not be reserved without being committed.");
+        return MYC_ERR_INVALID_ARGUMENT;
+    }
 
-    if (allocation_size > MYC_MEM_ARENA_SIZE_MAX) {
-        MYC_LOG_TRACE("Allocation size (%lu) exceeds maximum arena size (%lu)", allocation_size, MYC_MEM_ARENA_SIZE_MAX);
+    /* The layout is sized for the whole reservation, so it never has to move when the region grows. */
+    const size_t reserve_allocation_size = calc_mem_arena_allocation_size(MYC_MAX(size, reserve_size), flags);
+    const size_t page_capacity = reserve_allocation_size / MYC_MEM_ARENA_PAGE_SIZE;
+    const size_t internal_size = calc_mem_arena_internal_size(page_capacity);
+    const size_t allocation_size = is_reserved 
+        ? MYC_MIN(MYC_QUANTIZE_UP(internal_size + MYC_QUANTIZE_UP(size, MYC_MEM_ARENA_PAGE_SIZE), calc_mem_arena_map_granularity(flags)), reserve_allocation_size)
+        : reserve_allocation_size;
+
+    if (reserve_allocation_size > MYC_MEM_ARENA_SIZE_MAX) {
+        MYC_LOG_TRACE("Allocation size (%lu) exceeds maximum arena size (%lu)", reserve_allocation_size, MYC_MEM_ARENA_SIZE_MAX);
         return MYC_ERR_INVALID_ARGUMENT;
     }
 
-    MycMemArena_t *arena = mem_mmap(allocation_size);
+    MycMemArena_t *arena = mem_arena_map(allocation_size, reserve_allocation_size, flags);
     if (arena == MAP_FAILED) {
         MYC_LOG_TRACE("'mmap' failed.   =>   %s.", strerror(errno));
         return MYC_ERR_NO_MEMORY;
     }
 
     arena->size = allocation_size;
-    arena->internal_size = allocation_size - user_size;
+    arena->reserve_size = reserve_allocation_size;
+    arena->internal_size = internal_size;
     arena->head = NULL;
     arena->next = NULL;
-    arena->layout.bucket_offsets = (void*)arena + sizeof(MycMemArena_t);
-    arena->layout.max_free_sizes = arena->layout.bucket_offsets + max_bucket_count + 1;     // Add extra bucket as end marker.
-    mem_arena_reset_layout(arena);
+    arena->flags = flags;
+    arena->thread_caches = NULL;
+    arena->region_index = NULL;
+    arena->region_idx = 0;
+    arena->purge_decay_ms = 0;
+    arena->trace = NULL;
+    arena->dirty_free_count = 0;
+    arena->dirty_since_ms = 0;
+    arena->region_reserve_size = 0;
+    memset(arena->counters, 0, sizeof(arena->counters));
+    pthread_mutex_init(&arena->lock, NULL);
+    mem_layout_init(&arena->layout, (void*)arena + calc_mem_arena_layout_offset(), page_capacity, 
+                    allocation_size / MYC_MEM_ARENA_PAGE_SIZE, arena->internal_size);
     *new_arena = arena;
     return MYC_SUCCESS;
 }
 
 static void mem_arena_reset_layout(MycMemArena_t *arena)
 {
-    arena->layout.bucket_node_count = 1;
-    arena->layout.parent_node_count = calc_parent_node_count(1);
-    arena->layout.bucket_offsets[0] = 0;
-    arena->layout.bucket_offsets[1] = arena->size;
-    arena->layout.max_free_sizes[0] = arena->size - arena->internal_size;
+    mem_layout_reset(&arena->layout, arena->internal_size);
+    mem_arena_note_free(arena);
+}
+
+
+
+// === COMMIT ====================================================================================================== //
+
+/* Commits more of the reserved address space of the region, so the free tail of its last bucket grows by at least 
+'add_size' bytes. The committed size at least doubles, to keep the number of commits logarithmic. */
+myc_err_t mem_arena_commit(MycMemArena_t *region, size_t add_size)
+{
+    if (add_size > region->reserve_size - region->size) {
+        return MYC_FAILED;
+    }
+    const size_t min_size = MYC_QUANTIZE_UP(region->size + add_size, calc_mem_arena_map_granularity(region->flags));
+    const size_t new_size = MYC_MIN(MYC_MAX(min_size, 2 * region->size), region->reserve_size);
+    void *const commit_start = (void*)region + region->size;
+    if (mprotect(commit_start, new_size - region->size, PROT_READ | PROT_WRITE) != 0) {
+        MYC_LOG_TRACE("'mprotect' failed at %p.   =>   %s.", commit_start, strerror(errno));
+        return MYC_ERR_NO_MEMORY;
+    }
+    mem_arena_advise(commit_start, new_size - region->size, region->flags);
+
+    mem_layout_grow(&region->layout, new_size / MYC_MEM_ARENA_PAGE_SIZE);
+    __atomic_store_n(&region->size, new_size, __ATOMIC_RELAXED);
+    mem_region_index_update(region);
+    __atomic_fetch_add(&region->head->counters[MYC_MEM_COUNTER_LAYOUT_GROW], 1, __ATOMIC_RELAXED);
+    return MYC_SUCCESS;
+}
+
+/* Commits 'add_size' bytes in the first region of the arena which has enough reserved address space left, 
+and returns that region. */
+myc_err_t mem_arena_commit_any(MycMemArena_t **committed_region, MycMemArena_t *arena, size_t add_size)
+{
+    if (arena->head->region_reserve_size == 0) {
+        return MYC_FAILED;      // No region of the arena reserves any address space.
+    }
+    for (MycMemArena_t *arena_i = arena->head; arena_i != NULL; arena_i = __atomic_load_n(&arena_i->next, __ATOMIC_ACQUIRE)) {
+        if (add_size > arena_i->reserve_size - __atomic_load_n(&arena_i->size, __ATOMIC_RELAXED)) {
+            continue;
+        }
+        mem_arena_lock(arena_i);
+        const myc_err_t exit_code = mem_arena_commit(arena_i, add_size);
+        mem_arena_unlock(arena_i);
+        if (exit_code == MYC_SUCCESS) {
+            *committed_region = arena_i;
+            return MYC_SUCCESS;
+        }
+    }
+    return MYC_FAILED;
+}
+
+
+
+// === PURGE ======================================================================================================= //
+
+static inline uint64_t mem_arena_clock_ms(void);
+static inline size_t calc_mem_arena_purge_granularity(const MycMemArena_t *region);
+static void mem_arena_purge_subtree(MycMemArena_t *region, size_t level, size_t node_idx, size_t granularity);
+
+/* Gives the free memory of the arena back to the OS, i.e. the page aligned interior of every free bucket tail. 
+The memory stays mapped and reads as zero once it is reused. */
+void myc_mem_arena_purge(MycMemArena_t *arena)
+{
+    for (MycMemArena_t *arena_i = arena; arena_i != NULL; arena_i = __atomic_load_n(&arena_i->next, __ATOMIC_ACQUIRE)) {
+        mem_arena_lock(arena_i);
+        mem_arena_purge_region(arena_i);
+        mem_arena_unlock(arena_i);
+    }
+}
+
+/* Makes the arena purge a region by itself, once memory freed in it has been waiting for 'decay_ms' milliseconds 
+without a purge. Zero disables decay, which is the default. */
+void myc_mem_arena_set_purge_decay(MycMemArena_t *arena, uint32_t decay_ms)
+{
+    __atomic_store_n(&arena->head->purge_decay_ms, decay_ms, __ATOMIC_RELAXED);
+}
+
+/* Marks the region dirty after memory was freed in it, and purges it if it has been dirty for longer than the decay 
+time of its arena. */
+void mem_arena_note_free(MycMemArena_t *region)
+{
+    if (region->dirty_since_ms == 0) {
+        region->dirty_since_ms = mem_arena_clock_ms();
+        region->dirty_free_count = 0;
+        return;
+    }
+
+    const uint32_t decay_ms = __atomic_load_n(&region->head->purge_decay_ms, __ATOMIC_RELAXED);
+    region->dirty_free_count += 1;
+    if (decay_ms == 0 || region->dirty_free_count % MYC_MEM_ARENA_DECAY_CHECK_INTERVAL != 0) {
+        return;
+    }
+    if (mem_arena_clock_ms() - region->dirty_since_ms >= decay_ms) {
+        mem_arena_purge_region(region);
+    }
+}
+
+/* Returns the page aligned interior of all free bucket tails of the region to the OS. */
+void mem_arena_purge_region(MycMemArena_t *region)
+{
+    if (region->dirty_since_ms == 0) {
+        return;     // Nothing was freed since the last purge.
+    }
+    const size_t granularity = calc_mem_arena_purge_granularity(region);
+    if (region->layout.max_free_sizes[0] >= mem_layout_encode_free_size(granularity)) {
+        mem_arena_purge_subtree(region, 0, 0, granularity);
+    }
+    region->dirty_since_ms = 0;
+}
+
+static inline uint64_t mem_arena_clock_ms(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    const uint64_t now_ms = (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+    return MYC_MAX(now_ms, 1);     // Zero means clean.
+}
+
+static inline size_t calc_mem_arena_purge_granularity(const MycMemArena_t *region)
+{
+    /* Huge TLB pages can only be released as a whole. */
+    return (region->flags & MYC_MEM_ARENA_FLAG_HUGETLB) ? MYC_MEM_ARENA_HUGE_PAGE_SIZE : (size_t)sysconf(_SC_PAGE_SIZE);
+}
+
+/* Visits the buckets below the node whose free tails may contain a whole page, skipping all other subtrees. */
+static void mem_arena_purge_subtree(MycMemArena_t *region, size_t level, size_t node_idx, size_t granularity)
+{
+    const MycMemLayout_t *layout = &region->layout;
+    if (level == layout->level_count - 1) {
+        const size_t bucket_idx = node_idx;
+        void *const free_start = (void*)region + mem_layout_bucket_free_offset(layout, bucket_idx);
+        void *const free_end = (void*)region + mem_layout_bucket_end(layout, bucket_idx);
+        void *const purge_start = (void*)MYC_QUANTIZE_UP((size_t)free_start, granularity);
+        void *const purge_end = (void*)((size_t)free_end & ~(granularity - 1));
+        if (purge_start < purge_end && madvise(purge_start, (size_t)(purge_end - purge_start), MADV_DONTNEED) != 0) {
+            MYC_LOG_TRACE("'madvise' failed at %p.   =>   %s.", purge_start, strerror(errno));
+        }
+        return;
+    }
+
+    const uint32_t *children = &layout->levels[level + 1][node_idx * MYC_MEM_LAYOUT_NODE_CHILD_COUNT];
+    const uint32_t min_free_size = mem_layout_encode_free_size(granularity);
+    for (size_t child_idx = 0; child_idx < MYC_MEM_LAYOUT_NODE_CHILD_COUNT; ++child_idx) {
+        if (children[child_idx] >= min_free_size) {
+            mem_arena_purge_subtree(region, level + 1, (node_idx * MYC_MEM_LAYOUT_NODE_CHILD_COUNT) + child_idx, granularity);
+        }
+    }
+}
+
+
+
+// === REGION INDEX ================================================================================================ //
+
+static myc_err_t mem_region_index_map(MycMemRegionIndex_t **new_index, size_t capacity);
+static void mem_region_index_set_leaf(MycMemRegionIndex_t *index, size_t region_idx, uint32_t max_free_size);
+
+static inline void mem_region_index_lock(MycMemArena_t *arena) {
+    if (mem_arena_is_thread_safe(arena)) pthread_mutex_lock(&arena->region_index_lock);
+}
+
+static inline void mem_region_index_unlock(MycMemArena_t *arena) {
+    if (mem_arena_is_thread_safe(arena)) pthread_mutex_unlock(&arena->region_index_lock);
+}
+
+static inline uint32_t* mem_region_index_leaves(const MycMemRegionIndex_t *index) {
+    return index->levels[index->level_count - 1];
+}
+
+/* Creates the region index of the head region 'arena', containing only the head region itself. */
+myc_err_t mem_region_index_create(MycMemArena_t *arena)
+{
+    myc_err_t exit_code;
+    if ((exit_code = mem_region_index_map(&arena->region_index, MYC_MEM_LAYOUT_NODE_CHILD_COUNT)) != MYC_SUCCESS) {
+        return exit_code;
+    }
+    pthread_mutex_init(&arena->region_index_lock, NULL);
+    return mem_region_index_insert(arena);
+}
+
+/* Unmaps the region index of the head region 'arena', including all replaced copies. */
+void mem_region_index_destroy(MycMemArena_t *arena)
+{
+    MycMemRegionIndex_t *index = arena->region_index;
+    while (index != NULL) {
+        MycMemRegionIndex_t *retired_index = index->retired;
+        mem_munmap(index, index->size);
+        index = retired_index;
+    }
+    arena->region_index = NULL;
+    pthread_mutex_destroy(&arena->region_index_lock);
+}
+
+/* Adds the (not yet published) region to the index of its head region. */
+myc_err_t mem_region_index_insert(MycMemArena_t *region)
+{
+    MycMemArena_t *arena = region->head;
+    mem_region_index_lock(arena);
+    MycMemRegionIndex_t *index = arena->region_index;
+    if (index->region_count == index->capacity) {
+        MycMemRegionIndex_t *new_index;
+        if (mem_region_index_map(&new_index, index->capacity * MYC_MEM_LAYOUT_NODE_CHILD_COUNT) != MYC_SUCCESS) {
+            mem_region_index_unlock(arena);
+            return MYC_ERR_NO_MEMORY;
+        }
+        for (size_t region_idx = 0; region_idx < index->region_count; ++region_idx) {
+            new_index->regions[region_idx] = index->regions[region_idx];
+            mem_region_index_set_leaf(new_index, region_idx, mem_region_index_leaves(index)[region_idx]);
+        }
+        new_index->region_count = index->region_count;
+        new_index->retired = index;
+        __atomic_store_n(&arena->region_index, new_index, __ATOMIC_RELEASE);
+        index = new_index;
+    }
+
+    region->region_idx = index->region_count;
+    index->region_count += 1;
+    __atomic_store_n(&index->regions[region->region_idx], region, __ATOMIC_RELEASE);
+    mem_region_index_set_leaf(index, region->region_idx, region->layout.max_free_sizes[0]);
+    mem_region_index_unlock(arena);
+    return MYC_SUCCESS;
+}
+
+/* Updates the leaf of the region after its root free size changed. Cheap if nothing changed. 
+!!NOTE: For thread safe arenas, the region lock must be held. */
+void mem_region_index_update(MycMemArena_t *region)
+{
+    MycMemArena_t *arena = region->head;
+    const uint32_t max_free_size = region->layout.max_free_sizes[0];
+    const MycMemRegionIndex_t *index = __atomic_load_n(&arena->region_index, __ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&mem_region_index_leaves(index)[region->region_idx], __ATOMIC_RELAXED) == max_free_size) {
+        return;
+    }
+
+    mem_region_index_lock(arena);
+    mem_region_index_set_leaf(arena->region_index, region->region_idx, max_free_size);
+    mem_region_index_unlock(arena);
+}
+
+/* Returns the region of the arena whose root free size best fits 'size', or NULL if no region is large enough. */
+MycMemArena_t* mem_region_index_find(const MycMemArena_t *arena, size_t size)
+{
+    const uint32_t search_size = mem_layout_encode_free_size(size);
+    /* Thread safe arenas search the index without holding any lock, so a descent may hit a node whose children were 
+    lowered in the meantime, in which case it simply starts over. The caller checks the region again once locked. */
+    for (;;) {
+        const MycMemRegionIndex_t *index = __atomic_load_n(&arena->head->region_index, __ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&index->levels[0][0], __ATOMIC_RELAXED) < search_size) {
+            return NULL;
+        }
+
+        size_t node_idx = 0;
+        for (size_t level = 1; level < index->level_count && node_idx != SIZE_MAX; ++level) {
+            const uint32_t *children = &index->levels[level][node_idx * MYC_MEM_LAYOUT_NODE_CHILD_COUNT];
+            const size_t child_idx = mem_layout_kernels.find_min_suitable_child(children, search_size);
+            node_idx = (child_idx < MYC_MEM_LAYOUT_NODE_CHILD_COUNT) ? (node_idx * MYC_MEM_LAYOUT_NODE_CHILD_COUNT) + child_idx : SIZE_MAX;
+        }
+        MycMemArena_t *region = (node_idx != SIZE_MAX) ? __atomic_load_n(&index->regions[node_idx], __ATOMIC_ACQUIRE) : NULL;
+        if (region != NULL) {
+            return region;
+        }
+    }
+}
+
+static myc_err_t mem_region_index_map(MycMemRegionIndex_t **new_index, size_t capacity)
+{
+    const size_t SYSTEM_PAGE_SIZE = (size_t)sysconf(_SC_PAGE_SIZE);
+    const size_t header_size = MYC_QUANTIZE_UP(sizeof(MycMemRegionIndex_t), MYC_MEM_LAYOUT_NODE_GROUP_ALIGNMENT);
+    const size_t node_count = calc_mem_layout_node_count(capacity);
+    const size_t size = MYC_QUANTIZE_UP(header_size + (node_count * sizeof(uint32_t)) + (capacity * sizeof(MycMemArena_t*)), SYSTEM_PAGE_SIZE);
+
+    MycMemRegionIndex_t *index = mem_mmap(size, PROT_READ | PROT_WRITE, 0);
+    if (index == MAP_FAILED) {
+        MYC_LOG_TRACE("'mmap' failed.   =>   %s.", strerror(errno));
+        return MYC_ERR_NO_MEMORY;
+    }
+
+    /* Same shape as the layout tree, see 'mem_layout_init'. The capacity is a power of the child count. */
+    size_t level_count = 1;
+    for (size_t level_node_count = capacity; level_node_count > 1; level_node_count /= MYC_MEM_LAYOUT_NODE_CHILD_COUNT) {
+        level_count += 1;
+    }
+    MYC_ASSERT(level_count <= MYC_MEM_LAYOUT_LEVEL_COUNT_MAX, "Too many regions for the region index.");
+
+    uint32_t *nodes = (void*)index + header_size;
+    size_t level_node_count = 1;
+    for (size_t level = 0; level < level_count; ++level) {
+        index->levels[level] = nodes;
+        nodes += calc_mem_layout_level_size(level_node_count);
+        level_node_count *= MYC_MEM_LAYOUT_NODE_CHILD_COUNT;
+    }
+    index->size = size;
+    index->capacity = capacity;
+    index->region_count = 0;
+    index->level_count = level_count;
+    index->regions = (void*)nodes;
+    index->retired = NULL;
+    *new_index = index;
+    return MYC_SUCCESS;
+}
+
+/* Sets the leaf of the region and updates its ancestors, stopping as soon as one of them is unchanged. 
+Nodes are stored atomically, because thread safe arenas search the index without holding any lock. */
+static void mem_region_index_set_leaf(MycMemRegionIndex_t *index, size_t region_idx, uint32_t max_free_size)
+{
+    size_t level = index->level_count - 1;
+    size_t node_idx = region_idx;
+    __atomic_store_n(&index->levels[level][node_idx], max_free_size, __ATOMIC_RELAXED);
+    while (level > 0) {
+        const uint32_t *children = &index->levels[level][node_idx & ~(size_t)(MYC_MEM_LAYOUT_NODE_CHILD_COUNT - 1)];
+        const uint32_t max_child_free_size = mem_layout_kernels.max_child(children);
+        level -= 1;
+        node_idx /= MYC_MEM_LAYOUT_NODE_CHILD_COUNT;
+        if (index->levels[level][node_idx] == max_child_free_size) {
+            break;
+        }
+        __atomic_store_n(&index->levels[level][node_idx], max_child_free_size, __ATOMIC_RELAXED);
+    }
 }
 
 
 
 // === INTROSPECTION =============================================================================================== //
 
+static inline size_t calc_mem_region_resident_size(const MycMemArena_t *region);
 static inline void mem_arena_print_global_info(const MycMemArena_t *arena);
 static inline void mem_arena_print_local_info(const MycMemArena_t *arena);
 static inline void mem_arena_print_chunks_info(const MycMemArena_t *arena);
 
 /* Returns the actual user size of the memory chunk at 'addr'. */
-uint32_t myc_mem_arena_get_chunk_size(void *addr) 
+myc_mem_size_t myc_mem_arena_get_chunk_size(void *addr) 
 {
+    if (mem_small_is_object(addr) && mem_aligned_is_object(addr)) {
+        return (myc_mem_size_t)(mem_chunk_size(mem_aligned_chunk_from_addr(addr)) - mem_aligned_get_object_offset(addr));
+    }
+    if (mem_small_is_object(addr)) {
+        return mem_small_get_object_size(addr);
+    }
     MycMemChunk_t *chunk = mem_chunk_from_addr(addr);
-    uint32_t user_size = chunk->size - sizeof(MycMemChunk_t);
+    myc_mem_size_t user_size = (myc_mem_size_t)(mem_chunk_size(chunk) - sizeof(MycMemChunk_t));
     return user_size;
 }
 
+/* Returns the number of bytes mapped by all regions of the arena. */
+size_t myc_mem_arena_get_mapped_size(const MycMemArena_t *arena)
+{
+    size_t mapped_size = 0;
+    for (const MycMemArena_t *arena_i = arena; arena_i != NULL; arena_i = __atomic_load_n(&arena_i->next, __ATOMIC_ACQUIRE)) {
+        mapped_size += arena_i->size;
+    }
+    return mapped_size;
+}
+
+/* Returns the number of bytes of the arena which are currently resident in physical memory. */
+size_t myc_mem_arena_get_resident_size(const MycMemArena_t *arena)
+{
+    size_t resident_size = 0;
+    for (const MycMemArena_t *arena_i = arena; arena_i != NULL; arena_i = __atomic_load_n(&arena_i->next, __ATOMIC_ACQUIRE)) {
+        resident_size += calc_mem_region_resident_size(arena_i);
+    }
+    return resident_size;
+}
+
+/* Fills 'stats' from counters the arena maintains as it goes, without walking its chunks. */
+void myc_mem_arena_get_stats(MycMemArena_t *arena, MycMemArenaStats_t *stats)
+{
+    memset(stats, 0, sizeof(MycMemArenaStats_t));
+    arena = arena->head;
+
+    uint64_t counters[MYC_MEM_COUNTER_COUNT];
+    for (size_t counter = 0; counter < MYC_MEM_COUNTER_COUNT; ++counter) {
+        counters[counter] = __atomic_load_n(&arena->counters[counter], __ATOMIC_RELAXED);
+    }
+    if (mem_arena_is_thread_safe(arena)) {
+        /* Only attaching/detaching a thread cache takes the head region lock, the counting itself never does. */
+        mem_arena_lock(arena);
+        for (const MycMemThreadCache_t *cache = arena->thread_caches; cache != NULL; cache = cache->next) {
+            for (size_t counter = 0; counter < MYC_MEM_COUNTER_COUNT; ++counter) {
+                counters[counter] += __atomic_load_n(&cache->counters[counter], __ATOMIC_RELAXED);
+            }
+        }
+        mem_arena_unlock(arena);
+    }
+    stats->malloc_count = counters[MYC_MEM_COUNTER_MALLOC];
+    stats->free_count = counters[MYC_MEM_COUNTER_FREE];
+    stats->realloc_in_place_count = counters[MYC_MEM_COUNTER_REALLOC_IN_PLACE];
+    stats->realloc_move_count = counters[MYC_MEM_COUNTER_REALLOC_MOVE];
+    stats->layout_reset_count = counters[MYC_MEM_COUNTER_LAYOUT_RESET];
+    stats->layout_grow_count = counters[MYC_MEM_COUNTER_LAYOUT_GROW];
+
+    for (const MycMemArena_t *arena_i = arena; arena_i != NULL; arena_i = __atomic_load_n(&arena_i->next, __ATOMIC_ACQUIRE)) {
+        const size_t size = __atomic_load_n(&arena_i->size, __ATOMIC_RELAXED);
+        const size_t free_size = __atomic_load_n(&arena_i->layout.free_size, __ATOMIC_RELAXED);
+        const size_t largest_free_size = mem_layout_decode_free_size(__atomic_load_n(&arena_i->layout.max_free_sizes[0], __ATOMIC_RELAXED));
+        stats->used_size += size - arena_i->internal_size - MYC_MIN(free_size, size - arena_i->internal_size);
+        stats->free_size += free_size;
+        stats->largest_free_size = MYC_MAX(stats->largest_free_size, largest_free_size);
+        stats->mapped_size += size;
+        stats->reserved_size += arena_i->reserve_size;
+        stats->internal_size += arena_i->internal_size;
+        stats->region_count += 1;
+        stats->bucket_count += __atomic_load_n(&arena_i->layout.bucket_count, __ATOMIC_RELAXED);
+        stats->layout_depth = MYC_MAX(stats->layout_depth, arena_i->layout.level_count);
+    }
+    stats->fragmentation = (stats->free_size > stats->largest_free_size) ? 1.0 - (double)stats->largest_free_size / (double)stats->free_size : 0.0;
+}
+
 /* Prints memory usage/layout information to stdout. */
 void myc_mem_arena_introspect(const MycMemArena_t *arena)
 {
@@ -188,35 +730,60 @@ void myc_mem_arena_introspect(const MycMemArena_t *arena)
     }
 }
 
+static inline size_t calc_mem_region_resident_size(const MycMemArena_t *region)
+{
+    const size_t SYSTEM_PAGE_SIZE = (size_t)sysconf(_SC_PAGE_SIZE);
+    unsigned char residency[1024];
+    size_t resident_page_count = 0;
+    for (size_t offset = 0; offset < region->size; offset += sizeof(residency) * SYSTEM_PAGE_SIZE) {
+        const size_t size = MYC_MIN(region->size - offset, sizeof(residency) * SYSTEM_PAGE_SIZE);
+        if (mincore((void*)region + offset, size, residency) != 0) {
+            MYC_LOG_TRACE("'mincore' failed at %p.   =>   %s.", (void*)region + offset, strerror(errno));
+            continue;
+        }
+        for (size_t page_idx = 0; page_idx < MYC_DIV_ROUND_UP(size, SYSTEM_PAGE_SIZE); ++page_idx) {
+            resident_page_count += residency[page_idx] & 0x01;
+        }
+    }
+    return resident_page_count * SYSTEM_PAGE_SIZE;
+}
+
 static inline void mem_arena_print_global_info(const MycMemArena_t *arena)
 {
     size_t region_count = 0;
     size_t total_size = 0;
     size_t user_size = 0;
+    size_t resident_size = 0;
     for (const MycMemArena_t *arena_i = arena; arena_i != NULL; arena_i = arena_i->next) {
         region_count += 1;
         total_size += arena_i->size;
         user_size += arena_i->size - arena_i->internal_size;
+        resident_size += calc_mem_region_resident_size(arena_i);
     }
 
     printf("  |   Memory Arena:   < region count: "MYC_FMT_BOLD("%lu"), region_count);
     printf(" | user size: "MYC_FMT_BOLD("%.2f KiB"), (float)user_size / 1024.0f);
-    printf(" total size: "MYC_FMT_BOLD("%.2f KiB")" >\n", (float)total_size / 1024.0f);
+    printf(" total size: "MYC_FMT_BOLD("%.2f KiB"), (float)total_size / 1024.0f);
+    printf(" resident size: "MYC_FMT_BOLD("%.2f KiB")" >\n", (float)resident_size / 1024.0f);
 }
 
 static inline void mem_arena_print_local_info(const MycMemArena_t *arena)
 {
     const size_t user_size = arena->size - arena->internal_size;
     size_t size_used = 0;
-    for (size_t bucket_idx = 0; bucket_idx < arena->layout.bucket_node_count; ++bucket_idx) {
+    for (size_t bucket_idx = 0; bucket_idx < arena->layout.page_count; bucket_idx = mem_layout_page_idx(mem_layout_bucket_end(&arena->layout, bucket_idx))) {
         size_used += mem_layout_bucket_size_used(&arena->layout, bucket_idx);
     }
     size_used -= arena->internal_size;
 
     printf("  |       - Region at "MYC_FMT_BOLD("0x%012lx")":", (size_t)arena);
     printf("   < capacity: "MYC_FMT_BOLD("%.2f KiB"), (float)user_size / 1024.0f);
-    printf(" | size used: "MYC_FMT_BOLD("%.2f KiB")" ("MYC_FMT_BOLD("%.1f%%")") >\n", 
+    printf(" | size used: "MYC_FMT_BOLD("%.2f KiB")" ("MYC_FMT_BOLD("%.1f%%")")", 
             (float)size_used / 1024.0f, 100.0f * (float)size_used / (float)user_size);
+    if (arena->reserve_size > arena->size) {
+        printf(" | reserved: "MYC_FMT_BOLD("%.2f KiB"), (float)(arena->reserve_size - arena->size) / 1024.0f);
+    }
+    printf(" >\n");
 }
 
 static inline void mem_arena_print_chunks_info(const MycMemArena_t *arena)
@@ -226,20 +793,20 @@ static inline void mem_arena_print_chunks_info(const MycMemArena_t *arena)
     snprintf(buffer, sizeof(buffer), "     < state: INTERNAL | size: "MYC_FMT_BOLD("%lu bytes")" >", arena->internal_size);
     printf("%-56s", buffer);
 
-    uint32_t chunk_offset = (uint32_t)arena->internal_size;
-    for (size_t bucket_idx = 0; bucket_idx < arena->layout.bucket_node_count; ++bucket_idx) {
+    size_t chunk_offset = arena->internal_size;
+    for (size_t bucket_idx = 0; bucket_idx < arena->layout.page_count; bucket_idx = arena->layout.bucket_end_pages[bucket_idx]) {
         while (chunk_offset < mem_layout_bucket_free_offset(&arena->layout, bucket_idx)) {    
             MycMemChunk_t *chunk = mem_chunk_at(arena, chunk_offset);
-            MYC_ASSERT(chunk->size > 0, "Chunk size is never 0");
-            printf("\n  |            - Chunk at "MYC_FMT_BOLD("0x%08x")":", chunk->offset);
-            snprintf(buffer, sizeof(buffer), "     < state: ALLOCATED | size: "MYC_FMT_BOLD("%u bytes")" >", chunk->size);
+            MYC_ASSERT(chunk->page_count > 0, "Chunk size is never 0");
+            printf("\n  |            - Chunk at "MYC_FMT_BOLD("0x%08lx")":", mem_chunk_offset(chunk));
+            snprintf(buffer, sizeof(buffer), "     < state: ALLOCATED | size: "MYC_FMT_BOLD("%lu bytes")" >", mem_chunk_size(chunk));
             printf("%-56s", buffer);
-            chunk_offset += chunk->size;
+            chunk_offset += mem_chunk_size(chunk);
         }
-        uint32_t free_size = mem_layout_bucket_free_size(&arena->layout, bucket_idx);
+        size_t free_size = mem_layout_bucket_free_size(&arena->layout, bucket_idx);
         if (free_size > 0) {
-            printf("\n  |            - Chunk at "MYC_FMT_BOLD("0x%08x")":", chunk_offset);
-            snprintf(buffer, sizeof(buffer), "     < state: FREE | size: "MYC_FMT_BOLD("%u bytes")" >", free_size);
+            printf("\n  |            - Chunk at "MYC_FMT_BOLD("0x%08lx")":", chunk_offset);
+            snprintf(buffer, sizeof(buffer), "     < state: FREE | size: "MYC_FMT_BOLD("%lu bytes")" >", free_size);
             printf("%-56s", buffer);
         }
         printf("   (BUCKET END)");
@@ -0,0 +1,142 @@
+#include "myc/core.h"
+#include "./_memory_.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MYC_MEM_LAYOUT_KERNELS_X86
+#endif
+
+_Static_assert(MYC_MEM_LAYOUT_NODE_CHILD_COUNT == 8, "The layout kernels assume eight children per node.");
+
+static size_t mem_layout_find_min_suitable_child_scalar(const uint32_t *children, uint32_t size);
+static uint32_t mem_layout_max_child_scalar(const uint32_t *children);
+
+/* Starts out with the scalar kernels, so the layout works even before (or without) the CPU being inspected. */
+MycMemLayoutKernels_t mem_layout_kernels = {
+    .find_min_suitable_child = mem_layout_find_min_suitable_child_scalar,
+    .max_child = mem_layout_max_child_scalar,
+};
+
+
+
+// === SCALAR ====================================================================================================== //
+
+static size_t mem_layout_find_min_suitable_child_scalar(const uint32_t *children, uint32_t size)
+{
+    size_t min_child_idx = MYC_MEM_LAYOUT_NODE_CHILD_COUNT;
+    uint32_t min_suitable_free_size = UINT32_MAX;
+    for (size_t child_idx = 0; child_idx < MYC_MEM_LAYOUT_NODE_CHILD_COUNT; ++child_idx) {
+        const uint32_t free_size = children[child_idx];
+        if (free_size >= size && free_size < min_suitable_free_size) {
+            min_suitable_free_size = free_size;
+            min_child_idx = child_idx;
+        }
+    }
+    return min_child_idx;
+}
+
+static uint32_t mem_layout_max_child_scalar(const uint32_t *children)
+{
+    uint32_t max_free_size = 0;
+    for (size_t child_idx = 0; child_idx < MYC_MEM_LAYOUT_NODE_CHILD_COUNT; ++child_idx) {
+        max_free_size = MYC_MAX(children[child_idx], max_free_size);
+    }
+    return max_free_size;
+}
+
+
+
+#ifdef MYC_MEM_LAYOUT_KERNELS_X86
+// === SSE4.1 ====================================================================================================== //
+
+/* Reduces the four lanes to their minimum/maximum, broadcast to all lanes. */
+__attribute__((target("sse4.1")))
+static inline __m128i mem_layout_hmin_epu32_sse41(__m128i values)
+{
+    values = _mm_min_epu32(values, _mm_shuffle_epi32(values, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_min_epu32(values, _mm_shuffle_epi32(values, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i mem_layout_hmax_epu32_sse41(__m128i values)
+{
+    values = _mm_max_epu32(values, _mm_shuffle_epi32(values, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_max_epu32(values, _mm_shuffle_epi32(values, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+/* Children which are too small are replaced by UINT32_MAX, so the minimum over all lanes is the best fit.
+There is no unsigned compare, so 'x >= size' is computed as 'max(x, size) == x'. */
+__attribute__((target("sse4.1")))
+static size_t mem_layout_find_min_suitable_child_sse41(const uint32_t *children, uint32_t size)
+{
+    const __m128i sizes = _mm_set1_epi32((int)size);
+    const __m128i lo = _mm_load_si128((const __m128i*)children);
+    const __m128i hi = _mm_load_si128((const __m128i*)children + 1);
+    const __m128i lo_fits = _mm_cmpeq_epi32(_mm_max_epu32(lo, sizes), lo);
+    const __m128i hi_fits = _mm_cmpeq_epi32(_mm_max_epu32(hi, sizes), hi);
+    const __m128i lo_candidates = _mm_or_si128(lo, _mm_andnot_si128(lo_fits, _mm_set1_epi32(-1)));
+    const __m128i hi_candidates = _mm_or_si128(hi, _mm_andnot_si128(hi_fits, _mm_set1_epi32(-1)));
+
+    const __m128i min_free_size = mem_layout_hmin_epu32_sse41(_mm_min_epu32(lo_candidates, hi_candidates));
+    const __m128i lo_matches = _mm_and_si128(_mm_cmpeq_epi32(lo_candidates, min_free_size), lo_fits);
+    const __m128i hi_matches = _mm_and_si128(_mm_cmpeq_epi32(hi_candidates, min_free_size), hi_fits);
+    const int match_mask = _mm_movemask_ps(_mm_castsi128_ps(lo_matches)) | (_mm_movemask_ps(_mm_castsi128_ps(hi_matches)) << 4);
+    return (size_t)__builtin_ctz((unsigned)match_mask | (1u << MYC_MEM_LAYOUT_NODE_CHILD_COUNT));
+}
+
+__attribute__((target("sse4.1")))
+static uint32_t mem_layout_max_child_sse41(const uint32_t *children)
+{
+    const __m128i lo = _mm_load_si128((const __m128i*)children);
+    const __m128i hi = _mm_load_si128((const __m128i*)children + 1);
+    return (uint32_t)_mm_cvtsi128_si32(mem_layout_hmax_epu32_sse41(_mm_max_epu32(lo, hi)));
+}
+
+
+
+// === AVX2 ======================================================================================================== //
+
+/* Same as the SSE4.1 kernel, with all eight children in a single register. */
+__attribute__((target("avx2")))
+static size_t mem_layout_find_min_suitable_child_avx2(const uint32_t *children, uint32_t size)
+{
+    const __m256i sizes = _mm256_set1_epi32((int)size);
+    const __m256i values = _mm256_load_si256((const __m256i*)children);
+    const __m256i fits = _mm256_cmpeq_epi32(_mm256_max_epu32(values, sizes), values);
+    const __m256i candidates = _mm256_or_si256(values, _mm256_andnot_si256(fits, _mm256_set1_epi32(-1)));
+
+    __m256i min_free_size = _mm256_min_epu32(candidates, _mm256_permute2x128_si256(candidates, candidates, 0x01));
+    min_free_size = _mm256_min_epu32(min_free_size, _mm256_shuffle_epi32(min_free_size, _MM_SHUFFLE(1, 0, 3, 2)));
+    min_free_size = _mm256_min_epu32(min_free_size, _mm256_shuffle_epi32(min_free_size, _MM_SHUFFLE(2, 3, 0, 1)));
+    const __m256i matches = _mm256_and_si256(_mm256_cmpeq_epi32(candidates, min_free_size), fits);
+    const int match_mask = _mm256_movemask_ps(_mm256_castsi256_ps(matches));
+    return (size_t)__builtin_ctz((unsigned)match_mask | (1u << MYC_MEM_LAYOUT_NODE_CHILD_COUNT));
+}
+
+__attribute__((target("avx2")))
+static uint32_t mem_layout_max_child_avx2(const uint32_t *children)
+{
+    const __m256i values = _mm256_load_si256((const __m256i*)children);
+    __m256i max_free_size = _mm256_max_epu32(values, _mm256_permute2x128_si256(values, values, 0x01));
+    max_free_size = _mm256_max_epu32(max_free_size, _mm256_shuffle_epi32(max_free_size, _MM_SHUFFLE(1, 0, 3, 2)));
+    max_free_size = _mm256_max_epu32(max_free_size, _mm256_shuffle_epi32(max_free_size, _MM_SHUFFLE(2, 3, 0, 1)));
+    return (uint32_t)_mm256_cvtsi256_si32(max_free_size);
+}
+
+
+
+// === DISPATCH ==================================================================================================== //
+
+__attribute__((constructor))
+static void mem_layout_kernels_init(void)
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        mem_layout_kernels.find_min_suitable_child = mem_layout_find_min_suitable_child_avx2;
+        mem_layout_kernels.max_child = mem_layout_max_child_avx2;
+    } else if (__builtin_cpu_supports("sse4.1")) {
+        mem_layout_kernels.find_min_suitable_child = mem_layout_find_min_suitable_child_sse41;
+        mem_layout_kernels.max_child = mem_layout_max_child_sse41;
+    }
+}
+#endif // MYC_MEM_LAYOUT_KERNELS_X86
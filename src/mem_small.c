@@ -0,0 +1,252 @@
+#include <pthread.h>
+#include <string.h>
+
+#include "myc/core.h"
+#include "./_memory_.h"
+
+/* Classes are 16 bytes apart up to 64 bytes and 32 bytes apart above, which bounds the internal waste to 1/3
+(for 65 bytes) while keeping the number of partially filled runs per arena low. */
+static const uint32_t small_class_object_sizes[MYC_MEM_SMALL_CLASS_COUNT] = { 16, 32, 48, 64, 96, 128, 160, 192, 224, 256 };
+static const uint8_t small_class_idx_by_granule[MYC_MEM_SMALL_SIZE_MAX / MYC_MEM_SMALL_OBJECT_ALIGNMENT + 1] = {
+    0, 0, 1, 2, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9,
+};
+
+static void* mem_small_malloc_from_class(MycMemArena_t *arena, size_t class_idx);
+static void* mem_small_class_pop(MycMemArena_t *arena, MycMemSmallClass_t *small_class);
+static myc_err_t mem_small_class_add_run(MycMemArena_t *arena, MycMemSmallClass_t *small_class);
+static void mem_small_run_list_push(MycMemSmallRun_t **list, MycMemSmallRun_t *run);
+static void mem_small_run_list_remove(MycMemSmallRun_t **list, MycMemSmallRun_t *run);
+
+/* The first object of a run is aligned to the largest power of two dividing the object size, so every object of the 
+class is aligned to it. For the given sizes this costs no object per run compared to packing them right behind the 
+run header. */
+static inline uint32_t calc_mem_small_first_object_offset(uint32_t object_size) {
+    const uint32_t alignment = MYC_MIN(object_size & -object_size, MYC_MEM_ARENA_PAGE_SIZE);
+    return MYC_QUANTIZE_UP(sizeof(MycMemChunk_t) + sizeof(MycMemSmallRun_t), MYC_MAX(alignment, MYC_MEM_SMALL_OBJECT_ALIGNMENT));
+}
+
+static inline void mem_small_class_lock(const MycMemArena_t *arena, MycMemSmallClass_t *small_class) {
+    if (mem_arena_is_thread_safe(arena)) pthread_mutex_lock(&small_class->lock);
+}
+
+static inline void mem_small_class_unlock(const MycMemArena_t *arena, MycMemSmallClass_t *small_class) {
+    if (mem_arena_is_thread_safe(arena)) pthread_mutex_unlock(&small_class->lock);
+}
+
+/* Sets up the small object classes of the head region 'arena'. */
+void mem_small_init(MycMemArena_t *arena)
+{
+    for (size_t class_idx = 0; class_idx < MYC_MEM_SMALL_CLASS_COUNT; ++class_idx) {
+        MycMemSmallClass_t *small_class = &arena->small_classes[class_idx];
+        small_class->object_size = small_class_object_sizes[class_idx];
+        small_class->first_object_offset = calc_mem_small_first_object_offset(small_class->object_size);
+        small_class->object_count = (MYC_MEM_SMALL_RUN_SIZE - small_class->first_object_offset) / small_class->object_size;
+        small_class->partial_runs = NULL;
+        small_class->empty_run = NULL;
+        pthread_mutex_init(&small_class->lock, NULL);
+    }
+}
+
+/* Forgets all small object runs of the arena, without freeing them. Used when the arena is reset. */
+void mem_small_reset(MycMemArena_t *arena)
+{
+    for (size_t class_idx = 0; class_idx < MYC_MEM_SMALL_CLASS_COUNT; ++class_idx) {
+        arena->small_classes[class_idx].partial_runs = NULL;
+        arena->small_classes[class_idx].empty_run = NULL;
+    }
+}
+
+/* Releases the resources held by the small object classes. Used right before the arena is destroyed. */
+void mem_small_destroy(MycMemArena_t *arena)
+{
+    for (size_t class_idx = 0; class_idx < MYC_MEM_SMALL_CLASS_COUNT; ++class_idx) {
+        pthread_mutex_destroy(&arena->small_classes[class_idx].lock);
+    }
+}
+
+/* Allocates a small object of at least 'size' (at most MYC_MEM_SMALL_SIZE_MAX) bytes. */
+void* mem_small_malloc(MycMemArena_t *arena, uint32_t size)
+{
+    MYC_ASSERT(size > 0 && size <= MYC_MEM_SMALL_SIZE_MAX, "Size is not served by the small object classes.");
+    return mem_small_malloc_from_class(arena, small_class_idx_by_granule[MYC_DIV_ROUND_UP(size, MYC_MEM_SMALL_OBJECT_ALIGNMENT)]);
+}
+
+/* Allocates a small object of at least 'size' (at most MYC_MEM_SMALL_SIZE_MAX) bytes, aligned to 'alignment' (a power 
+of two up to MYC_MEM_SMALL_SIZE_MAX). It comes from the smallest class whose object size is a multiple of the alignment. */
+void* mem_small_aligned_malloc(MycMemArena_t *arena, uint32_t size, size_t alignment)
+{
+    MYC_ASSERT(size > 0 && size <= MYC_MEM_SMALL_SIZE_MAX, "Size is not served by the small object classes.");
+    MYC_ASSERT(MYC_IS_POWER_OFF_TWO(alignment) && alignment <= MYC_MEM_SMALL_SIZE_MAX, "Alignment is not served by the small object classes.");
+    size_t class_idx = small_class_idx_by_granule[MYC_DIV_ROUND_UP(size, MYC_MEM_SMALL_OBJECT_ALIGNMENT)];
+    while (small_class_object_sizes[class_idx] % alignment != 0) {
+        class_idx += 1;
+    }
+    return mem_small_malloc_from_class(arena, class_idx);
+}
+
+/* Frees the small object at 'addr'. Runs that become fully empty are given back to the arena. Thread safe arenas keep 
+the object in the calling thread's magazine of the class, whose older half is flushed to the runs when full. */
+void mem_small_free(void *addr)
+{
+    MycMemSmallRun_t *run = mem_small_run_from_addr(addr);
+    MycMemSmallClass_t *small_class = run->small_class;
+    MycMemArena_t *arena = mem_chunk_get_arena(mem_chunk_from_addr(run))->head;
+
+    MycMemThreadCache_t *cache = mem_arena_is_thread_safe(arena) ? mem_thread_cache_get(arena) : NULL;
+    if (cache == NULL) {
+        mem_small_free_objects(arena, small_class, &addr, 1);
+        return;
+    }
+
+    MycMemSmallMagazine_t *magazine = &cache->small_magazines[small_class - arena->small_classes];
+    if (magazine->object_count == MYC_MEM_THREAD_CACHE_SMALL_MAGAZINE_SIZE) {
+        const uint32_t release_count = MYC_MEM_THREAD_CACHE_SMALL_MAGAZINE_SIZE / 2;
+        mem_small_free_objects(arena, small_class, magazine->objects, release_count);
+        memmove(magazine->objects, magazine->objects + release_count, (magazine->object_count - release_count) * sizeof(void*));
+        magazine->object_count -= release_count;
+    }
+    magazine->objects[magazine->object_count] = addr;
+    magazine->object_count += 1;
+}
+
+/* Frees 'count' small objects of the class at once, bypassing the thread caches. */
+void mem_small_free_objects(const MycMemArena_t *arena, MycMemSmallClass_t *small_class, void *const *objects, uint32_t count)
+{
+    if (count == 0) {
+        return;
+    }
+    /* Runs which become empty are unlinked from the class, so they are collected through their own list links and 
+    only given back to the arena once the class lock is dropped. */
+    MycMemSmallRun_t *released_runs = NULL;
+    mem_small_class_lock(arena, small_class);
+    for (uint32_t i = 0; i < count; ++i) {
+        MycMemSmallRun_t *run = mem_small_run_from_addr(objects[i]);
+        *(void**)objects[i] = run->free_list;
+        run->free_list = objects[i];
+        if (run->free_count == 0) {
+            mem_small_run_list_push(&small_class->partial_runs, run);
+        }
+
+        run->free_count += 1;
+        if (run->free_count == small_class->object_count) {
+            mem_small_run_list_remove(&small_class->partial_runs, run);
+            if (small_class->empty_run == NULL) {
+                run->free_list = NULL;
+                run->carve_offset = small_class->first_object_offset;
+                small_class->empty_run = run;
+            } else {
+                run->next = released_runs;
+                released_runs = run;
+            }
+        }
+    }
+    mem_small_class_unlock(arena, small_class);
+
+    while (released_runs != NULL) {
+        MycMemSmallRun_t *run = released_runs;
+        released_runs = run->next;
+        mem_chunk_release(mem_chunk_from_addr(run));
+    }
+}
+
+/* Thread safe arenas serve the object from the calling thread's magazine of the class, which is refilled by half under 
+a single class lock when empty. */
+static void* mem_small_malloc_from_class(MycMemArena_t *arena, size_t class_idx)
+{
+    arena = arena->head;
+    MycMemSmallClass_t *small_class = &arena->small_classes[class_idx];
+
+    MycMemThreadCache_t *cache = mem_arena_is_thread_safe(arena) ? mem_thread_cache_get(arena) : NULL;
+    if (cache == NULL) {
+        mem_small_class_lock(arena, small_class);
+        void *addr = mem_small_class_pop(arena, small_class);
+        mem_small_class_unlock(arena, small_class);
+        return addr;
+    }
+
+    MycMemSmallMagazine_t *magazine = &cache->small_magazines[class_idx];
+    if (magazine->object_count == 0) {
+        mem_small_class_lock(arena, small_class);
+        while (magazine->object_count < MYC_MEM_THREAD_CACHE_SMALL_MAGAZINE_SIZE / 2) {
+            void *addr = mem_small_class_pop(arena, small_class);
+            if (addr == MYC_MEM_ALLOC_FAILED) {
+                break;
+            }
+            magazine->objects[magazine->object_count] = addr;
+            magazine->object_count += 1;
+        }
+        mem_small_class_unlock(arena, small_class);
+        if (magazine->object_count == 0) {
+            return MYC_MEM_ALLOC_FAILED;
+        }
+    }
+    magazine->object_count -= 1;
+    return magazine->objects[magazine->object_count];
+}
+
+/* Takes one object out of the partial runs of the class, adding a run if there is none. 
+!!NOTE: For thread safe arenas, the class lock must be held. */
+static void* mem_small_class_pop(MycMemArena_t *arena, MycMemSmallClass_t *small_class)
+{
+    if (small_class->partial_runs == NULL && mem_small_class_add_run(arena, small_class) != MYC_SUCCESS) {
+        return MYC_MEM_ALLOC_FAILED;
+    }
+
+    MycMemSmallRun_t *run = small_class->partial_runs;
+    void *addr;
+    if (run->free_list != NULL) {
+        addr = run->free_list;
+        run->free_list = *(void**)addr;
+    } else {
+        addr = (void*)mem_chunk_from_addr(run) + run->carve_offset;
+        run->carve_offset += small_class->object_size;
+    }
+
+    run->free_count -= 1;
+    if (run->free_count == 0) {
+        mem_small_run_list_remove(&small_class->partial_runs, run);
+    }
+    return addr;
+}
+
+static myc_err_t mem_small_class_add_run(MycMemArena_t *arena, MycMemSmallClass_t *small_class)
+{
+    MycMemSmallRun_t *run = small_class->empty_run;
+    if (run != NULL) {
+        small_class->empty_run = NULL;
+    } else {
+        run = mem_arena_malloc_aligned_chunk(arena, MYC_MEM_SMALL_RUN_SIZE - sizeof(MycMemChunk_t), MYC_MEM_SMALL_RUN_SIZE);
+        if (run == MYC_MEM_ALLOC_FAILED) {
+            MYC_LOG_TRACE("Cannot allocate enough memory.");
+            return MYC_ERR_NO_MEMORY;
+        }
+        run->small_class = small_class;
+        run->free_list = NULL;
+        run->carve_offset = small_class->first_object_offset;
+    }
+    run->free_count = small_class->object_count;
+    mem_small_run_list_push(&small_class->partial_runs, run);
+    return MYC_SUCCESS;
+}
+
+static void mem_small_run_list_push(MycMemSmallRun_t **list, MycMemSmallRun_t *run)
+{
+    run->prev = NULL;
+    run->next = *list;
+    if (run->next != NULL) {
+        run->next->prev = run;
+    }
+    *list = run;
+}
+
+static void mem_small_run_list_remove(MycMemSmallRun_t **list, MycMemSmallRun_t *run)
+{
+    if (run->prev != NULL) {
+        run->prev->next = run->next;
+    } else {
+        *list = run->next;
+    }
+    if (run->next != NULL) {
+        run->next->prev = run->prev;
+    }
+}
@@ -0,0 +1,138 @@
+#include <pthread.h>
+#include <string.h>
+
+#include "myc/core.h"
+#include "./_memory_.h"
+
+/* Every thread has a fixed number of cache slots, each bound to at most one arena at a time. The caches of an arena
+are linked into a list owned by its head region (protected by the head region lock), so the arena can invalidate
+them on reset/destroy, while the owning thread hands its cached chunks and small objects back when it exits. */
+static __thread MycMemThreadCache_t thread_caches[MYC_MEM_THREAD_CACHE_SLOT_COUNT];
+static __thread size_t thread_cache_evict_idx;
+
+static pthread_key_t thread_cache_key;
+static pthread_once_t thread_cache_key_once = PTHREAD_ONCE_INIT;
+
+static void mem_thread_cache_attach(MycMemThreadCache_t *cache, MycMemArena_t *arena);
+static void mem_thread_cache_detach(MycMemThreadCache_t *cache);
+static void mem_thread_cache_on_thread_exit(void *caches);
+static void mem_thread_cache_create_key(void);
+
+/* Returns the calling thread's cache for the arena with head region 'arena', or NULL if no cache slot is available. */
+MycMemThreadCache_t* mem_thread_cache_get(MycMemArena_t *arena)
+{
+    MycMemThreadCache_t *free_cache = NULL;
+    for (size_t slot_idx = 0; slot_idx < MYC_MEM_THREAD_CACHE_SLOT_COUNT; ++slot_idx) {
+        MycMemThreadCache_t *cache = &thread_caches[slot_idx];
+        if (cache->arena == arena) {
+            return cache;
+        }
+        if (cache->arena == NULL && free_cache == NULL) {
+            free_cache = cache;
+        }
+    }
+
+    if (free_cache == NULL) {
+        free_cache = &thread_caches[thread_cache_evict_idx];
+        thread_cache_evict_idx = (thread_cache_evict_idx + 1) % MYC_MEM_THREAD_CACHE_SLOT_COUNT;
+        mem_thread_cache_detach(free_cache);
+    }
+    if (pthread_once(&thread_cache_key_once, mem_thread_cache_create_key) != 0) {
+        return NULL;
+    }
+    pthread_setspecific(thread_cache_key, thread_caches);   // Any non-NULL value makes the exit handler run.
+    mem_thread_cache_attach(free_cache, arena);
+    return free_cache;
+}
+
+/* Forgets all chunks cached by any thread for the arena, without freeing them. */
+void mem_thread_cache_reset_all(MycMemArena_t *arena)
+{
+    mem_arena_lock(arena);
+    for (MycMemThreadCache_t *cache = arena->thread_caches; cache != NULL; cache = cache->next) {
+        for (size_t class_idx = 0; class_idx < MYC_MEM_THREAD_CACHE_CLASS_COUNT; ++class_idx) {
+            cache->magazines[class_idx].chunk_count = 0;
+        }
+        for (size_t class_idx = 0; class_idx < MYC_MEM_SMALL_CLASS_COUNT; ++class_idx) {
+            cache->small_magazines[class_idx].object_count = 0;
+        }
+    }
+    mem_arena_unlock(arena);
+}
+
+/* Detaches all thread caches from the arena. Used right before the arena is destroyed. */
+void mem_thread_cache_detach_all(MycMemArena_t *arena)
+{
+    mem_arena_lock(arena);
+    MycMemThreadCache_t *cache = arena->thread_caches;
+    while (cache != NULL) {
+        MycMemThreadCache_t *next_cache = cache->next;
+        memset(cache, 0, sizeof(MycMemThreadCache_t));
+        cache = next_cache;
+    }
+    arena->thread_caches = NULL;
+    mem_arena_unlock(arena);
+}
+
+static void mem_thread_cache_attach(MycMemThreadCache_t *cache, MycMemArena_t *arena)
+{
+    mem_arena_lock(arena);
+    cache->arena = arena;
+    cache->prev = NULL;
+    cache->next = arena->thread_caches;
+    if (cache->next != NULL) {
+        cache->next->prev = cache;
+    }
+    arena->thread_caches = cache;
+    mem_arena_unlock(arena);
+}
+
+static void mem_thread_cache_detach(MycMemThreadCache_t *cache)
+{
+    MycMemArena_t *arena = cache->arena;
+    if (arena == NULL) {
+        return;
+    }
+
+    mem_arena_lock(arena);
+    if (cache->prev != NULL) {
+        cache->prev->next = cache->next;
+    } else {
+        arena->thread_caches = cache->next;
+    }
+    if (cache->next != NULL) {
+        cache->next->prev = cache->prev;
+    }
+    for (size_t counter = 0; counter < MYC_MEM_COUNTER_COUNT; ++counter) {
+        __atomic_fetch_add(&arena->counters[counter], cache->counters[counter], __ATOMIC_RELAXED);
+    }
+    mem_arena_unlock(arena);
+
+    /* Releasing takes the class and region locks, so it must happen after the head region lock is dropped. */
+    for (size_t class_idx = 0; class_idx < MYC_MEM_SMALL_CLASS_COUNT; ++class_idx) {
+        const MycMemSmallMagazine_t *magazine = &cache->small_magazines[class_idx];
+        mem_small_free_objects(arena, &arena->small_classes[class_idx], magazine->objects, magazine->object_count);
+    }
+    for (size_t class_idx = 0; class_idx < MYC_MEM_THREAD_CACHE_CLASS_COUNT; ++class_idx) {
+        MycMemMagazine_t *magazine = &cache->magazines[class_idx];
+        for (uint32_t i = 0; i < magazine->chunk_count; ++i) {
+            mem_chunk_release(magazine->chunks[i]);
+        }
+    }
+    memset(cache, 0, sizeof(MycMemThreadCache_t));
+}
+
+static void mem_thread_cache_on_thread_exit(void *caches)
+{
+    MycMemThreadCache_t *thread_caches_i = caches;
+    for (size_t slot_idx = 0; slot_idx < MYC_MEM_THREAD_CACHE_SLOT_COUNT; ++slot_idx) {
+        mem_thread_cache_detach(&thread_caches_i[slot_idx]);
+    }
+}
+
+static void mem_thread_cache_create_key(void)
+{
+    int err = pthread_key_create(&thread_cache_key, mem_thread_cache_on_thread_exit);
+    MYC_ASSERT(err == 0, "Could not create thread cache key.");
+    MYC_UNUSED(err);
+}
@@ -0,0 +1,278 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "myc/core.h"
+#include "./_memory_.h"
+
+/* Records are collected in a buffer within the trace and written out whenever it fills up. Live allocations are
+mapped from their address to their id by an open addressing hash table with linear probing, which is grown at half
+load. Both live in anonymous mappings, like every other internal structure of the arena. */
+#define MYC_MEM_TRACE_BUFFER_RECORD_COUNT 4096
+#define MYC_MEM_TRACE_ID_MAP_CAPACITY_MIN 4096
+
+typedef struct _MycMemoryTraceIdSlot {
+    uintptr_t addr;         // Zero for empty slots.
+    uint32_t id;
+} MycMemTraceIdSlot_t;
+
+typedef struct _MycMemoryTrace {
+    int fd;
+    bool has_failed;                // Set once writing failed, recording stops from then on.
+    pthread_mutex_t lock;
+    uint64_t start_ns;
+    uint32_t next_id;
+    size_t record_count;
+    MycMemTraceRecord_t records[MYC_MEM_TRACE_BUFFER_RECORD_COUNT];
+    size_t id_map_capacity;
+    size_t id_map_count;
+    MycMemTraceIdSlot_t *id_map;
+} MycMemTrace_t;
+
+static myc_err_t mem_trace_write(MycMemTrace_t *trace, const void *data, size_t size);
+static void mem_trace_flush(MycMemTrace_t *trace);
+static myc_err_t mem_trace_id_map_resize(MycMemTrace_t *trace, size_t capacity);
+static uint32_t mem_trace_id_map_insert(MycMemTrace_t *trace, uintptr_t addr, uint32_t id);
+static uint32_t mem_trace_id_map_remove(MycMemTrace_t *trace, uintptr_t addr);
+
+static inline uint64_t mem_trace_clock_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+static inline size_t mem_trace_id_map_slot_idx(const MycMemTrace_t *trace, uintptr_t addr)
+{
+    /* Addresses are at least 16 byte aligned and mostly close to each other, so the low bits are mixed in first. */
+    const uint64_t hash = ((uint64_t)addr >> 4) * 0x9E3779B97F4A7C15ull;
+    return (size_t)(hash >> 32) & (trace->id_map_capacity - 1);
+}
+
+/* Starts recording every successful malloc/realloc/free on the arena into a binary trace file at 'path'. */
+myc_err_t myc_mem_arena_trace_start(MycMemArena_t *arena, const char *path)
+{
+    myc_err_t exit_code;
+    arena = arena->head;
+    if (arena->trace != NULL) {
+        MYC_LOG_TRACE("Arena is already traced.");
+        return MYC_ERR_INVALID_ARGUMENT;
+    }
+
+    MycMemTrace_t *trace = mmap(NULL, sizeof(MycMemTrace_t), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (trace == MAP_FAILED) {
+        MYC_LOG_TRACE("'mmap' failed.   =>   %s.", strerror(errno));
+        return MYC_ERR_NO_MEMORY;
+    }
+    trace->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (trace->fd < 0) {
+        MYC_LOG_TRACE("'open' failed for '%s'.   =>   %s.", path, strerror(errno));
+        munmap(trace, sizeof(MycMemTrace_t));
+        return MYC_FAILED;
+    }
+    if ((exit_code = mem_trace_id_map_resize(trace, MYC_MEM_TRACE_ID_MAP_CAPACITY_MIN)) != MYC_SUCCESS) {
+        close(trace->fd);
+        munmap(trace, sizeof(MycMemTrace_t));
+        return exit_code;
+    }
+
+    const MycMemTraceHeader_t header = {
+        .magic = MYC_MEM_TRACE_MAGIC,
+        .version = MYC_MEM_TRACE_VERSION,
+        .record_size = sizeof(MycMemTraceRecord_t),
+    };
+    if ((exit_code = mem_trace_write(trace, &header, sizeof(header))) != MYC_SUCCESS) {
+        close(trace->fd);
+        munmap(trace->id_map, trace->id_map_capacity * sizeof(MycMemTraceIdSlot_t));
+        munmap(trace, sizeof(MycMemTrace_t));
+        return exit_code;
+    }
+    pthread_mutex_init(&trace->lock, NULL);
+    trace->start_ns = mem_trace_clock_ns();
+    trace->next_id = 1;
+    __atomic_store_n(&arena->trace, trace, __ATOMIC_RELEASE);
+    return MYC_SUCCESS;
+}
+
+/* Stops tracing the arena, flushes and closes the trace file. */
+void myc_mem_arena_trace_stop(MycMemArena_t *arena)
+{
+    arena = arena->head;
+    MycMemTrace_t *trace = arena->trace;
+    if (trace == NULL) {
+        return;
+    }
+    __atomic_store_n(&arena->trace, NULL, __ATOMIC_RELEASE);
+
+    mem_trace_flush(trace);
+    if (close(trace->fd) != 0) {
+        MYC_LOG_TRACE("'close' failed.   =>   %s.", strerror(errno));
+        trace->has_failed = true;
+    }
+    if (trace->has_failed) {
+        MYC_LOG_WARN("Allocation trace is incomplete.");
+    }
+    pthread_mutex_destroy(&trace->lock);
+    munmap(trace->id_map, trace->id_map_capacity * sizeof(MycMemTraceIdSlot_t));
+    munmap(trace, sizeof(MycMemTrace_t));
+}
+
+/* Takes the trace lock of the traced arena of region 'arena'. */
+void mem_trace_lock(MycMemArena_t *arena)
+{
+    if (mem_arena_is_thread_safe(arena)) pthread_mutex_lock(&arena->head->trace->lock);
+}
+
+void mem_trace_unlock(MycMemArena_t *arena)
+{
+    if (mem_arena_is_thread_safe(arena)) pthread_mutex_unlock(&arena->head->trace->lock);
+}
+
+/* Records an operation of the traced arena of region 'arena'. */
+void mem_trace_record(MycMemArena_t *arena, myc_mem_trace_op_t op, void *addr, void *new_addr, size_t size)
+{
+    MycMemTrace_t *trace = arena->head->trace;
+    if (trace->has_failed) {
+        return;
+    }
+
+    uint32_t id;
+    switch (op) {
+        case MYC_MEM_TRACE_OP_MALLOC:
+            id = mem_trace_id_map_insert(trace, (uintptr_t)new_addr, trace->next_id++);
+            break;
+        case MYC_MEM_TRACE_OP_REALLOC:
+            id = mem_trace_id_map_remove(trace, (uintptr_t)addr);
+            if (id == 0) {
+                op = MYC_MEM_TRACE_OP_MALLOC;   // Allocated before tracing started.
+                id = trace->next_id++;
+            }
+            id = mem_trace_id_map_insert(trace, (uintptr_t)new_addr, id);
+            break;
+        case MYC_MEM_TRACE_OP_FREE:
+            id = mem_trace_id_map_remove(trace, (uintptr_t)addr);
+            if (id == 0) {
+                return;     // Allocated before tracing started.
+            }
+            break;
+        default:
+            MYC_ASSERT(false, "Unknown trace operation.");
+            return;
+    }
+    if (id == 0) {
+        return;     // The id map could not grow, which already failed the trace.
+    }
+
+    trace->records[trace->record_count] = (MycMemTraceRecord_t){
+        .timestamp_ns = mem_trace_clock_ns() - trace->start_ns,
+        .size = size,
+        .id = id,
+        .op = op,
+    };
+    trace->record_count += 1;
+    if (trace->record_count == MYC_MEM_TRACE_BUFFER_RECORD_COUNT) {
+        mem_trace_flush(trace);
+    }
+}
+
+static myc_err_t mem_trace_write(MycMemTrace_t *trace, const void *data, size_t size)
+{
+    const uint8_t *bytes = data;
+    while (size > 0) {
+        const ssize_t written_size = write(trace->fd, bytes, size);
+        if (written_size < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written_size <= 0) {
+            MYC_LOG_TRACE("'write' failed.   =>   %s.", strerror(errno));
+            trace->has_failed = true;
+            return MYC_FAILED;
+        }
+        bytes += written_size;
+        size -= (size_t)written_size;
+    }
+    return MYC_SUCCESS;
+}
+
+static void mem_trace_flush(MycMemTrace_t *trace)
+{
+    if (!trace->has_failed) {
+        mem_trace_write(trace, trace->records, trace->record_count * sizeof(MycMemTraceRecord_t));
+    }
+    trace->record_count = 0;
+}
+
+static myc_err_t mem_trace_id_map_resize(MycMemTrace_t *trace, size_t capacity)
+{
+    MycMemTraceIdSlot_t *id_map = mmap(NULL, capacity * sizeof(MycMemTraceIdSlot_t), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (id_map == MAP_FAILED) {
+        MYC_LOG_TRACE("'mmap' failed.   =>   %s.", strerror(errno));
+        return MYC_ERR_NO_MEMORY;
+    }
+
+    MycMemTraceIdSlot_t *old_id_map = trace->id_map;
+    const size_t old_capacity = trace->id_map_capacity;
+    trace->id_map = id_map;
+    trace->id_map_capacity = capacity;
+    for (size_t slot_idx = 0; slot_idx < old_capacity; ++slot_idx) {
+        if (old_id_map[slot_idx].addr == 0) continue;
+        size_t new_slot_idx = mem_trace_id_map_slot_idx(trace, old_id_map[slot_idx].addr);
+        while (id_map[new_slot_idx].addr != 0) {
+            new_slot_idx = (new_slot_idx + 1) & (capacity - 1);
+        }
+        id_map[new_slot_idx] = old_id_map[slot_idx];
+    }
+    if (old_id_map != NULL) {
+        munmap(old_id_map, old_capacity * sizeof(MycMemTraceIdSlot_t));
+    }
+    return MYC_SUCCESS;
+}
+
+/* Maps 'addr' to 'id' and returns it, or returns zero if the map cannot grow. */
+static uint32_t mem_trace_id_map_insert(MycMemTrace_t *trace, uintptr_t addr, uint32_t id)
+{
+    if (2 * (trace->id_map_count + 1) > trace->id_map_capacity
+     && mem_trace_id_map_resize(trace, 2 * trace->id_map_capacity) != MYC_SUCCESS) {
+        trace->has_failed = true;
+        return 0;
+    }
+    size_t slot_idx = mem_trace_id_map_slot_idx(trace, addr);
+    while (trace->id_map[slot_idx].addr != 0) {
+        slot_idx = (slot_idx + 1) & (trace->id_map_capacity - 1);
+    }
+    trace->id_map[slot_idx] = (MycMemTraceIdSlot_t){ .addr = addr, .id = id };
+    trace->id_map_count += 1;
+    return id;
+}
+
+/* Unmaps 'addr' and returns its id, or returns zero if it is not mapped. */
+static uint32_t mem_trace_id_map_remove(MycMemTrace_t *trace, uintptr_t addr)
+{
+    const size_t mask = trace->id_map_capacity - 1;
+    size_t slot_idx = mem_trace_id_map_slot_idx(trace, addr);
+    while (trace->id_map[slot_idx].addr != addr) {
+        if (trace->id_map[slot_idx].addr == 0) {
+            return 0;
+        }
+        slot_idx = (slot_idx + 1) & mask;
+    }
+    const uint32_t id = trace->id_map[slot_idx].id;
+
+    /* Shifts back the following slots of the probe sequence into the gap, so lookups never need tombstones. */
+    size_t gap_idx = slot_idx;
+    for (size_t next_idx = (gap_idx + 1) & mask; trace->id_map[next_idx].addr != 0; next_idx = (next_idx + 1) & mask) {
+        const size_t home_idx = mem_trace_id_map_slot_idx(trace, trace->id_map[next_idx].addr);
+        const bool can_move = ((next_idx - home_idx) & mask) >= ((next_idx - gap_idx) & mask);
+        if (can_move) {
+            trace->id_map[gap_idx] = trace->id_map[next_idx];
+            gap_idx = next_idx;
+        }
+    }
+    trace->id_map[gap_idx] = (MycMemTraceIdSlot_t){ 0 };
+    trace->id_map_count -= 1;
+    return id;
+}
@@ -0,0 +1,322 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "myc/log.h"
+
+#define DECODE_SPEC_SIZE 64
+
+typedef struct DecodeSite {
+    const char *label;
+    const char *func_name;
+    const char *file_path;
+    const char *message_fmt;
+    const uint8_t *arg_types;
+    int32_t line_nr;
+    uint16_t arg_count;
+} DecodeSite_t;
+
+typedef struct DecodeArgs {
+    const DecodeSite_t *site;
+    const MycLogArg_t *slots;
+    const uint8_t *string_data;
+    const uint8_t *entry_end;
+    uint16_t arg_idx;
+} DecodeArgs_t;
+
+static uint8_t* decode_read_file(const char *path, size_t *size)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "Cannot open '%s'.\n", path);
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    *size = (size_t)ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t *data = malloc(*size + 1);
+    if (data == NULL || fread(data, 1, *size, file) != *size) {
+        fprintf(stderr, "Cannot read '%s'.\n", path);
+        free(data);
+        data = NULL;
+    } else {
+        data[*size] = '\0';
+    }
+    fclose(file);
+    return data;
+}
+
+/* Returns the NUL terminated string at 'cursor' and moves past it, or NULL if it does not end before 'end'. */
+static const char* decode_next_string(const uint8_t **cursor, const uint8_t *end)
+{
+    const uint8_t *terminator = memchr(*cursor, '\0', (size_t)(end - *cursor));
+    if (terminator == NULL) {
+        return NULL;
+    }
+    const char *string = (const char*)*cursor;
+    *cursor = terminator + 1;
+    return string;
+}
+
+/* Fills 'site' from a site entry, and returns false if the entry is too short for its argument types and strings. */
+static bool decode_site(DecodeSite_t *site, const MycLogBinaryEntry_t *entry)
+{
+    const uint8_t *cursor = (const uint8_t*)(entry + 1);
+    const uint8_t *end = (const uint8_t*)entry + entry->size;
+    if ((size_t)(end - cursor) < entry->arg_count) {
+        return false;
+    }
+    DecodeSite_t new_site = {
+        .arg_types = cursor,
+        .arg_count = entry->arg_count,
+        .line_nr = entry->line_nr,
+    };
+    cursor += entry->arg_count;
+    if ((new_site.label = decode_next_string(&cursor, end)) == NULL
+            || (new_site.func_name = decode_next_string(&cursor, end)) == NULL
+            || (new_site.file_path = decode_next_string(&cursor, end)) == NULL
+            || (new_site.message_fmt = decode_next_string(&cursor, end)) == NULL) {
+        return false;
+    }
+    *site = new_site;
+    return true;
+}
+
+/* Returns the next argument as raw slot, or zero if the format asks for more arguments than the site has, or a string
+argument does not fit into the entry. */
+static bool decode_next_arg(DecodeArgs_t *args, MycLogArg_t *arg, const char **string)
+{
+    if (args->arg_idx >= args->site->arg_count) {
+        return false;
+    }
+    *arg = args->slots[args->arg_idx];
+    if (args->site->arg_types[args->arg_idx] == MYC_LOG_ARG_STRING) {
+        const uint64_t remaining_size = (uint64_t)(args->entry_end - args->string_data);
+        if (arg->u >= remaining_size || MYC_LOG_BINARY_STRING_SIZE(arg->u) > remaining_size || args->string_data[arg->u] != '\0') {
+            args->arg_idx = args->site->arg_count;      // The remaining strings cannot be located either.
+            return false;
+        }
+        *string = (const char*)args->string_data;
+        args->string_data += MYC_LOG_BINARY_STRING_SIZE(arg->u);
+    } else {
+        *string = NULL;
+    }
+    args->arg_idx += 1;
+    return true;
+}
+
+/* Prints a single conversion. Length modifiers are replaced, every integer is printed as (unsigned) long long after
+being truncated to the type the modifier names. */
+static void decode_conversion(FILE *out, char *spec, size_t spec_length, const char *length_modifier, char conversion, DecodeArgs_t *args)
+{
+    MycLogArg_t arg;
+    const char *string;
+    if (!decode_next_arg(args, &arg, &string)) {
+        fputs("<missing>", out);
+        return;
+    }
+
+    switch (conversion) {
+        case 'd': case 'i': {
+            long long value;
+            if (strcmp(length_modifier, "hh") == 0) value = (signed char)arg.i;
+            else if (strcmp(length_modifier, "h") == 0) value = (short)arg.i;
+            else if (strcmp(length_modifier, "") == 0) value = (int)arg.i;
+            else if (strcmp(length_modifier, "l") == 0) value = (long)arg.i;
+            else if (strcmp(length_modifier, "z") == 0) value = (ssize_t)arg.i;
+            else value = (long long)arg.i;
+            snprintf(spec + spec_length, DECODE_SPEC_SIZE - spec_length, "ll%c", conversion);
+            fprintf(out, spec, value);
+            break;
+        }
+        case 'u': case 'o': case 'x': case 'X': {
+            unsigned long long value;
+            if (strcmp(length_modifier, "hh") == 0) value = (unsigned char)arg.u;
+            else if (strcmp(length_modifier, "h") == 0) value = (unsigned short)arg.u;
+            else if (strcmp(length_modifier, "") == 0) value = (unsigned int)arg.u;
+            else if (strcmp(length_modifier, "l") == 0) value = (unsigned long)arg.u;
+            else if (strcmp(length_modifier, "z") == 0) value = (size_t)arg.u;
+            else value = (unsigned long long)arg.u;
+            snprintf(spec + spec_length, DECODE_SPEC_SIZE - spec_length, "ll%c", conversion);
+            fprintf(out, spec, value);
+            break;
+        }
+        case 'c':
+            snprintf(spec + spec_length, DECODE_SPEC_SIZE - spec_length, "c");
+            fprintf(out, spec, (int)arg.i);
+            break;
+        case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+            snprintf(spec + spec_length, DECODE_SPEC_SIZE - spec_length, "%c", conversion);
+            fprintf(out, spec, arg.d);
+            break;
+        case 's':
+            snprintf(spec + spec_length, DECODE_SPEC_SIZE - spec_length, "s");
+            fprintf(out, spec, (string != NULL) ? string : "<not a string>");
+            break;
+        case 'p':
+            snprintf(spec + spec_length, DECODE_SPEC_SIZE - spec_length, "p");
+            fprintf(out, spec, arg.p);
+            break;
+        default:
+            fprintf(out, "<%%%c>", conversion);
+            break;
+    }
+}
+
+/* Formats the message like printf would, taking the arguments from the line entry. */
+static void decode_message(FILE *out, DecodeArgs_t *args)
+{
+    const char *fmt = args->site->message_fmt;
+    while (*fmt != '\0') {
+        if (*fmt != '%') {
+            fputc(*fmt++, out);
+            continue;
+        }
+        if (fmt[1] == '%') {
+            fputc('%', out);
+            fmt += 2;
+            continue;
+        }
+
+        /* Copies flags, width and precision into the spec, with '*' replaced by the value of its argument. */
+        char spec[DECODE_SPEC_SIZE] = "%";
+        size_t spec_length = 1;
+        ++fmt;
+        while (*fmt != '\0' && strchr("-+ #0'", *fmt) != NULL && spec_length < DECODE_SPEC_SIZE / 2) {
+            spec[spec_length++] = *fmt++;
+        }
+        for (int field = 0; field < 2; ++field) {
+            if (field == 1) {
+                if (*fmt != '.') break;
+                spec[spec_length++] = *fmt++;
+            }
+            if (*fmt == '*') {
+                MycLogArg_t arg;
+                const char *string;
+                const int value = decode_next_arg(args, &arg, &string) ? (int)arg.i : 0;
+                spec_length += (size_t)snprintf(spec + spec_length, DECODE_SPEC_SIZE / 2, "%d", (field == 1 && value < 0) ? 0 : value);
+                ++fmt;
+            }
+            while (*fmt >= '0' && *fmt <= '9' && spec_length < DECODE_SPEC_SIZE / 2) {
+                spec[spec_length++] = *fmt++;
+            }
+        }
+        spec[spec_length] = '\0';
+
+        char length_modifier[3] = { 0 };
+        size_t modifier_length = 0;
+        while (*fmt != '\0' && strchr("hlLqjzt", *fmt) != NULL) {
+            if (modifier_length < 2) length_modifier[modifier_length++] = *fmt;
+            ++fmt;
+        }
+        if (*fmt == '\0') {
+            break;
+        }
+        if (*fmt != 'n') {
+            decode_conversion(out, spec, spec_length, length_modifier, *fmt, args);
+        }
+        ++fmt;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <binary log> [output]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    size_t size;
+    uint8_t *data = decode_read_file(argv[1], &size);
+    if (data == NULL) {
+        return EXIT_FAILURE;
+    }
+    const MycLogBinaryHeader_t *header = (const MycLogBinaryHeader_t*)data;
+    if (size < sizeof(*header) || header->magic != MYC_LOG_BINARY_MAGIC || header->version != MYC_LOG_BINARY_VERSION) {
+        fprintf(stderr, "'%s' is not a binary log of version %d.\n", argv[1], MYC_LOG_BINARY_VERSION);
+        free(data);
+        return EXIT_FAILURE;
+    }
+    FILE *out = (argc > 2) ? fopen(argv[2], "w") : stdout;
+    if (out == NULL) {
+        fprintf(stderr, "Cannot open '%s'.\n", argv[2]);
+        free(data);
+        return EXIT_FAILURE;
+    }
+
+    /* Lines of concurrently registered sites may come before their site entry, so all sites are collected first. */
+    DecodeSite_t *sites = NULL;
+    size_t site_capacity = 0;
+    size_t truncated_offset = 0;
+    for (size_t offset = sizeof(*header); offset < size; ) {
+        const MycLogBinaryEntry_t *entry = (const MycLogBinaryEntry_t*)(data + offset);
+        if (size - offset < sizeof(*entry) || entry->size < sizeof(*entry) || entry->size > size - offset) {
+            truncated_offset = offset;
+            size = offset;
+            break;
+        }
+        if (entry->kind == MYC_LOG_BINARY_ENTRY_SITE) {
+            if (entry->site_id >= site_capacity) {
+                const size_t new_capacity = 2 * (size_t)entry->site_id + 16;
+                DecodeSite_t *new_sites = realloc(sites, new_capacity * sizeof(DecodeSite_t));
+                if (new_sites == NULL) {
+                    fprintf(stderr, "Cannot allocate the site table.\n");
+                    if (out != stdout) {
+                        fclose(out);
+                    }
+                    free(sites);
+                    free(data);
+                    return EXIT_FAILURE;
+                }
+                sites = new_sites;
+                memset(sites + site_capacity, 0, (new_capacity - site_capacity) * sizeof(DecodeSite_t));
+                site_capacity = new_capacity;
+            }
+            if (!decode_site(&sites[entry->site_id], entry)) {
+                fprintf(stderr, "Site entry %u at byte %lu is malformed.\n", entry->site_id, offset);
+            }
+        }
+        offset += entry->size;
+    }
+
+    size_t line_count = 0;
+    for (size_t offset = sizeof(*header); offset < size; ) {
+        const MycLogBinaryEntry_t *entry = (const MycLogBinaryEntry_t*)(data + offset);
+        offset += entry->size;
+        if (entry->kind != MYC_LOG_BINARY_ENTRY_LINE) {
+            continue;
+        }
+        const DecodeSite_t *site = (entry->site_id < site_capacity) ? &sites[entry->site_id] : NULL;
+        if (site == NULL || site->message_fmt == NULL || site->arg_count != entry->arg_count
+                || entry->size < sizeof(*entry) + entry->arg_count * sizeof(MycLogArg_t)) {
+            fprintf(out, "  | <line of unknown site %u>\n", entry->site_id);
+            continue;
+        }
+
+        if (site->label[0] != '\0') {
+            fprintf(out, "%s:   In function '"MYC_FMT_BOLD("%s")"'   (file: "MYC_FMT_BOLD("%s")" | line: "MYC_FMT_BOLD("%d")"):\n",
+                    site->label, site->func_name, site->file_path, site->line_nr);
+        }
+        fputs("  | ", out);
+        DecodeArgs_t args = {
+            .site = site,
+            .slots = (const MycLogArg_t*)(entry + 1),
+            .string_data = (const uint8_t*)((const MycLogArg_t*)(entry + 1) + entry->arg_count),
+            .entry_end = (const uint8_t*)entry + entry->size,
+        };
+        decode_message(out, &args);
+        fputc('\n', out);
+        line_count += 1;
+    }
+    if (truncated_offset != 0) {
+        fprintf(stderr, "Binary log is truncated at byte %lu.\n", truncated_offset);
+    }
+    fprintf(stderr, "Decoded %lu lines.\n", line_count);
+
+    if (out != stdout) {
+        fclose(out);
+    }
+    free(sites);
+    free(data);
+    return EXIT_SUCCESS;
+}